@@ -5,7 +5,12 @@
 #include "uni_system.h"
 
 #include <hardware/watchdog.h>
+#include <pico/time.h>
 
 void uni_system_reboot(void) {
     watchdog_reboot(0 /* pc */, 0 /* sp */, 0 /* delay ms */);
+}
+
+int64_t uni_system_get_time_us(void) {
+    return (int64_t)time_us_64();
 }
\ No newline at end of file
@@ -4,8 +4,16 @@
 
 #include "uni_system.h"
 
+#include <time.h>
+
 #include "uni_log.h"
 
 void uni_system_reboot(void) {
     logi("uni_system_reboot() not implemented in Linux\n");
+}
+
+int64_t uni_system_get_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
\ No newline at end of file
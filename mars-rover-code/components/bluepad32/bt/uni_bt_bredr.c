@@ -19,6 +19,7 @@
 #include "uni_common.h"
 #include "uni_config.h"
 #include "uni_log.h"
+#include "uni_system.h"
 
 // These are the only two supported platforms with BR/EDR support.
 #if !(defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_TARGET_POSIX) || defined(CONFIG_TARGET_PICO_W))
@@ -490,6 +491,7 @@ void uni_bt_bredr_on_l2cap_channel_closed(uint16_t channel, const uint8_t* packe
 
 void uni_bt_bredr_on_l2cap_data_packet(uint16_t channel, const uint8_t* packet, uint16_t size) {
     uni_hid_device_t* d;
+    int64_t rx_us = uni_system_get_time_us();
 
     d = uni_hid_device_get_instance_for_cid(channel);
     if (d == NULL) {
@@ -527,7 +529,9 @@ void uni_bt_bredr_on_l2cap_data_packet(uint16_t channel, const uint8_t* packet,
     }
 
     // Skip the first byte, which is always 0xa1
+    d->report_rx_us = rx_us;
     uni_hid_parse_input_report(d, &packet[1], size - 1);
+    d->report_parsed_us = uni_system_get_time_us();
     uni_hid_device_process_controller(d);
 }
 
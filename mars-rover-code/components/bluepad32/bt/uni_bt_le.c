@@ -73,6 +73,7 @@
 #include "uni_hid_device.h"
 #include "uni_log.h"
 #include "uni_property.h"
+#include "uni_system.h"
 
 static bool is_scanning;
 static bool ble_enabled;
@@ -239,7 +240,9 @@ static void parse_report(const uint8_t* packet, uint16_t size) {
     report_data = gattservice_subevent_hid_report_get_report(packet);
     report_len = gattservice_subevent_hid_report_get_report_len(packet);
 
+    device->report_rx_us = uni_system_get_time_us();
     uni_hid_parse_input_report(device, report_data, report_len);
+    device->report_parsed_us = uni_system_get_time_us();
     uni_hid_device_process_controller(device);
 }
 
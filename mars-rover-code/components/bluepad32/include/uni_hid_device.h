@@ -91,6 +91,11 @@ struct uni_hid_device_s {
     // Bluetooth connection info.
     uni_bt_conn_t conn;
 
+    // uni_system_get_time_us() when the input report being processed was received
+    // and when it was parsed into "controller". Lets the platform measure input latency.
+    int64_t report_rx_us;
+    int64_t report_parsed_us;
+
     // Link to parent device. Used only when the device is a "virtual child".
     // Safe to assume that when parent != NULL, then it is a "virtual" device.
     // For example, the mouse implemented by DualShock4 has the "gamepad" as parent.
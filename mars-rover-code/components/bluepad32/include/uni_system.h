@@ -5,10 +5,15 @@
 #ifndef UNI_SYSTEM_H
 #define UNI_SYSTEM_H
 
+#include <stdint.h>
+
 // Interface
 // Each arch needs to implement these functions
 
 // Reboots the microcontroller
 void uni_system_reboot(void);
 
+// Monotonic time in microseconds
+int64_t uni_system_get_time_us(void);
+
 #endif  // UNI_SYSTEM_H
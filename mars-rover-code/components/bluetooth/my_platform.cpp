@@ -2,12 +2,14 @@
 #include <iostream>
 #include <uni.h>
 #include <drive_system.h>
+#include <gamepad_input.h>
 #include <cmath>
 #include <math.h>
-
-#define DEAD_ZONE 10
-#define AXIS_MAX_INPUT 512.0f
-#define POWER_EXPONENT 3.0f
+#include <argtable3/argtable3.h>
+#include <esp_console.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#include <vector>
 
 static DriveSystem* g_rover = nullptr;
     
@@ -44,7 +46,11 @@ static void my_platform_on_device_connected(uni_hid_device_t* d) {
 
 static void my_platform_on_device_disconnected(uni_hid_device_t* d) {
     logi("custom: device disconnected: %p\n", d);
-    g_rover->set(0, 0.0f);
+    // no more input is coming: stop now rather than coast down
+    GamepadSample sample{};
+    sample.flags = GAMEPAD_SAMPLE_DISCONNECT;
+    g_rover->get_input_session().record(sample);
+    g_rover->emergency_stop();
 }
 
 static uni_error_t my_platform_on_device_ready(uni_hid_device_t* d) {
@@ -56,33 +62,18 @@ static uni_error_t my_platform_on_device_ready(uni_hid_device_t* d) {
     return UNI_ERROR_SUCCESS;
 }
 
-static int32_t normalized_speed(int32_t y) {
-    #define MAX_SPEED 4096
-
-    if (abs(y) < DEAD_ZONE) return 0;
-
-    float normalized_input = abs((float)y / AXIS_MAX_INPUT);
-    
-    float non_linear_scale = std::pow(normalized_input, POWER_EXPONENT);
-    
-    int sign = (y >= 0) ? -1 : 1;
-
-    return (int32_t)(sign * non_linear_scale * MAX_SPEED);
-}
-
-static float normalized_angle(int32_t x) {
-    #define MAX_ANGLE 30.0f
-    #define MAX_ANGLE_RAW 512.0f
-
-    if (std::abs(x) < DEAD_ZONE) return 0.0f;
-
-    float normalized_input = abs((float)x / AXIS_MAX_INPUT);
-    
-    float non_linear_scale = std::pow(normalized_input, POWER_EXPONENT);
-    
-    int sign = (x >= 0) ? 1 : -1;
-
-    return (float)(sign * non_linear_scale * MAX_ANGLE);
+// The part of a report the rover uses, as recorded and replayed by InputSession
+static GamepadSample gamepad_sample(const uni_gamepad_t* gp) {
+    GamepadSample sample{};
+    sample.axis_x = static_cast<int16_t>(gp->axis_x);
+    sample.axis_y = static_cast<int16_t>(gp->axis_y);
+    sample.axis_rx = static_cast<int16_t>(gp->axis_rx);
+    sample.axis_ry = static_cast<int16_t>(gp->axis_ry);
+    sample.brake = static_cast<int16_t>(gp->brake);
+    sample.throttle = static_cast<int16_t>(gp->throttle);
+    sample.buttons = gp->buttons;
+    sample.dpad = gp->dpad;
+    return sample;
 }
 static void my_platform_on_controller_data(uni_hid_device_t* d, uni_controller_t* ctl) {
     static uint8_t leds = 0;
@@ -100,34 +91,37 @@ static void my_platform_on_controller_data(uni_hid_device_t* d, uni_controller_t
     switch (ctl->klass) {
         case UNI_CONTROLLER_CLASS_GAMEPAD: {
             gp = &ctl->gamepad;
-            int32_t speed = normalized_speed(gp->axis_y);
-            float angle = normalized_angle(gp->axis_rx);
+            GamepadSample sample = gamepad_sample(gp);
+            g_rover->get_input_session().record(sample);
             
             float stepper_speed = 0.0f;
-            if (std::abs(gp->axis_rx) > DEAD_ZONE) {
-                stepper_speed = static_cast<float>(gp->axis_rx) / AXIS_MAX_INPUT;
-                stepper_speed = std::copysign(std::pow(std::abs(stepper_speed), POWER_EXPONENT), stepper_speed);
+            if (std::abs(gp->axis_rx) > Gamepad::DEAD_ZONE) {
+                stepper_speed = static_cast<float>(gp->axis_rx) / Gamepad::AXIS_MAX_INPUT;
+                stepper_speed = std::copysign(std::pow(std::abs(stepper_speed), Gamepad::POWER_EXPONENT), stepper_speed);
             }
             g_rover->set_stepper_speed(stepper_speed);
             
-            if (std::abs(gp->axis_ry) > DEAD_ZONE) {
-                float servo_delta = static_cast<float>(gp->axis_ry) / AXIS_MAX_INPUT;
-                servo_delta = std::copysign(std::pow(std::abs(servo_delta), POWER_EXPONENT), servo_delta);
+            if (std::abs(gp->axis_ry) > Gamepad::DEAD_ZONE) {
+                float servo_delta = static_cast<float>(gp->axis_ry) / Gamepad::AXIS_MAX_INPUT;
+                servo_delta = std::copysign(std::pow(std::abs(servo_delta), Gamepad::POWER_EXPONENT), servo_delta);
                 float current_angle = g_rover->get_stepper_motor()->get_servo_angle();
                 float new_angle = current_angle + servo_delta * 0.05f;
                 new_angle = std::max(-1.0f, std::min(1.0f, new_angle));
                 g_rover->set_servo_angle(new_angle);
             }
             
-            if (gp->throttle > 10 || gp->brake > 10) {
-                g_rover->set_spin_input(gp->throttle, gp->brake);
-            } else {
-                g_rover->stop_spinning();
-                g_rover->set(speed, angle);
-
-                if ((abs(gp->axis_y) >= 450) && d->report_parser.play_dual_rumble != NULL) {
-                    d->report_parser.play_dual_rumble(d, 0, 100, 255, 0);
-                }
+            // the camera above is driven straight from here: StepperMotor guards its
+            // targets with its own mutex and moves the motor and servo from its own
+            // task, the drive tick never touches it. The drive input is handed over
+            // to the drive tick, this thread never touches the drive state.
+            DriveCommand cmd = gamepad_drive_command(sample);
+            cmd.timing.rx_us = d->report_rx_us;
+            cmd.timing.parsed_us = d->report_parsed_us;
+            cmd.timing.posted_us = esp_timer_get_time();
+            g_rover->post(cmd);
+
+            if (!cmd.spin && (abs(gp->axis_y) >= 450) && d->report_parser.play_dual_rumble != NULL) {
+                d->report_parser.play_dual_rumble(d, 0, 100, 255, 0);
             }
             break;
         }
@@ -168,6 +162,242 @@ static void my_platform_on_oob_event(uni_platform_oob_event_t event, void* data)
     }
 }
 
+static struct {
+    struct arg_lit* buckets;
+    struct arg_lit* reset;
+    struct arg_end* end;
+} rover_stats_args;
+
+static int cmd_rover_stats(int argc, char** argv) {
+    int nerrors = arg_parse(argc, argv, (void**)&rover_stats_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, rover_stats_args.end, argv[0]);
+        return 1;
+    }
+
+    if (!g_rover)
+        return 1;
+
+#if CONFIG_MOTORS_TICK_STATS
+    TickStats& stats = g_rover->get_tick_stats();
+    stats.print(rover_stats_args.buckets->count > 0);
+#else
+    printf("Tick statistics are disabled (CONFIG_MOTORS_TICK_STATS)\n");
+#endif
+
+#if CONFIG_MOTORS_IMU
+    ImuHeading::Stats imu = g_rover->get_imu().get_stats();
+    printf("IMU: %lu reads, %lu samples, %lu skipped, %lu FIFO overflows, %lu errors\n",
+           (unsigned long)imu.reads, (unsigned long)imu.samples, (unsigned long)imu.skipped,
+           (unsigned long)imu.overflows, (unsigned long)imu.errors);
+#endif
+
+    // SCL speed picked by the probe at startup, and bus time per class on the PCA9685 port
+    const PCA9685Buffer* pca = g_rover->get_pca_buffer();
+    printf("I2C bus: %lu kHz\n", (unsigned long)(pca->get_bus_speed() / 1000));
+
+    static const char* const bus_class_names[I2C_DEV_CLASS_MAX] = {"actuator", "control", "background"};
+    i2c_port_t bus_port = pca->get_port();
+    for (int c = 0; c < I2C_DEV_CLASS_MAX; c++) {
+        i2c_bus_class_stats_t bus;
+        if (i2c_bus_get_stats(bus_port, static_cast<i2c_dev_class_t>(c), &bus) != ESP_OK || !bus.transfers)
+            continue;
+        printf("I2C %s: %lu transfers, %lu deferred, %lu timeouts, %lu late, wait avg/max %lu/%lu us, "
+               "latency max %lu us, busy avg %lu us\n",
+               bus_class_names[c], (unsigned long)bus.transfers, (unsigned long)bus.deferred,
+               (unsigned long)bus.timeouts, (unsigned long)bus.late,
+               (unsigned long)(bus.wait_total_us / bus.transfers), (unsigned long)bus.wait_max_us,
+               (unsigned long)bus.latency_max_us, (unsigned long)(bus.busy_total_us / bus.transfers));
+    }
+
+#if CONFIG_MOTORS_TICK_STATS
+    // the tick task clears the counters at its next tick
+    if (rover_stats_args.reset->count > 0)
+        stats.request_reset();
+#endif
+    return 0;
+}
+
+static struct {
+    struct arg_str* mode;
+    struct arg_end* end;
+} rover_trace_args;
+
+static int cmd_rover_trace(int argc, char** argv) {
+    int nerrors = arg_parse(argc, argv, (void**)&rover_trace_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, rover_trace_args.end, argv[0]);
+        return 1;
+    }
+
+    if (!g_rover)
+        return 1;
+
+    static const char* const modes[] = {"off", "text", "raw"};  // TraceRing::DrainMode order
+    TraceRing* trace = g_rover->get_trace();
+    if (rover_trace_args.mode->count > 0) {
+        const char* mode = rover_trace_args.mode->sval[0];
+        size_t m = 0;
+        while (m < sizeof(modes) / sizeof(modes[0]) && strcmp(mode, modes[m]) != 0)
+            m++;
+        if (m == sizeof(modes) / sizeof(modes[0])) {
+            printf("Unknown mode: %s\n", mode);
+            return 1;
+        }
+        // the drain task picks the mode up at its next pass
+        trace->set_drain_mode(static_cast<TraceRing::DrainMode>(m));
+    }
+
+    printf("Tick trace %s, %lu records dropped\n", modes[static_cast<int>(trace->get_drain_mode())],
+           (unsigned long)trace->get_dropped());
+    return 0;
+}
+
+static struct {
+    struct arg_str* action;
+    struct arg_end* end;
+} rover_record_args;
+
+// Recorded sessions are kept in NVS as one blob
+#define SESSION_NVS_NAMESPACE "rover"
+#define SESSION_NVS_KEY "session"
+
+static esp_err_t save_session(const InputSession& session) {
+    std::vector<uint8_t> blob(session.blob_size());
+    session.serialize(blob.data(), blob.size());
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SESSION_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+        return err;
+    err = nvs_set_blob(handle, SESSION_NVS_KEY, blob.data(), blob.size());
+    if (err == ESP_OK)
+        err = nvs_commit(handle);
+    nvs_close(handle);
+    return err;
+}
+
+static esp_err_t load_session(InputSession& session) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SESSION_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK)
+        return err;
+
+    size_t size = 0;
+    err = nvs_get_blob(handle, SESSION_NVS_KEY, NULL, &size);
+    std::vector<uint8_t> blob(size);
+    if (err == ESP_OK)
+        err = nvs_get_blob(handle, SESSION_NVS_KEY, blob.data(), &size);
+    nvs_close(handle);
+    if (err != ESP_OK)
+        return err;
+
+    return session.load(blob.data(), size);
+}
+
+// Hex lines, "xxd -r -p" turns them back into a file for bench_tick --replay
+static void dump_session(const InputSession& session) {
+    std::vector<uint8_t> blob(session.blob_size());
+    session.serialize(blob.data(), blob.size());
+    for (size_t i = 0; i < blob.size(); i++) {
+        printf("%02x%s", blob[i], (i % 32 == 31 || i == blob.size() - 1) ? "\n" : "");
+    }
+}
+
+static int cmd_rover_record(int argc, char** argv) {
+    int nerrors = arg_parse(argc, argv, (void**)&rover_record_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, rover_record_args.end, argv[0]);
+        return 1;
+    }
+
+    if (!g_rover)
+        return 1;
+
+    InputSession& session = g_rover->get_input_session();
+    const char* action = rover_record_args.action->sval[0];
+    esp_err_t err = ESP_OK;
+
+    if (strcmp(action, "start") == 0) {
+        err = session.start_recording();
+    } else if (strcmp(action, "stop") == 0) {
+        session.stop_recording();
+        session.stop_replay();
+    } else if (strcmp(action, "replay") == 0) {
+        err = session.start_replay();
+        if (err == ESP_OK) {
+            printf("Replaying %lu samples, %.1f s\n", (unsigned long)session.get_count(),
+                   session.get_duration_us() / 1000000.0f);
+        }
+    } else if (strcmp(action, "save") == 0) {
+        err = session.get_mode() == InputSession::Mode::IDLE ? save_session(session) : ESP_ERR_INVALID_STATE;
+    } else if (strcmp(action, "load") == 0) {
+        err = load_session(session);
+    } else if (strcmp(action, "dump") == 0) {
+        dump_session(session);
+    } else if (strcmp(action, "status") != 0) {
+        printf("Unknown action: %s\n", action);
+        return 1;
+    }
+
+    if (err != ESP_OK) {
+        printf("rover_record %s: %s\n", action, esp_err_to_name(err));
+        return 1;
+    }
+
+    static const char* const modes[] = {"idle", "recording", "replaying"};
+    printf("%s, %lu of %lu samples%s; last replay: %lu ticks, outputs %08lx\n",
+           modes[static_cast<int>(session.get_mode())],
+           (unsigned long)session.get_count(), (unsigned long)InputSession::CAPACITY,
+           session.is_full() ? " (full)" : "",
+           (unsigned long)session.get_replayed_ticks(), (unsigned long)session.get_output_hash());
+    return 0;
+}
+
+static void my_platform_register_console_cmds(void) {
+    rover_stats_args.buckets = arg_lit0("b", "buckets", "print every histogram bucket");
+    rover_stats_args.reset = arg_lit0("r", "reset", "clear the statistics after printing them");
+    rover_stats_args.end = arg_end(3);
+
+    const esp_console_cmd_t rover_stats = {
+        .command = "rover_stats",
+        .help = "Control loop timing (tick phase cycles, wake-up latency, overruns), I2C bus speed and use",
+        .hint = NULL,
+        .func = &cmd_rover_stats,
+        .argtable = &rover_stats_args,
+    };
+
+    rover_trace_args.mode = arg_str0(NULL, NULL, "<mode>", "off | text | raw");
+    rover_trace_args.end = arg_end(2);
+
+    const esp_console_cmd_t rover_trace = {
+        .command = "rover_trace",
+        .help = "Tick trace output: off, text (one log line per tick) or raw (binary records)",
+        .hint = NULL,
+        .func = &cmd_rover_trace,
+        .argtable = &rover_trace_args,
+    };
+
+    rover_record_args.action = arg_str1(NULL, NULL, "<action>",
+                                        "start | stop | replay | status | save | load | dump");
+    rover_record_args.end = arg_end(2);
+
+    const esp_console_cmd_t rover_record = {
+        .command = "rover_record",
+        .help =
+            "Records controller input and replays it into the drive.\n"
+            "  start/stop: record, replay: drive the rover with the session,\n"
+            "  save/load: keep it in NVS, dump: print it as hex",
+        .hint = NULL,
+        .func = &cmd_rover_record,
+        .argtable = &rover_record_args,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&rover_stats));
+    ESP_ERROR_CHECK(esp_console_cmd_register(&rover_trace));
+    ESP_ERROR_CHECK(esp_console_cmd_register(&rover_record));
+}
+
 static my_platform_instance_t* get_my_platform_instance(uni_hid_device_t* d) {
     return (my_platform_instance_t*)&d->platform_data[0];
 }
@@ -205,6 +435,7 @@ extern "C" struct uni_platform* get_my_platform(DriveSystem* ds) {
     plat.on_oob_event = my_platform_on_oob_event;
     plat.on_controller_data = my_platform_on_controller_data;
     plat.get_property = my_platform_get_property;
+    plat.register_console_cmds = my_platform_register_console_cmds;
 
     return &plat;
 }
\ No newline at end of file
@@ -33,8 +33,11 @@
  */
 
 #include "i2cdev.h"
+#include "i2cdev_sched.h"
 #include <driver/i2c_master.h>
 #include <esp_log.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <inttypes.h>
@@ -50,6 +53,8 @@ static const char *TAG = "i2cdev";
 #define I2C_DEFAULT_FREQ_HZ         400000
 #define I2C_MAX_RETRIES             3
 #define I2C_RETRY_BASE_DELAY_MS     20
+#define I2C_FRAMED_MAX_ATTEMPTS     3   // i2c_dev_write_framed_timeout(), within its deadline
+#define I2C_FRAMED_RETRY_DELAY_US   100 // pause before the second attempt, doubled for each one after
 #define I2CDEV_MAX_STACK_ALLOC_SIZE 32 // Stack allocation threshold to avoid heap fragmentation for small buffers
 
 typedef struct
@@ -135,10 +140,12 @@ esp_err_t i2cdev_init(void)
 
 esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev)
 {
-#if !CONFIG_I2CDEV_NOLOCK
     if (!dev)
         return ESP_ERR_INVALID_ARG;
 
+    i2c_sched_route(dev);
+#if !CONFIG_I2CDEV_NOLOCK
+
     ESP_LOGV(TAG, "[0x%02x at %d] Creating device mutex...", dev->addr, dev->port);
     if (dev->mutex)
     {
@@ -678,20 +685,20 @@ esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_si
 
     ESP_LOGV(TAG, "[0x%02x at %d] i2c_dev_read called (out_size: %u, in_size: %u)", dev->addr, dev->port, out_size, in_size);
 
-    esp_err_t result = i2c_do_operation_with_retry((i2c_dev_t *)dev, // Cast to non-const for i2c_setup_device internal modifications
+    i2c_sched_slot_t slot;
+    esp_err_t result = i2c_sched_begin(dev, out_size + in_size, &slot);
+    if (result != ESP_OK)
+        return result;
+    result = i2c_do_operation_with_retry((i2c_dev_t *)dev, // Cast to non-const for i2c_setup_device internal modifications
         out_data && out_size ? i2c_master_transmit_receive_wrapper : i2c_master_receive_wrapper, out_data, out_size, in_data, in_size);
+    i2c_sched_end(dev, &slot);
 
     ESP_LOGV(TAG, "[0x%02x at %d] i2c_dev_read result: %s (%d)", dev->addr, dev->port, esp_err_to_name(result), result);
     return result;
 }
 
-esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+static esp_err_t dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
 {
-    if (!dev)
-        return ESP_ERR_INVALID_ARG;
-    if ((!out_reg || !out_reg_size) && (!out_data || !out_size))
-        return ESP_ERR_INVALID_ARG;
-
     ESP_LOGV(TAG, "[0x%02x at %d] i2c_dev_write called (reg_size: %u, data_size: %u)", dev->addr, dev->port, out_reg_size, out_size);
 
     esp_err_t res;
@@ -745,6 +752,22 @@ esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_re
     return res;
 }
 
+esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+{
+    if (!dev)
+        return ESP_ERR_INVALID_ARG;
+    if ((!out_reg || !out_reg_size) && (!out_data || !out_size))
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sched_slot_t slot;
+    esp_err_t res = i2c_sched_begin(dev, (out_reg ? out_reg_size : 0) + (out_data ? out_size : 0), &slot);
+    if (res != ESP_OK)
+        return res;
+    res = dev_write(dev, out_reg, out_reg_size, out_data, out_size);
+    i2c_sched_end(dev, &slot);
+    return res;
+}
+
 esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *data, size_t size)
 {
     ESP_LOGV(TAG, "[0x%02x at %d] i2c_dev_read_reg called (reg: 0x%02x, size: %u)", dev->addr, dev->port, reg, size);
@@ -817,6 +840,161 @@ esp_err_t i2c_dev_check_present(const i2c_dev_t *dev_const)
     }
 }
 
+esp_err_t i2c_dev_set_speed(i2c_dev_t *dev, uint32_t clk_speed)
+{
+    if (!dev || !clk_speed || dev->port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    if (dev->cfg.master.clk_speed == clk_speed)
+        return ESP_OK;
+
+    ESP_LOGV(TAG, "[0x%02x at %d] Changing speed %" PRIu32 " -> %" PRIu32 " Hz", dev->addr, dev->port, dev->cfg.master.clk_speed, clk_speed);
+    dev->cfg.master.clk_speed = clk_speed;
+
+    if (!dev->dev_handle)
+        return ESP_OK;
+
+    // Speed is a property of the device handle: drop it, i2c_setup_device() adds it again
+    i2c_port_state_t *port_state = &i2c_ports[dev->port];
+    if (xSemaphoreTake(port_state->lock, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] Could not take port mutex for speed change", dev->addr, dev->port);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t res = i2c_master_bus_rm_device((i2c_master_dev_handle_t)dev->dev_handle);
+    if (res != ESP_OK)
+    {
+        ESP_LOGW(TAG, "[0x%02x at %d] Failed to remove device handle: %s", dev->addr, dev->port, esp_err_to_name(res));
+    }
+    dev->dev_handle = NULL;
+    if (port_state->ref_count > 0)
+        port_state->ref_count--;
+
+    xSemaphoreGive(port_state->lock);
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_attach(i2c_dev_t *dev)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = i2c_setup_device(dev);
+    if (res == ESP_OK && !dev->dev_handle)
+        res = ESP_ERR_INVALID_STATE;
+    if (res != ESP_OK)
+        ESP_LOGE(TAG, "[0x%02x at %d] Attach failed: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
+    return res;
+}
+
+esp_err_t i2c_dev_write_framed(const i2c_dev_t *dev, const void *frame, size_t size)
+{
+    if (!dev || !frame || !size)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sched_slot_t slot;
+    esp_err_t res = i2c_sched_begin(dev, size, &slot);
+    if (res != ESP_OK)
+        return res;
+
+    // Fast path: device is already on the bus
+    if (dev->dev_handle && i2c_master_transmit(dev->dev_handle, frame, size, CONFIG_I2CDEV_TIMEOUT) == ESP_OK)
+    {
+        i2c_sched_end(dev, &slot);
+        return ESP_OK;
+    }
+
+    ESP_LOGV(TAG, "[0x%02x at %d] Framed write falls back to the regular path (handle %p)", dev->addr, dev->port, dev->dev_handle);
+    res = i2c_do_operation_with_retry((i2c_dev_t *)dev, i2c_master_transmit_wrapper, frame, size, NULL, 0);
+    i2c_sched_end(dev, &slot);
+    return res;
+}
+
+esp_err_t i2c_dev_write_framed_timeout(const i2c_dev_t *dev, const void *frame, size_t size, uint32_t timeout_us)
+{
+    if (!dev || !frame || !size)
+        return ESP_ERR_INVALID_ARG;
+
+    // Setup may block on the port mutex and bus install: leave it to i2c_dev_recover()
+    if (!dev->dev_handle)
+        return ESP_ERR_INVALID_STATE;
+
+    i2c_sched_slot_t slot;
+    esp_err_t res = i2c_sched_begin(dev, size, &slot);
+    if (res != ESP_OK)
+        return res;
+
+    // A NACK comes back within a few bytes' time: give the device a short pause
+    // between attempts, and leave a bus that keeps failing to i2c_dev_recover()
+    int64_t deadline = slot.started + timeout_us;
+    uint32_t pause_us = I2C_FRAMED_RETRY_DELAY_US;
+    for (int attempt = 1;; attempt++)
+    {
+        if (!dev->dev_handle)
+        {
+            res = ESP_ERR_INVALID_STATE;
+            break;
+        }
+
+        int64_t left_us = deadline - esp_timer_get_time();
+        int timeout_ms = left_us > 1000 ? (int)((left_us + 999) / 1000) : 1;
+        res = i2c_master_transmit(dev->dev_handle, frame, size, timeout_ms);
+        if (res == ESP_OK)
+            break;
+
+        ESP_LOGV(TAG, "[0x%02x at %d] Framed write failed (attempt %d): %d (%s), %" PRIi64 " us left", dev->addr, dev->port, attempt, res, esp_err_to_name(res), left_us);
+        if (attempt >= I2C_FRAMED_MAX_ATTEMPTS || esp_timer_get_time() + pause_us >= deadline)
+            break;
+        esp_rom_delay_us(pause_us);
+        pause_us *= 2;
+    }
+
+    i2c_sched_end(dev, &slot);
+    return res;
+}
+
+esp_err_t i2c_dev_recover(i2c_dev_t *dev)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    ESP_LOGW(TAG, "[0x%02x at %d] Recovering bus", dev->addr, dev->port);
+
+    i2c_port_state_t *port_state = &i2c_ports[dev->port];
+    if (xSemaphoreTake(port_state->lock, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] Could not take port mutex for recovery", dev->addr, dev->port);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (dev->dev_handle)
+    {
+        esp_err_t rm_res = i2c_master_bus_rm_device((i2c_master_dev_handle_t)dev->dev_handle);
+        if (rm_res != ESP_OK)
+            ESP_LOGW(TAG, "[0x%02x at %d] Failed to remove device handle: %s", dev->addr, dev->port, esp_err_to_name(rm_res));
+        dev->dev_handle = NULL;
+        if (port_state->ref_count > 0)
+            port_state->ref_count--;
+    }
+
+    if (port_state->installed && port_state->bus_handle)
+    {
+        esp_err_t reset_res = i2c_master_bus_reset(port_state->bus_handle);
+        if (reset_res != ESP_OK)
+            ESP_LOGW(TAG, "[Port %d] Bus reset failed: %s", dev->port, esp_err_to_name(reset_res));
+    }
+
+    xSemaphoreGive(port_state->lock);
+
+    esp_err_t res = i2c_setup_device(dev);
+    if (res == ESP_OK && !dev->dev_handle)
+        res = ESP_ERR_INVALID_STATE;
+
+    ESP_LOGI(TAG, "[0x%02x at %d] Recovery finished: %s", dev->addr, dev->port, esp_err_to_name(res));
+    return res;
+}
+
 // Compatibility wrapper for legacy code that still calls i2c_dev_probe
 // The new driver implementation uses i2c_master_probe which doesn't need operation_type
 esp_err_t i2c_dev_probe(const i2c_dev_t *dev, i2c_dev_type_t operation_type)
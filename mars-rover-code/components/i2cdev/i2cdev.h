@@ -115,6 +115,35 @@ typedef enum {
     I2C_DEV_READ       /**< Read operation for probe */
 } i2c_dev_type_t;
 
+/**
+ * @brief Bus priority class of a device
+ *
+ * Transfers of devices on the same port are arbitrated by class, see
+ * i2c_bus_tick(). Devices default to I2C_DEV_CLASS_ACTUATOR, which is
+ * never held back, so a zero-initialised descriptor behaves as before.
+ */
+typedef enum {
+    I2C_DEV_CLASS_ACTUATOR = 0, /**< Outputs written every control tick (PWM drivers) */
+    I2C_DEV_CLASS_CONTROL,      /**< Sensors the control loop reads every tick (IMU) */
+    I2C_DEV_CLASS_BACKGROUND,   /**< Everything else (telemetry, current sensors) */
+    I2C_DEV_CLASS_MAX
+} i2c_dev_class_t;
+
+/**
+ * @brief Per class bus statistics, counted since start
+ */
+typedef struct
+{
+    uint32_t transfers;      //!< Transfers started
+    uint32_t deferred;       //!< Transfers held back by the scheduler before they started
+    uint32_t timeouts;       //!< Transfers given up after CONFIG_I2CDEV_TIMEOUT at the scheduler
+    uint32_t late;           //!< Actuator transfers that finished after the actuator window of their tick
+    uint32_t wait_max_us;    //!< Longest time from request to start
+    uint32_t latency_max_us; //!< Longest time from request to end
+    uint64_t wait_total_us;  //!< Sum of request to start
+    uint64_t busy_total_us;  //!< Sum of start to end
+} i2c_bus_class_stats_t;
+
 /**
  * I2C device descriptor
  *
@@ -135,6 +164,7 @@ typedef enum {
  * │ - dev->cfg.sda_pullup_en - Enable internal SDA pullup                │
  * │ - dev->cfg.scl_pullup_en - Enable internal SCL pullup                │
  * │ - dev->timeout_ticks     - Legacy driver timeout (legacy only)       │
+ * │ - dev->bus_class         - Bus priority class (default actuator)     │
  * └──────────────────────────────────────────────────────────────────────┘
  *
  * ┌─── AUTO-POPULATED (library fills these) ─────────────────────────────┐
@@ -157,6 +187,7 @@ typedef struct
     i2c_port_t port;                 //!< I2C port number (e.g., I2C_NUM_0)
     uint16_t addr;                   //!< Device I2C address (e.g., 0x48 for 7-bit)
     i2c_addr_bit_len_t addr_bit_len; //!< Address format: I2C_ADDR_BIT_LEN_7 (default) or I2C_ADDR_BIT_LEN_10
+    i2c_dev_class_t bus_class;       //!< Bus priority class, set before i2c_dev_create_mutex() (default I2C_DEV_CLASS_ACTUATOR)
 
     // ═══ Library Internal State (AUTO-POPULATED) ═══
     SemaphoreHandle_t mutex; //!< Device mutex - Created by i2c_dev_create_mutex()
@@ -312,6 +343,153 @@ esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *data, size_t
  */
 esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *data, size_t size);
 
+/**
+ * @brief Change SCL speed of a device
+ *
+ * Updates `dev->cfg.master.clk_speed`. With the i2c_master driver the speed
+ * is fixed when the device is added to the bus, so an existing device handle
+ * is released and the next operation adds the device again at the new speed.
+ * The legacy driver reconfigures the port on the next operation.
+ * Device mutex should be held by the caller.
+ *
+ * @param dev Pointer to device descriptor
+ * @param clk_speed SCL frequency, Hz
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_dev_set_speed(i2c_dev_t *dev, uint32_t clk_speed);
+
+/**
+ * @brief Set up a device for the write fast path
+ *
+ * Does the device setup (port install, adding the device to the bus) now,
+ * instead of before each operation, so i2c_dev_write_framed() finds a
+ * ready device handle. Meant for devices written at a high rate.
+ * Device mutex should be held by the caller.
+ *
+ * @param dev Pointer to device descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_dev_attach(i2c_dev_t *dev);
+
+/**
+ * @brief Write a pre-framed buffer to device
+ *
+ * `frame` already holds the register address followed by the data, so
+ * nothing is copied. With a device handle from i2c_dev_attach() the frame
+ * goes straight to the driver, without device setup or validation.
+ * Only when that fails, or when there is no handle (not attached yet, or
+ * released by i2c_dev_set_speed() or an earlier error), the write is
+ * repeated through the regular path, which sets the device up again and
+ * retries with backoff.
+ *
+ * @param dev Pointer to device descriptor
+ * @param[in] frame Register address and data
+ * @param size Size of frame
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_dev_write_framed(const i2c_dev_t *dev, const void *frame, size_t size);
+
+/**
+ * @brief Write a pre-framed buffer to device, giving up at a deadline
+ *
+ * Same as i2c_dev_write_framed(), but for callers with a time budget:
+ * a failed transfer is tried at most 3 times, with a pause of 100 us
+ * before the second attempt and 200 us before the third (a busy wait,
+ * no backoff sleep), as long as the deadline allows. A bus that keeps
+ * failing is left to i2c_dev_recover(). The call never blocks for much
+ * longer than `timeout_us` (a control or background device may wait at
+ * the bus scheduler before that, see i2c_bus_tick()). No device setup is
+ * done here - without a device handle `ESP_ERR_INVALID_STATE` is returned
+ * at once and i2c_dev_recover() should be run from a task that can afford
+ * to block.
+ *
+ * @param dev Pointer to device descriptor
+ * @param[in] frame Register address and data
+ * @param size Size of frame
+ * @param timeout_us Time budget for all attempts, microseconds
+ * @return `ESP_OK` on success, error of the last attempt otherwise
+ */
+esp_err_t i2c_dev_write_framed_timeout(const i2c_dev_t *dev, const void *frame, size_t size, uint32_t timeout_us);
+
+/**
+ * @brief Recover bus and device after errors
+ *
+ * Releases the device handle, resets the bus (SCL is clocked until a slave
+ * holding SDA low lets it go) and sets the device up again.
+ * Blocks for up to a few bus timeouts, call it from a background task.
+ * Device mutex should be held by the caller.
+ *
+ * @param dev Pointer to device descriptor
+ * @return `ESP_OK` if the device is set up again
+ */
+esp_err_t i2c_dev_recover(i2c_dev_t *dev);
+
+/**
+ * @brief Start a control tick on a port
+ *
+ * Turns on the bus scheduler of `port` (until the first call, transfers
+ * of every class start as soon as the bus allows) and opens the tick's
+ * actuator window:
+ *
+ * - Actuator transfers always start at once.
+ * - Control and background transfers wait while an actuator transfer is
+ *   claimed or in flight, and during the first
+ *   CONFIG_I2CDEV_SCHED_ACTUATOR_WINDOW_US of the tick until the
+ *   actuator traffic of the tick has gone out.
+ * - Each of them gets a bus time budget per tick
+ *   (CONFIG_I2CDEV_SCHED_CONTROL_BUDGET_US,
+ *   CONFIG_I2CDEV_SCHED_BACKGROUND_BUDGET_US) and only starts when its
+ *   estimated wire time fits the budget and ends before the next tick
+ *   (the period is measured between calls).
+ *
+ * So at a tick the bus is free, and actuator writes wait behind at most
+ * one lower class transfer that overran its estimate.
+ * Call it from the control loop at the start of each tick.
+ *
+ * @param port I2C port number
+ */
+void i2c_bus_tick(i2c_port_t port);
+
+/**
+ * @brief Claim the bus for actuator traffic
+ *
+ * Holds back control and background transfers on `port` until the
+ * matching i2c_bus_release(), so a frame split over several transfers
+ * (several devices, several bursts) goes out as a whole. Nests.
+ *
+ * @param port I2C port number
+ */
+void i2c_bus_claim(i2c_port_t port);
+
+/**
+ * @brief Release a claim of i2c_bus_claim()
+ *
+ * @param port I2C port number
+ */
+void i2c_bus_release(i2c_port_t port);
+
+/**
+ * @brief End the actuator window of this tick early
+ *
+ * For a tick without actuator traffic (nothing changed): control and
+ * background transfers go ahead at once instead of at the end of the
+ * window. A tick that writes does not need it, the window ends when its
+ * last actuator transfer or claim does.
+ *
+ * @param port I2C port number
+ */
+void i2c_bus_actuators_done(i2c_port_t port);
+
+/**
+ * @brief Get the bus statistics of a device class
+ *
+ * @param port I2C port number
+ * @param bus_class Device class
+ * @param[out] stats Statistics
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_bus_get_stats(i2c_port_t port, i2c_dev_class_t bus_class, i2c_bus_class_stats_t *stats);
+
 /**
  * @brief Take device mutex with error checking
  */
@@ -32,19 +32,28 @@
  */
 #include "esp_idf_lib_helpers.h" // For HELPER_TARGET_IS_ESP32 etc.
 #include "i2cdev.h"              // Common header
+#include "i2cdev_sched.h"        // Bus scheduler hooks
 #include <driver/i2c.h>          // Legacy I2C driver
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <inttypes.h>
 #include <sdkconfig.h>
 #if !HELPER_TARGET_IS_ESP8266
+#include <esp_rom_sys.h>
 #include <soc/clk_tree_defs.h> // For APB_CLK_FREQ
+#else
+#include <rom/ets_sys.h>
+#define esp_rom_delay_us ets_delay_us
 #endif
 #include <string.h>
 
 static const char *TAG = "i2cdev_legacy";
 
+#define I2C_FRAMED_MAX_ATTEMPTS   3   // i2c_dev_write_framed_timeout(), within its deadline
+#define I2C_FRAMED_RETRY_DELAY_US 100 // pause before the second attempt, doubled for each one after
+
 typedef struct
 {
     SemaphoreHandle_t lock;
@@ -266,10 +275,12 @@ esp_err_t i2cdev_done()
 
 esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev)
 {
-#if !CONFIG_I2CDEV_NOLOCK
     if (!dev)
         return ESP_ERR_INVALID_ARG;
 
+    i2c_sched_route(dev);
+#if !CONFIG_I2CDEV_NOLOCK
+
     ESP_LOGV(TAG, "[0x%02x at %d] Creating device mutex", dev->addr, dev->port);
 
     // Initialize device pins to -1 to ensure consistent pattern with new driver
@@ -611,7 +622,7 @@ esp_err_t i2c_dev_probe(const i2c_dev_t *dev, i2c_dev_type_t operation_type)
     return res;
 }
 
-esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+static esp_err_t dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
 {
     if (!dev || !in_data || !in_size)
         return ESP_ERR_INVALID_ARG;
@@ -656,7 +667,7 @@ esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_si
     return err;
 }
 
-esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+static esp_err_t dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
 {
     if (!dev)
         return ESP_ERR_INVALID_ARG;
@@ -704,7 +715,7 @@ esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_re
     return err;
 }
 
-esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *out_data, size_t out_size)
+static esp_err_t dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *out_data, size_t out_size)
 {
     if (!dev || !out_data || !out_size)
         return ESP_ERR_INVALID_ARG;
@@ -742,7 +753,7 @@ esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *out_d
     return err;
 }
 
-esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *in_data, size_t in_size)
+static esp_err_t dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *in_data, size_t in_size)
 {
     if (!dev || !in_data || !in_size)
         return ESP_ERR_INVALID_ARG;
@@ -779,6 +790,161 @@ esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *in_data, siz
     return err;
 }
 
+// Public transfer functions: the above, let through by the bus scheduler
+
+esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
+    i2c_sched_slot_t slot;
+    esp_err_t err = i2c_sched_begin(dev, out_size + in_size, &slot);
+    if (err != ESP_OK)
+        return err;
+    err = dev_read(dev, out_data, out_size, in_data, in_size);
+    i2c_sched_end(dev, &slot);
+    return err;
+}
+
+esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+{
+    i2c_sched_slot_t slot;
+    esp_err_t err = i2c_sched_begin(dev, (out_reg ? out_reg_size : 0) + (out_data ? out_size : 0), &slot);
+    if (err != ESP_OK)
+        return err;
+    err = dev_write(dev, out_reg, out_reg_size, out_data, out_size);
+    i2c_sched_end(dev, &slot);
+    return err;
+}
+
+esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *out_data, size_t out_size)
+{
+    i2c_sched_slot_t slot;
+    esp_err_t err = i2c_sched_begin(dev, 1 + out_size, &slot);
+    if (err != ESP_OK)
+        return err;
+    err = dev_write_reg(dev, reg, out_data, out_size);
+    i2c_sched_end(dev, &slot);
+    return err;
+}
+
+esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *in_data, size_t in_size)
+{
+    i2c_sched_slot_t slot;
+    esp_err_t err = i2c_sched_begin(dev, 1 + in_size, &slot);
+    if (err != ESP_OK)
+        return err;
+    err = dev_read_reg(dev, reg, in_data, in_size);
+    i2c_sched_end(dev, &slot);
+    return err;
+}
+
+esp_err_t i2c_dev_set_speed(i2c_dev_t *dev, uint32_t clk_speed)
+{
+    if (!dev || !clk_speed)
+        return ESP_ERR_INVALID_ARG;
+
+#ifdef CONFIG_IDF_TARGET_ESP8266
+    ESP_LOGW(TAG, "[0x%02x at %d] Speed change is not supported on ESP8266", dev->addr, dev->port);
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    // i2c_setup_port() reconfigures the port when the config differs from the installed one
+    dev->cfg.master.clk_speed = clk_speed;
+    return ESP_OK;
+#endif
+}
+
+esp_err_t i2c_dev_attach(i2c_dev_t *dev)
+{
+    if (!dev)
+        return ESP_ERR_INVALID_ARG;
+
+    // The legacy driver has no device handles, only the port needs to be ready
+    SEMAPHORE_TAKE(dev->port);
+    esp_err_t err = i2c_setup_port(dev);
+    SEMAPHORE_GIVE(dev->port);
+    return err;
+}
+
+esp_err_t i2c_dev_write_framed(const i2c_dev_t *dev, const void *frame, size_t size)
+{
+    return i2c_dev_write(dev, NULL, 0, frame, size);
+}
+
+static esp_err_t dev_write_framed_timeout(const i2c_dev_t *dev, const void *frame, size_t size, int64_t deadline)
+{
+    SEMAPHORE_TAKE(dev->port);
+    if (!states[dev->port].installed)
+    {
+        // Driver install blocks, leave it to i2c_dev_recover()
+        SEMAPHORE_GIVE(dev->port);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A NACK comes back within a few bytes' time: give the device a short pause
+    // between attempts, and leave a bus that keeps failing to i2c_dev_recover()
+    esp_err_t err;
+    uint32_t pause_us = I2C_FRAMED_RETRY_DELAY_US;
+    for (int attempt = 1;; attempt++)
+    {
+        // The legacy driver waits in RTOS ticks: one tick at least, however little is left
+        int64_t left_us = deadline - esp_timer_get_time();
+        TickType_t ticks = left_us > 0 ? pdMS_TO_TICKS((left_us + 999) / 1000) : 0;
+
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, dev->addr << 1, true);
+        i2c_master_write(cmd, (void *)frame, size, true);
+        i2c_master_stop(cmd);
+        err = i2c_master_cmd_begin(dev->port, cmd, ticks ? ticks : 1);
+        i2c_cmd_link_delete(cmd);
+        if (err == ESP_OK)
+            break;
+
+        ESP_LOGV(TAG, "[0x%02x at %d] Framed write failed (attempt %d): %d (%s), %" PRIi64 " us left", dev->addr, dev->port, attempt, err, esp_err_to_name(err), left_us);
+        if (attempt >= I2C_FRAMED_MAX_ATTEMPTS || esp_timer_get_time() + pause_us >= deadline)
+            break;
+        esp_rom_delay_us(pause_us);
+        pause_us *= 2;
+    }
+    SEMAPHORE_GIVE(dev->port);
+
+    return err;
+}
+
+esp_err_t i2c_dev_write_framed_timeout(const i2c_dev_t *dev, const void *frame, size_t size, uint32_t timeout_us)
+{
+    if (!dev || !frame || !size)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sched_slot_t slot;
+    esp_err_t err = i2c_sched_begin(dev, size, &slot);
+    if (err != ESP_OK)
+        return err;
+    err = dev_write_framed_timeout(dev, frame, size, slot.started + timeout_us);
+    i2c_sched_end(dev, &slot);
+    return err;
+}
+
+esp_err_t i2c_dev_recover(i2c_dev_t *dev)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    ESP_LOGW(TAG, "[0x%02x at %d] Recovering bus", dev->addr, dev->port);
+
+    // Reinstalling the driver reconfigures the pins, which also clears a stuck bus
+    SEMAPHORE_TAKE(dev->port);
+    if (states[dev->port].installed)
+    {
+        i2c_driver_delete(dev->port);
+        states[dev->port].installed = false;
+        states[dev->port].ref_count = 0;
+    }
+    esp_err_t err = i2c_setup_port(dev);
+    SEMAPHORE_GIVE(dev->port);
+
+    ESP_LOGI(TAG, "[0x%02x at %d] Recovery finished: %s", dev->addr, dev->port, esp_err_to_name(err));
+    return err;
+}
+
 // Implementation of i2c_dev_check_present (updated version of i2c_dev_probe) using legacy I2C driver
 esp_err_t i2c_dev_check_present(const i2c_dev_t *dev)
 {
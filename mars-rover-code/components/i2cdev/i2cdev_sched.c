@@ -0,0 +1,322 @@
+/**
+ * @file i2cdev_sched.c
+ *
+ * Priority classes for the devices sharing an I2C port
+ *
+ * Shared by both i2cdev implementations. The state of each port sits
+ * under a spinlock; a waiting transfer sleeps on the port's gate
+ * semaphore, which is given once for every sleeping transfer whenever the
+ * actuator traffic drains, and otherwise wakes up at the time its turn is
+ * due.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+
+#include "i2cdev_sched.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <string.h>
+
+#ifndef CONFIG_I2CDEV_SCHED_ACTUATOR_WINDOW_US
+#define CONFIG_I2CDEV_SCHED_ACTUATOR_WINDOW_US 2000
+#endif
+
+#ifndef CONFIG_I2CDEV_SCHED_CONTROL_BUDGET_US
+#define CONFIG_I2CDEV_SCHED_CONTROL_BUDGET_US 2000
+#endif
+
+#ifndef CONFIG_I2CDEV_SCHED_BACKGROUND_BUDGET_US
+#define CONFIG_I2CDEV_SCHED_BACKGROUND_BUDGET_US 1000
+#endif
+
+#define DEFAULT_CLK_SPEED_HZ 100000
+#define XFER_OVERHEAD_US     30 // driver setup and STOP, on top of the clocked bytes
+#define IDLE_AFTER_US        100000 // no second tick this long after the first: the loop has stopped
+#define GATE_MAX_WAITERS     16 // transfers sleeping beyond this wake up on their own timeout
+
+// ESP8266 RTOS SDK critical sections take no lock
+#if HELPER_TARGET_IS_ESP8266
+#define SCHED_LOCK(p)   portENTER_CRITICAL()
+#define SCHED_UNLOCK(p) portEXIT_CRITICAL()
+#else
+#define SCHED_LOCK(p)   portENTER_CRITICAL(&(p)->lock)
+#define SCHED_UNLOCK(p) portEXIT_CRITICAL(&(p)->lock)
+#endif
+
+static const char *TAG = "i2cdev_sched";
+
+typedef struct
+{
+#if !HELPER_TARGET_IS_ESP8266
+    portMUX_TYPE lock;
+#endif
+    SemaphoreHandle_t gate; // counting, given once per waiter when the actuator traffic drains
+    uint32_t waiters;       // transfers sleeping on the gate
+    uint32_t actuators;     // actuator claims and transfers in flight
+    bool actuators_done;    // the actuator traffic of this tick has gone out
+    int64_t tick_us;        // start of the current tick, 0 until i2c_bus_tick()
+    uint32_t period_us;     // between the last two ticks, 0 until known
+    int32_t budget_us[I2C_DEV_CLASS_MAX];
+    i2c_bus_class_stats_t stats[I2C_DEV_CLASS_MAX];
+} sched_port_t;
+
+#if HELPER_TARGET_IS_ESP8266
+static sched_port_t ports[I2C_NUM_MAX];
+#else
+static sched_port_t ports[I2C_NUM_MAX] = {
+    [0 ... I2C_NUM_MAX - 1] = { .lock = portMUX_INITIALIZER_UNLOCKED },
+};
+#endif
+
+static const int32_t class_budget_us[I2C_DEV_CLASS_MAX] = {
+    [I2C_DEV_CLASS_ACTUATOR] = 0,
+    [I2C_DEV_CLASS_CONTROL] = CONFIG_I2CDEV_SCHED_CONTROL_BUDGET_US,
+    [I2C_DEV_CLASS_BACKGROUND] = CONFIG_I2CDEV_SCHED_BACKGROUND_BUDGET_US,
+};
+
+// Wake every transfer that sleeps on the gate: each one takes its own give
+static void open_gate(sched_port_t *p, uint32_t waiters)
+{
+    for (uint32_t i = 0; i < waiters; i++)
+        xSemaphoreGive(p->gate);
+}
+
+// Wire time of a transfer, microseconds
+static int32_t estimate_us(const i2c_dev_t *dev, size_t bytes)
+{
+    uint32_t hz = dev->cfg.master.clk_speed ? dev->cfg.master.clk_speed : DEFAULT_CLK_SPEED_HZ;
+    // + address byte, and one more for the repeated start of a read
+    return (int32_t)((uint64_t)(bytes + 2) * 9 * 1000000 / hz) + XFER_OVERHEAD_US;
+}
+
+// With the port locked: may the transfer start now? If not, `wake_us` is when to look again
+static bool admit_locked(sched_port_t *p, i2c_dev_class_t cls, int32_t est_us, int64_t now, int64_t *wake_us)
+{
+    *wake_us = 0;
+    if (p->actuators)
+        return false; // woken by the gate
+    if (!p->tick_us)
+        return true;
+
+    int64_t since = now - p->tick_us;
+    // ticks stopped (loop paused, rover parked): the port is free for all again
+    if (since >= (p->period_us ? 2 * (int64_t)p->period_us : IDLE_AFTER_US))
+        return true;
+
+    int64_t next_tick = p->period_us ? p->tick_us + p->period_us : 0;
+    if (!p->actuators_done && since < CONFIG_I2CDEV_SCHED_ACTUATOR_WINDOW_US)
+    {
+        *wake_us = p->tick_us + CONFIG_I2CDEV_SCHED_ACTUATOR_WINDOW_US;
+        return false;
+    }
+    if (p->budget_us[cls] < est_us || (next_tick && now + est_us > next_tick))
+    {
+        // after the next tick's actuator window at the latest
+        *wake_us = (next_tick ? next_tick : now) + CONFIG_I2CDEV_SCHED_ACTUATOR_WINDOW_US;
+        return false;
+    }
+    p->budget_us[cls] -= est_us;
+    return true;
+}
+
+esp_err_t i2c_sched_begin(const i2c_dev_t *dev, size_t bytes, i2c_sched_slot_t *slot)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX || dev->bus_class >= I2C_DEV_CLASS_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    sched_port_t *p = &ports[dev->port];
+    i2c_dev_class_t cls = dev->bus_class;
+    slot->requested = esp_timer_get_time();
+
+    if (cls == I2C_DEV_CLASS_ACTUATOR)
+    {
+        SCHED_LOCK(p);
+        p->actuators++;
+        SCHED_UNLOCK(p);
+        slot->started = slot->requested;
+        return ESP_OK;
+    }
+
+    int32_t est_us = estimate_us(dev, bytes);
+    int64_t deadline = slot->requested + (int64_t)CONFIG_I2CDEV_TIMEOUT * 1000;
+    bool deferred = false;
+    while (true)
+    {
+        int64_t now = esp_timer_get_time();
+        int64_t wake_us;
+        SCHED_LOCK(p);
+        bool admitted = admit_locked(p, cls, est_us, now, &wake_us);
+        if (!admitted && now >= deadline)
+            p->stats[cls].timeouts++;
+        // counted with the decision, so a drain right after it still gives for this transfer
+        bool sleeps = !admitted && now < deadline && p->gate;
+        if (sleeps)
+            p->waiters++;
+        SCHED_UNLOCK(p);
+
+        if (admitted)
+        {
+            slot->started = now;
+            if (deferred)
+            {
+                SCHED_LOCK(p);
+                p->stats[cls].deferred++;
+                SCHED_UNLOCK(p);
+            }
+            return ESP_OK;
+        }
+        if (now >= deadline)
+        {
+            ESP_LOGW(TAG, "[0x%02x at %d] Class %d transfer held back for %d ms", dev->addr, dev->port, cls, CONFIG_I2CDEV_TIMEOUT);
+            return ESP_ERR_TIMEOUT;
+        }
+
+        deferred = true;
+        if (!wake_us || wake_us > deadline)
+            wake_us = deadline;
+        TickType_t ticks = pdMS_TO_TICKS((wake_us - now + 999) / 1000);
+        if (!ticks)
+            ticks = 1;
+        if (sleeps)
+        {
+            // a give left over from a waiter that timed out only wakes this one early
+            xSemaphoreTake(p->gate, ticks);
+            SCHED_LOCK(p);
+            p->waiters--;
+            SCHED_UNLOCK(p);
+        }
+        else
+            vTaskDelay(1); // before the first tick only a claim holds a transfer back, and nothing signals its end
+    }
+}
+
+void i2c_sched_end(const i2c_dev_t *dev, const i2c_sched_slot_t *slot)
+{
+    sched_port_t *p = &ports[dev->port];
+    i2c_dev_class_t cls = dev->bus_class;
+    int64_t now = esp_timer_get_time();
+    uint32_t wait_us = (uint32_t)(slot->started - slot->requested);
+    uint32_t latency_us = (uint32_t)(now - slot->requested);
+    bool drained = false;
+
+    SCHED_LOCK(p);
+    i2c_bus_class_stats_t *s = &p->stats[cls];
+    s->transfers++;
+    s->wait_total_us += wait_us;
+    s->busy_total_us += (uint64_t)(now - slot->started);
+    if (wait_us > s->wait_max_us)
+        s->wait_max_us = wait_us;
+    if (latency_us > s->latency_max_us)
+        s->latency_max_us = latency_us;
+    if (cls == I2C_DEV_CLASS_ACTUATOR)
+    {
+        if (p->tick_us && slot->requested >= p->tick_us && now - p->tick_us > CONFIG_I2CDEV_SCHED_ACTUATOR_WINDOW_US)
+            s->late++;
+        if (p->actuators && --p->actuators == 0)
+            drained = p->actuators_done = true;
+    }
+    uint32_t waiters = drained ? p->waiters : 0;
+    SCHED_UNLOCK(p);
+
+    open_gate(p, waiters);
+}
+
+void i2c_sched_route(i2c_dev_t *dev)
+{
+#if CONFIG_I2CDEV_BACKGROUND_ON_PORT1
+    if (dev->bus_class != I2C_DEV_CLASS_BACKGROUND || dev->port == I2C_NUM_1)
+        return;
+
+    ESP_LOGI(TAG, "[0x%02x at %d] Background device moved to port %d", dev->addr, dev->port, I2C_NUM_1);
+    dev->port = I2C_NUM_1;
+    dev->cfg.sda_io_num = CONFIG_I2CDEV_BACKGROUND_SDA_PIN;
+    dev->cfg.scl_io_num = CONFIG_I2CDEV_BACKGROUND_SCL_PIN;
+#else
+    (void)dev;
+#endif
+}
+
+void i2c_bus_tick(i2c_port_t port)
+{
+    if (port >= I2C_NUM_MAX)
+        return;
+
+    sched_port_t *p = &ports[port];
+    if (!p->gate)
+    {
+        // first tick; until now a held back transfer polled instead
+        p->gate = xSemaphoreCreateCounting(GATE_MAX_WAITERS, 0);
+        if (!p->gate)
+        {
+            ESP_LOGE(TAG, "[Port %d] Could not create scheduler gate", port);
+            return;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    SCHED_LOCK(p);
+    if (p->tick_us)
+        p->period_us = (uint32_t)(now - p->tick_us);
+    p->tick_us = now;
+    p->actuators_done = false;
+    memcpy(p->budget_us, class_budget_us, sizeof(p->budget_us));
+    SCHED_UNLOCK(p);
+}
+
+void i2c_bus_claim(i2c_port_t port)
+{
+    if (port >= I2C_NUM_MAX)
+        return;
+
+    sched_port_t *p = &ports[port];
+    SCHED_LOCK(p);
+    p->actuators++;
+    SCHED_UNLOCK(p);
+}
+
+void i2c_bus_release(i2c_port_t port)
+{
+    if (port >= I2C_NUM_MAX)
+        return;
+
+    sched_port_t *p = &ports[port];
+    bool drained = false;
+    SCHED_LOCK(p);
+    if (p->actuators && --p->actuators == 0)
+        drained = p->actuators_done = true;
+    uint32_t waiters = drained ? p->waiters : 0;
+    SCHED_UNLOCK(p);
+
+    open_gate(p, waiters);
+}
+
+void i2c_bus_actuators_done(i2c_port_t port)
+{
+    if (port >= I2C_NUM_MAX)
+        return;
+
+    sched_port_t *p = &ports[port];
+    bool drained = false;
+    SCHED_LOCK(p);
+    if (!p->actuators && !p->actuators_done)
+        drained = p->actuators_done = true;
+    uint32_t waiters = drained ? p->waiters : 0;
+    SCHED_UNLOCK(p);
+
+    open_gate(p, waiters);
+}
+
+esp_err_t i2c_bus_get_stats(i2c_port_t port, i2c_dev_class_t bus_class, i2c_bus_class_stats_t *stats)
+{
+    if (port >= I2C_NUM_MAX || bus_class >= I2C_DEV_CLASS_MAX || !stats)
+        return ESP_ERR_INVALID_ARG;
+
+    sched_port_t *p = &ports[port];
+    SCHED_LOCK(p);
+    *stats = p->stats[bus_class];
+    SCHED_UNLOCK(p);
+    return ESP_OK;
+}
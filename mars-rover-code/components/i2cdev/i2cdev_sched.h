@@ -0,0 +1,52 @@
+/**
+ * @file i2cdev_sched.h
+ *
+ * Bus scheduler hooks for the i2cdev implementations (not a public API)
+ *
+ * Every transfer of i2c_dev_read(), i2c_dev_write() and friends is
+ * bracketed by i2c_sched_begin() and i2c_sched_end(), which hold back
+ * lower class transfers as described at i2c_bus_tick() and keep the
+ * per class statistics. i2c_sched_route() is called by
+ * i2c_dev_create_mutex() before the device is registered on its port.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2CDEV_SCHED_H__
+#define __I2CDEV_SCHED_H__
+
+#include "i2cdev.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    int64_t requested; // esp_timer time the transfer was asked for
+    int64_t started;   // and let through
+} i2c_sched_slot_t;
+
+/**
+ * @brief Wait until the scheduler lets a transfer of `bytes` bytes start
+ *
+ * @return `ESP_OK` when it may start, `ESP_ERR_TIMEOUT` after
+ *         CONFIG_I2CDEV_TIMEOUT; i2c_sched_end() is due only after `ESP_OK`
+ */
+esp_err_t i2c_sched_begin(const i2c_dev_t *dev, size_t bytes, i2c_sched_slot_t *slot);
+
+/**
+ * @brief The transfer let through by i2c_sched_begin() has ended
+ */
+void i2c_sched_end(const i2c_dev_t *dev, const i2c_sched_slot_t *slot);
+
+/**
+ * @brief Move a background device to its own port when so configured
+ */
+void i2c_sched_route(i2c_dev_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2CDEV_SCHED_H__ */
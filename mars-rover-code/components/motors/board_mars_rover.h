@@ -0,0 +1,61 @@
+#ifndef MOTORS_BOARD_MARS_ROVER_H
+#define MOTORS_BOARD_MARS_ROVER_H
+
+// Included by rover_board.h (CONFIG_MOTORS_BOARD_HEADER); see there for the fields
+
+/*
+ The Mars rover: six wheels on one PCA9685, the four corner ones steered
+ by servos on channels 12..15, the camera on a pan stepper and a tilt servo.
+ The encoder and H-bridge pins come from menuconfig and are not connected
+ while their option is off.
+*/
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+#define MARS_ROVER_ENCODER(wheel, pin) static_cast<gpio_num_t>(CONFIG_MOTORS_ENCODER_##wheel##_GPIO_##pin)
+#else
+#define MARS_ROVER_ENCODER(wheel, pin) GPIO_NUM_NC
+#endif
+#if CONFIG_MOTORS_WHEEL_MCPWM
+#define MARS_ROVER_BRIDGE(wheel, pin) static_cast<gpio_num_t>(CONFIG_MOTORS_MCPWM_##wheel##_GPIO_##pin)
+#else
+#define MARS_ROVER_BRIDGE(wheel, pin) GPIO_NUM_NC
+#endif
+
+struct RoverBoard {
+    static constexpr int16_t FRONT_Y = 300;
+    static constexpr int16_t BACK_Y = -273;
+    static constexpr int16_t SIDE_X = 269;
+
+    static constexpr WheelSpec WHEELS[] = {
+        // tag                 fwd rev  l        d        servo     encoder A, B
+        //                                                              bridge A, B
+        {"RightFrontWheel",    5,  4,  FRONT_Y,  SIDE_X,  13,       MARS_ROVER_ENCODER(RF, A), MARS_ROVER_ENCODER(RF, B),
+                                                                    MARS_ROVER_BRIDGE(RF, A), MARS_ROVER_BRIDGE(RF, B)},
+        {"RightMiddleMotor",   2,  3,  0,        SIDE_X,  NO_SERVO, MARS_ROVER_ENCODER(RM, A), MARS_ROVER_ENCODER(RM, B),
+                                                                    MARS_ROVER_BRIDGE(RM, A), MARS_ROVER_BRIDGE(RM, B)},
+        {"RightBackWheel",     1,  0,  BACK_Y,   SIDE_X,  12,       MARS_ROVER_ENCODER(RB, A), MARS_ROVER_ENCODER(RB, B),
+                                                                    MARS_ROVER_BRIDGE(RB, A), MARS_ROVER_BRIDGE(RB, B)},
+        {"LeftFrontWheel",    10, 11,  FRONT_Y, -SIDE_X,  15,       MARS_ROVER_ENCODER(LF, A), MARS_ROVER_ENCODER(LF, B),
+                                                                    MARS_ROVER_BRIDGE(LF, A), MARS_ROVER_BRIDGE(LF, B)},
+        {"LeftMiddleMotor",    9,  8,  0,       -SIDE_X,  NO_SERVO, MARS_ROVER_ENCODER(LM, A), MARS_ROVER_ENCODER(LM, B),
+                                                                    MARS_ROVER_BRIDGE(LM, A), MARS_ROVER_BRIDGE(LM, B)},
+        {"LeftBackWheel",      6,  7,  BACK_Y,  -SIDE_X,  14,       MARS_ROVER_ENCODER(LB, A), MARS_ROVER_ENCODER(LB, B),
+                                                                    MARS_ROVER_BRIDGE(LB, A), MARS_ROVER_BRIDGE(LB, B)},
+    };
+
+    // atan(FRONT_Y / SIDE_X) and atan(-BACK_Y / SIDE_X)
+    static constexpr float SPIN_FRONT_ANGLE = 48.11847f;
+    static constexpr float SPIN_BACK_ANGLE = 45.42284f;
+
+    static constexpr CameraSpec CAMERA = {
+        .stepper_en = GPIO_NUM_0,
+        .stepper_dir = GPIO_NUM_27,
+        .stepper_step = GPIO_NUM_26,
+        .tilt_servo = GPIO_NUM_4,
+        .enable_level = 0,          // A4988 is enabled on low level
+    };
+};
+
+#undef MARS_ROVER_ENCODER
+#undef MARS_ROVER_BRIDGE
+
+#endif
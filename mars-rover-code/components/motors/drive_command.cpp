@@ -0,0 +1,15 @@
+#include "drive_command.h"
+
+void DriveCommandMailbox::post(const DriveCommand& cmd) {
+    slots[back] = cmd;
+    // the written slot becomes the middle one, the producer continues in the old middle
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+bool DriveCommandMailbox::take(DriveCommand& out) {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+    front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+    out = slots[front];
+    return true;
+}
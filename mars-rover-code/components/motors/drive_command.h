@@ -0,0 +1,62 @@
+#ifndef MOTORS_DRIVE_COMMAND_H
+#define MOTORS_DRIVE_COMMAND_H
+
+#include <atomic>
+#include <cstdint>
+
+// When a controller report went through the input path, esp_timer us; all 0 when not timed
+struct InputTiming {
+    int64_t rx_us;      // report received (L2CAP)
+    int64_t parsed_us;  // report parsed into the controller state
+    int64_t posted_us;  // command posted to the mailbox
+};
+
+// Driver input for one controller report
+struct DriveCommand {
+    int16_t speed;      // rover speed, internal units (see DriveSystem::set())
+    float angle;        // rover angle, degrees
+    bool spin;          // spin in place with throttle/brake instead of speed/angle
+    int16_t throttle;   // 0-512
+    int16_t brake;      // 0-512
+    InputTiming timing;
+};
+
+/*
+ Wait-free hand-over of DriveCommands from one producer thread (Bluetooth)
+ to one consumer (the drive tick).
+
+ Commands go through a triple buffer: the producer always has a slot of its
+ own to write, the consumer always reads a complete one, and neither side
+ ever waits for the other. Only the latest command matters, older ones that
+ were not taken yet are overwritten.
+
+ The emergency stop is a separate lane: a flag that can be raised from any
+ thread and is never lost or overwritten by later commands.
+*/
+class DriveCommandMailbox {
+public:
+    // Producer: publish cmd as the latest command
+    void post(const DriveCommand& cmd);
+
+    // Consumer: copy the latest command to out if one was posted since the last take
+    bool take(DriveCommand& out);
+
+    // Any thread: request an emergency stop
+    void emergency_stop() { stop_requested.store(true, std::memory_order_release); }
+
+    // Consumer: true once per emergency stop request
+    bool take_emergency_stop() { return stop_requested.exchange(false, std::memory_order_acquire); }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x03;
+    static constexpr uint8_t FRESH = 0x04;     // middle slot holds a command not taken yet
+
+    DriveCommand slots[3]{};
+    uint8_t back{0};                           // producer's slot
+    uint8_t front{1};                          // consumer's slot
+    std::atomic<uint8_t> middle{2};            // slot being handed over, | FRESH
+
+    std::atomic<bool> stop_requested{false};
+};
+
+#endif
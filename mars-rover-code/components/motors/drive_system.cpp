@@ -1,61 +1,92 @@
 #include "drive_system.h"
+#include "kinematics.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "sdkconfig.h"
+#include <algorithm>
 
+static_assert(!board_detail::uses_pin(Board::WHEELS, Board::CAMERA, I2C_MASTER_SDA_IO) &&
+              !board_detail::uses_pin(Board::WHEELS, Board::CAMERA, I2C_MASTER_SCL_IO),
+    "a board pin is on the PCA9685 I2C bus");
 
 DriveSystem::DriveSystem(i2c_dev_t* pca9685)
     : buffer{new PCA9685Buffer{pca9685}},
-    right_back{
-        1, 0,
-        "RightBackWheel",
-        Cfg::BACK_Y, Cfg::RIGHT_X,
-        12},
-    right_middle{
-        2, 3, 
-        "RightMiddleMotor",
-        0, Cfg::RIGHT_X},
-    right_front{
-        5, 4,
-        "RightFrontWheel", 
-        Cfg::FRONT_Y, Cfg::RIGHT_X,
-        13},
-
-    left_back {
-        6, 7,
-        "LeftBackWheel",
-        Cfg::BACK_Y, Cfg::LEFT_X,
-        14},
-    left_middle {
-        9, 8,
-        "LeftMiddleMotor",
-        0, Cfg::LEFT_X},
-    left_front {
-        10, 11,
-        "LeftFrontWheel",
-        Cfg::FRONT_Y, Cfg::LEFT_X,
-        15},
-
+    trace{new TraceRing},
     mem_speed{0}, mem_angle{0.0f}, dest_speed{0}, dest_angle{0.0f}, actual_speed{0.0f} // <<< ІНІЦІАЛІЗАЦІЯ
 {
-    all_steerable_wheels[0] = &right_back;
-    all_steerable_wheels[1] = &right_front;
-    all_steerable_wheels[2] = &left_back;
-    all_steerable_wheels[3] = &left_front;
-
-    all_wheels[0] = &right_front;
-    all_wheels[1] = &right_middle;
-    all_wheels[2] = &right_back;
+    steering_cache.build(wheels);
+
+#if CONFIG_MOTORS_WHEEL_MCPWM
+    // H-bridge A and B pins, Board::WHEELS order
+    gpio_num_t motor_pins[6][2];
+    for (uint8_t i = 0; i < 6; i++) {
+        motor_pins[i][0] = Board::WHEELS[i].bridge_a;
+        motor_pins[i][1] = Board::WHEELS[i].bridge_b;
+    }
+    bool motors_on_pca = wheel_pwm.init(motor_pins) != ESP_OK;
+    if (!motors_on_pca) {
+        wheels.for_each([this](uint8_t i, auto& wheel) { wheel.set_pwm_output(&wheel_pwm, i); });
+    } else {
+        ESP_LOGE(TAG, "No MCPWM, wheel motors stay on the PCA9685");
+    }
+#else
+    bool motors_on_pca = true;
+#endif
+    // an emergency stop turns these off and leaves the steering servos alone
+    if (motors_on_pca) {
+        for (const WheelSpec& w : Board::WHEELS) {
+            buffer->set_motor_channel(w.pca_fwd);
+            buffer->set_motor_channel(w.pca_rev);
+        }
+    }
 
-    all_wheels[3] = &left_front;
-    all_wheels[4] = &left_middle;
-    all_wheels[5] = &left_back;
+#if CONFIG_PCA9685_BUFFER_ASYNC_FLUSH
+    // I2C writes go to their own task so tick() never waits for the bus;
+    // on failure flush() keeps writing synchronously
+    buffer->start_async("pca9685_flush", CONFIG_PCA9685_BUFFER_FLUSH_TASK_PRIORITY, 1);
+#endif
+
+    // A failed bus write leaves the wheels at their last good frame instead of
+    // rebooting the rover; this task resets the bus and resends the frame
+    buffer->start_recovery("pca9685_recovery", CONFIG_PCA9685_BUFFER_RECOVERY_TASK_PRIORITY);
+
+    // tick() only pushes binary records, formatting and output happen here
+#if CONFIG_MOTORS_TRACE_DRAIN_TEXT
+    trace->set_drain_mode(TraceRing::DrainMode::TEXT);
+#elif CONFIG_MOTORS_TRACE_DRAIN_RAW
+    trace->set_drain_mode(TraceRing::DrainMode::RAW);
+#endif
+    trace->start_drain("motors_trace", CONFIG_MOTORS_TRACE_DRAIN_TASK_PRIORITY);
+
+#if CONFIG_MOTORS_IMU
+    // same bus as the PCA9685s; its task reads it between the frames
+    if (imu.init(I2C_NUM_0, I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO) == ESP_OK) {
+        imu.start_task("imu_read", CONFIG_MOTORS_IMU_TASK_PRIORITY, 1, buffer);
+    } else {
+        ESP_LOGE(TAG, "No IMU, heading hold off");
+    }
+#endif
+
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    // A and B pins, Board::WHEELS order
+    gpio_num_t encoder_pins[6][2];
+    for (uint8_t i = 0; i < 6; i++) {
+        encoder_pins[i][0] = Board::WHEELS[i].encoder_a;
+        encoder_pins[i][1] = Board::WHEELS[i].encoder_b;
+    }
+    if (encoders.init(encoder_pins) != ESP_OK) {
+        ESP_LOGE(TAG, "No wheel encoders, driving open loop");
+    }
+#endif
 
     // Initialize stepper motor for camera pan
     StepperMotor::Config stepper_config = {
-        .gpio_en = GPIO_NUM_0,          // Enable pin
-        .gpio_dir = GPIO_NUM_27,        // Direction pin
-        .gpio_step = GPIO_NUM_26,       // Step pin
-        .servo_pin = GPIO_NUM_4,        // Servo pin for vertical tilt
-        .enable_level = 0,              // A4988 is enabled on low level
+        .gpio_en = Board::CAMERA.stepper_en,
+        .gpio_dir = Board::CAMERA.stepper_dir,
+        .gpio_step = Board::CAMERA.stepper_step,
+        .servo_pin = Board::CAMERA.tilt_servo,  // Servo pin for vertical tilt
+        .enable_level = Board::CAMERA.enable_level,
         .resolution_hz = 1000000,       // 1MHz resolution
         .min_speed_hz = 500,            // Minimum speed 500Hz
         .max_speed_hz = 1200,           // Maximum speed 1200Hz (reduced for better control)
@@ -74,72 +105,177 @@ DriveSystem::DriveSystem(i2c_dev_t* pca9685)
     }
 }
 
+DriveSystem::~DriveSystem() {
+#if CONFIG_MOTORS_IMU
+    // the IMU read task uses the imu member and the buffer, it goes before either
+    imu.stop_task();
+#endif
+}
+
 void DriveSystem::print_angles() {
     ESP_LOGI(TAG, "rightBack: %.2f | rightFront: %.2f | leftBack: %.2f | lefftFront: %.2f",
-            right_back.get_angle(), right_front.get_angle(), left_back.get_angle(), left_front.get_angle());
+            wheels.steerable_at<Board::RIGHT_BACK>().get_angle(), wheels.steerable_at<Board::RIGHT_FRONT>().get_angle(),
+            wheels.steerable_at<Board::LEFT_BACK>().get_angle(), wheels.steerable_at<Board::LEFT_FRONT>().get_angle());
 }
 
-void DriveSystem::move_with_angle(int16_t speed, float rvr_angle) {
-    int32_t rvr_radius;
-    if (fabsf(rvr_angle) <= 1.0f) {
-        rvr_radius = 16001;
+void DriveSystem::update_steering(float rvr_angle) {
+    if (rvr_angle == 0.0f) {
+        wheels.for_each([this](uint8_t i, auto& wheel) {
+            wheel.update_geometry(Kinematics::STRAIGHT_RADIUS);
+            speed_ratio[i] = SteeringCache::RATIO_ONE;
+        });
     } else {
-        float alpha_rad = rvr_angle * PI / 180.0f;
-        rvr_radius = static_cast<int32_t>(Cfg::FRONT_Y / tanf(alpha_rad));
+        SteeringCache::Solution steering;
+        steering_cache.lookup(rvr_angle, steering);
+
+        for (uint8_t i = 0; i < 4; i++) wheels.steerable(i).set_steering(steering.angle[i], steering.duty[i]);
+        for (uint8_t i = 0; i < 6; i++) speed_ratio[i] = steering.ratio[i];
     }
 
-    for (uint8_t i = 0; i < 6; i++) all_wheels[i]->update_geometry(rvr_radius);
+    geometry_angle = rvr_angle;
+    geometry_valid = true;
+}
 
-    if (fabsf(rvr_angle) <= 1.0f) {
-        for (uint8_t i = 0; i < 6; i++) all_wheels[i]->update_buffer(speed, buffer);
+void DriveSystem::move_with_angle(int16_t speed, float rvr_angle, float trim) {
+    // every angle within STRAIGHT_ANGLE has the same (straight) geometry; the
+    // trim goes on top, it steers by less than that too
+    if (fabsf(rvr_angle) <= Kinematics::STRAIGHT_ANGLE) rvr_angle = 0.0f;
+    rvr_angle += trim;
 
-    } else {
+    if (!geometry_valid || rvr_angle != geometry_angle) {
+        update_steering(rvr_angle);
+        outputs_valid = false;
+    }
 
-        uint32_t radii[6];
-        for (int i = 0; i < 6; i++) radii[i] = all_wheels[i]->get_radius();
+    // buffer already holds exactly this speed and steering; flush() still
+    // resends channels a failed write left behind (sync mode); a speed loop
+    // changes the commands every tick while the wheels turn
+    if (outputs_valid && speed == applied_speed && (speed == 0 || !closed_loop())) {
+        flush_buffer();
+        return;
+    }
 
-        uint32_t maxR = radii[0];
-        for (int i = 1; i < 6; i++)
-            if (radii[i] > maxR)
-                maxR = radii[i];
+    wheels.for_each([&](uint8_t i, auto& wheel) {
+        int16_t wheel_speed = static_cast<int16_t>(
+            static_cast<int32_t>(speed) * speed_ratio[i] / static_cast<int32_t>(SteeringCache::RATIO_ONE));
+        //ESP_LOGI("DriveSystem", "wheel %d: ratio=%u, wheel_speed=%d", i, speed_ratio[i], wheel_speed);
 
-        float rot_speed = static_cast<float>(speed) /  static_cast<float>(maxR);
-        //ESP_LOGI(TAG, "maxR=%u, speed=%d", maxR, speed);
-        for (int i = 0; i < 6; i++) {
-            int16_t wheel_speed = static_cast<int16_t>(rot_speed * static_cast<float>(radii[i]));
-            //ESP_LOGI("DriveSystem", "wheel %d: radius=%u, wheel_speed=%d, rot_speed=%.2f", i, radii[i], wheel_speed, rot_speed);
+        wheel_setpoint[i] = wheel_speed;
+        wheel.update_buffer(wheel_command(i, wheel_speed), buffer);
+    });
 
-            all_wheels[i]->update_buffer(wheel_speed, buffer);
-        }
-    }
+    applied_speed = speed;
+    outputs_valid = true;
 
-    buffer->flush();
+    flush_buffer();
 }
 
 void DriveSystem::rotate_in_place(int16_t speed) {
+    // Spinning moves the wheels away from any cached steering
+    geometry_valid = false;
+    outputs_valid = false;
+
     // Set speeds for spinning
 
     uint32_t radii[6];
-    for (int i = 0; i < 6; i++) radii[i] = all_wheels[i]->spin_radius;
+    wheels.for_each([&](uint8_t i, const auto& wheel) { radii[i] = wheel.spin_radius; });
 
     uint32_t maxR = radii[0];
     for (int i = 1; i < 6; i++)
         if (radii[i] > maxR)
             maxR = radii[i];
 
-    float rot_speed = static_cast<float>(speed) /  static_cast<float>(maxR);
+    // the right wheels (0..2) turn forward, the left ones backward
+    wheels.for_each([&](uint8_t i, auto& wheel) {
+        int16_t wheel_speed = Kinematics::Active::wheel_speed(speed, radii[i], maxR);
+        if (i >= 3) wheel_speed = -wheel_speed;
+        wheel_setpoint[i] = wheel_speed;
+        wheel.update_buffer(wheel_command(i, wheel_speed), buffer);
+    });
+
+    flush_buffer();
+}
+
+bool DriveSystem::closed_loop() const {
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    return encoders.is_ready();
+#else
+    return false;
+#endif
+}
 
-    for (int i = 0; i < 3; i++) {
-        int16_t wheel_speed = static_cast<int16_t>(rot_speed * static_cast<float>(radii[i]));
-        all_wheels[i]->update_buffer(wheel_speed, buffer);
+int16_t DriveSystem::wheel_command(uint8_t i, int16_t setpoint) {
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    if (encoders.is_ready()) return wheel_pi[i].update(setpoint, encoders.get_speed(i), wheel_pi_ki_dt);
+#else
+    (void)i;
+#endif
+    return setpoint;
+}
+
+void DriveSystem::update_odometry(uint32_t dt_us) {
+    if (odometry_reset_requested.exchange(false, std::memory_order_relaxed)) {
+        odometry.reset();
+#if CONFIG_MOTORS_IMU
+        imu.reset(0);
+        heading_hold_active = false;
+#endif
     }
 
-    for (int i = 3; i < 6; i++) {
-        int16_t wheel_speed = static_cast<int16_t>(rot_speed * static_cast<float>(radii[i]));
-        all_wheels[i]->update_buffer(-wheel_speed, buffer);
+    // from the (unsteered) middle wheels
+    constexpr uint8_t right = Board::RIGHT_MIDDLE;
+    constexpr uint8_t left = Board::LEFT_MIDDLE;
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    if (encoders.is_ready()) {
+        odometry.update(Odometry::counts_to_um(encoders.get_delta(right)), Odometry::counts_to_um(encoders.get_delta(left)));
+        return;
     }
+#endif
+    uint32_t scale = Odometry::speed_scale(dt_us);
+    odometry.update(Odometry::speed_to_um(wheel_setpoint[right], scale), Odometry::speed_to_um(wheel_setpoint[left], scale));
+}
 
+void DriveSystem::update_heading_hold() {
+#if CONFIG_MOTORS_IMU
+    // only while driving straight on with the stick centred
+    bool driving = (current_state == DriveState::MOVING || current_state == DriveState::ACCELERATING) && mem_speed != 0;
+    if (!imu.is_ready() || !driving || fabsf(dest_angle) > Kinematics::STRAIGHT_ANGLE) {
+        heading_hold_active = false;
+        heading_trim = 0.0f;
+        return;
+    }
+
+    // on the gyro alone: the fused yaw follows the odometry, which never sees the drift
+    // being held off (and without encoders already turns with the trim)
+    if (!heading_hold_active) {
+        heading_hold_active = true;
+        held_heading = imu.get_gyro_yaw();
+    }
+
+    // heading error, counter-clockwise; a positive rover angle turns clockwise going
+    // forward and counter-clockwise reversing
+    float error = static_cast<int32_t>(held_heading - imu.get_gyro_yaw()) * (360.0f / 4294967296.0f);
+    float trim = -error * Cfg::HEADING_HOLD_KP;
+    if (mem_speed < 0) trim = -trim;
+    heading_trim = std::clamp(trim, -Cfg::HEADING_HOLD_MAX_TRIM, Cfg::HEADING_HOLD_MAX_TRIM);
+#endif
+}
+
+void DriveSystem::flush_buffer() {
+#if CONFIG_MOTORS_TICK_STATS
+    uint32_t start = esp_cpu_get_cycle_count();
+    buffer->flush();
+    flush_cycles += esp_cpu_get_cycle_count() - start;
+
+    // first flush since a timed controller command was taken: its PWM values have left
+    // the tick (on the bus when flushing synchronously, handed to the flush task otherwise)
+    if (input_pending) {
+        stats.record_input(input_timing, input_taken_us, esp_timer_get_time());
+        input_pending = false;
+    }
+#else
     buffer->flush();
+#endif
 }
 
 
@@ -175,9 +311,9 @@ void DriveSystem::handle_idle() {
     if (mem_angle) {
         if (fabsf(mem_angle) > 1.0f) {
             if (dest_angle > mem_angle) {
-                mem_angle += Cfg::SERVO_SPEED;
+                mem_angle += angle_step();
             } else {
-                mem_angle -= Cfg::SERVO_SPEED;
+                mem_angle -= angle_step();
             }
         } else {
             mem_angle = 0;
@@ -186,32 +322,15 @@ void DriveSystem::handle_idle() {
 }
 
 void DriveSystem::handle_accelerating() {
-    // just a simple acceleration towards dest_speed
-    if (dest_speed > mem_speed) {
-        if (mem_speed > 0) {
-            mem_speed = std::min(dest_speed, 
-                             static_cast<int16_t>(mem_speed + Cfg::DC_ACCEL));
-        } else {
-            mem_speed = std::min(dest_speed, 
-                                 static_cast<int16_t>(mem_speed + Cfg::DC_DECEL));
-        }
-    }
-    else if (dest_speed < mem_speed) {
-        if (mem_speed > 0) {
-            mem_speed = std::max(dest_speed,
-                                 static_cast<int16_t>(mem_speed - Cfg::DC_DECEL));
-        } else {
-            mem_speed = std::max(dest_speed, 
-                                 static_cast<int16_t>(mem_speed - Cfg::DC_ACCEL));
-        }
-    }
+    // S-curve towards dest_speed: DC_ACCEL speeding up, DC_DECEL slowing down
+    mem_speed = profile_step(dest_speed, Cfg::DC_DECEL);
     
     // Smooth steering towards target angle
     if (fabsf(dest_angle - mem_angle) > 0.5f) {
         if (dest_angle > mem_angle) {
-            mem_angle += Cfg::SERVO_SPEED / 2;
+            mem_angle += angle_step() / 2;
         } else {
-            mem_angle -= Cfg::SERVO_SPEED / 2;
+            mem_angle -= angle_step() / 2;
         }
     } else {
         mem_angle = dest_angle;
@@ -220,20 +339,14 @@ void DriveSystem::handle_accelerating() {
 
 void DriveSystem::handle_moving() {
     // Слідкуємо за невеликими змінами швидкості
-    if (dest_speed > mem_speed) {
-        mem_speed = std::min(dest_speed, 
-                             static_cast<int16_t>(mem_speed + Cfg::DC_ACCEL));
-    } else if (dest_speed < mem_speed) {
-        mem_speed = std::max(dest_speed, 
-                             static_cast<int16_t>(mem_speed - Cfg::DC_ACCEL));
-    }
+    mem_speed = profile_step(dest_speed, Cfg::DC_ACCEL);
     
     // Обертання коліс без сильних ривків
     if (fabsf(dest_angle - mem_angle) > 1.0f) {
         if (dest_angle > mem_angle) {
-            mem_angle += Cfg::SERVO_SPEED;
+            mem_angle += angle_step();
         } else {
-            mem_angle -= Cfg::SERVO_SPEED;
+            mem_angle -= angle_step();
         }
     }
 }
@@ -246,54 +359,67 @@ void DriveSystem::handle_turning() {
         Cfg::MOTOR_INTERNAL_MAX * (1.0f - turn_percentage * 0.8f)  //TODO: tune factor
     );
     
+    // Slow down to max_turn_speed, or speed up towards dest_speed as far as max_turn_speed
+    int16_t target = mem_speed;
     if (std::abs(mem_speed) > max_turn_speed) {
-        if (mem_speed > 0) mem_speed = std::max(                      max_turn_speed,  static_cast<int16_t>(mem_speed - Cfg::DC_DECEL));
-        else               mem_speed = std::min(static_cast<int16_t>(-max_turn_speed), static_cast<int16_t>(mem_speed + Cfg::DC_DECEL));
+        target = mem_speed > 0 ? max_turn_speed : static_cast<int16_t>(-max_turn_speed);
     } else if (std::abs(dest_speed) > max_turn_speed) {
-        if (dest_speed > 0) mem_speed = std::min(static_cast<int16_t>(mem_speed + Cfg::DC_ACCEL),                       max_turn_speed );
-        else                mem_speed = std::max(static_cast<int16_t>(mem_speed - Cfg::DC_ACCEL), static_cast<int16_t>(-max_turn_speed));
+        target = dest_speed > 0 ? max_turn_speed : static_cast<int16_t>(-max_turn_speed);
     }
+    mem_speed = profile_step(target, Cfg::DC_DECEL);
 
     // Faster steering towards target angle
     if (dest_angle > mem_angle) {
-        mem_angle = std::min(dest_angle, mem_angle + Cfg::SERVO_SPEED);
+        mem_angle = std::min(dest_angle, mem_angle + angle_step());
     } else {
-        mem_angle = std::max(dest_angle, mem_angle - Cfg::SERVO_SPEED);
+        mem_angle = std::max(dest_angle, mem_angle - angle_step());
     }
 }
 
 void DriveSystem::handle_stopping() {
     if (mem_speed != 0) {
         // Обчислюємо час ковзання залежно від швидкості
-        // Формула: час = |швидкість| * INERTIA_TICKS_PER_UNIT
-        uint16_t calculated_ticks = static_cast<uint16_t>(
-            std::abs(mem_speed) * Cfg::INERTIA_TICKS_PER_UNIT
-        );
+        // Формула: час = |швидкість| * INERTIA_US_PER_UNIT
+        uint32_t calculated_us = std::abs(mem_speed) * Cfg::INERTIA_US_PER_UNIT;
         
         // Обмежуємо максимальним часом
-        inertia_ticks_remaining = std::min(calculated_ticks, Cfg::MAX_INERTIA_TICKS);
+        inertia_us_remaining = std::min(calculated_us, Cfg::MAX_INERTIA_US);
         inertia_speed = mem_speed;
         
         mem_speed = 0;
         
-        ESP_LOGD(TAG, "STOPPING: Inertia time = %u ticks (~%.1f sec)", 
-                 inertia_ticks_remaining, inertia_ticks_remaining * 0.01f);
+        ESP_LOGD(TAG, "STOPPING: Inertia time = %.2f sec", inertia_us_remaining / 1000000.0f);
     }
 
+    int16_t decay = static_cast<int16_t>(Cfg::INERTIA_DECAY * tick_dt_us / 1000000);
     if (inertia_speed > 0) {
-        inertia_speed -= Cfg::UINT_PER_INERTIA_TICKS;
+        inertia_speed -= decay;
         if (inertia_speed < 0) inertia_speed = 0;
     } else  {
-        inertia_speed += Cfg::UINT_PER_INERTIA_TICKS;
+        inertia_speed += decay;
         if (inertia_speed > 0) inertia_speed = 0;
     }
 }
 
 void DriveSystem::apply_inertia() {
     // Apply inertia effect if we are in STOPPING
-    if (inertia_ticks_remaining > 0) {
-        inertia_ticks_remaining--;
+    inertia_us_remaining -= std::min(inertia_us_remaining, tick_dt_us);
+}
+
+int16_t DriveSystem::profile_step(int16_t target, uint32_t decel) {
+    return speed_profile.step(mem_speed, target, Cfg::DC_ACCEL, decel, Cfg::DC_JERK, tick_dt_us);
+}
+
+int16_t DriveSystem::speed_step(uint32_t units_per_s, int8_t direction) {
+    // a remainder left by a ramp the other way or at another rate does not belong to this one
+    if (direction != speed_step_direction || units_per_s != speed_step_limit) {
+        speed_step_remainder = 0;
+        speed_step_direction = direction;
+        speed_step_limit = units_per_s;
     }
+    uint32_t scaled = units_per_s * tick_dt_us + speed_step_remainder;
+    speed_step_remainder = scaled % 1000000;
+    return static_cast<int16_t>(scaled / 1000000);
 }
 
 void DriveSystem::update_state() {
@@ -358,7 +484,7 @@ void DriveSystem::update_state() {
             break;
 
         case DriveState::STOPPING:
-            if (inertia_ticks_remaining > 0) {
+            if (inertia_us_remaining > 0) {
                 if (is_spinning) {
                     break;
                 } else if (dest_speed > actual_speed && dest_speed > 50) {
@@ -368,7 +494,7 @@ void DriveSystem::update_state() {
                     current_state = DriveState::ACCELERATING;
                     state_tick_counter = 0;
                 }
-            } else if (inertia_ticks_remaining == 0) {
+            } else if (inertia_us_remaining == 0) {
                 if (is_spinning) {
                     current_state = DriveState::SPINNING;
                     state_tick_counter = 0;
@@ -380,10 +506,8 @@ void DriveSystem::update_state() {
             break;
 
         case DriveState::SPINNING:
-            static uint16_t not_spinning_counter = 0;
-
             if (!is_spinning) {
-                if (not_spinning_counter > Cfg::SPIN_DEACTIVATE_TICKS) {
+                if (not_spinning_us > Cfg::SPIN_DEACTIVATE_US) {
                     // If spin inputs are released for enough time, stop spinning
                     is_spinning = false;
                     current_state = DriveState::IDLE;
@@ -391,20 +515,137 @@ void DriveSystem::update_state() {
                     mem_speed = 0;
                     mem_angle = 0.0f;
                 } else {
-                    not_spinning_counter++;
+                    not_spinning_us += tick_dt_us;
                 }
             } else {
-                not_spinning_counter = 0;
+                not_spinning_us = 0;
             }
             break;
     }
 }
 
-void DriveSystem::tick() {
+void DriveSystem::apply_commands() {
+    DriveCommand cmd;
+    bool have_cmd = commands.take(cmd);
+    bool halt_requested = commands.take_emergency_stop();
+
+    if (replay_tick) {
+        if (halt_requested) {
+            // a real emergency stop ends the replay
+            session.replay_end();
+            trace_flags |= TRACE_REPLAY_END;
+        } else {
+            // live input is dropped, the session drives from a standing start
+            have_cmd = false;
+            if (session.replay_begin()) {
+                halt();
+                trace_flags |= TRACE_REPLAY_START;
+            }
+
+            if (!session.replay_advance(tick_dt_us)) {
+                // nobody commands what the session left in force (a session cut
+                // mid-drive, rover_record stop): rest until live input comes
+                session.replay_end();
+                halt();
+                trace_flags |= TRACE_REPLAY_END;
+            } else {
+                GamepadSample sample;
+                while (session.take_due(sample)) {
+                    if (sample.flags & GAMEPAD_SAMPLE_DISCONNECT) {
+                        halt_requested = true;
+                    } else {
+                        cmd = gamepad_drive_command(sample);
+                        have_cmd = true;
+                    }
+                }
+            }
+        }
+    }
+
+    if (have_cmd) {
+#if CONFIG_MOTORS_TICK_STATS
+        // the Bluetooth thread runs on the other core: esp_timer time, not cycles
+        if (cmd.timing.rx_us) {
+            input_timing = cmd.timing;
+            input_taken_us = esp_timer_get_time();
+            input_pending = true;
+        }
+#endif
+        if (cmd.spin) {
+            set_spin_input(cmd.throttle, cmd.brake);
+        } else {
+            stop_spinning();
+            set(cmd.speed, cmd.angle);
+        }
+    }
+
+    // the stop overrides whatever came with the command
+    if (halt_requested) {
+        trace_flags |= TRACE_EMERGENCY_STOP;
+        halt();
+    }
+}
+
+void DriveSystem::halt() {
+    stop_spinning();
+    set(0, 0.0f);
+    inertia_speed = 0;
+    inertia_us_remaining = 0;
+    actual_speed = 0.0f;
+    mem_angle = 0.0f;
+    speed_step_remainder = 0;
+    speed_step_direction = 0;
+    speed_profile.reset(0);
+    not_spinning_us = 0;
+    current_state = DriveState::IDLE;
+    previous_state = DriveState::IDLE;
+    state_tick_counter = 0;
+    stop();
+}
+
+void DriveSystem::tick(uint32_t dt_us) {
+#if CONFIG_MOTORS_TICK_STATS
+    stats.apply_reset();
+    uint32_t tick_start = esp_cpu_get_cycle_count();
+    flush_cycles = 0;
+#endif
+
+    // the bus is the PCA9685s' until this tick's frame is out
+    i2c_bus_tick(buffer->get_port());
+
+    replay_tick = session.get_mode() == InputSession::Mode::REPLAYING;
+
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    // wheel speeds over the whole time since the last tick, even after a stall
+    encoders.sample(dt_us);
+#endif
+    // the wheels moved at the previous tick's outputs until now
+    update_odometry(dt_us);
+#if CONFIG_MOTORS_IMU
+    bool standing = inertia_us_remaining == 0 &&
+        std::all_of(wheel_setpoint, wheel_setpoint + 6, [](int16_t s) { return s == 0; });
+    imu.update(odometry.get_heading(), standing);
+#endif
+
+    // the sensors saw the measured time; a replay runs the drive model on nominal
+    // tick time, so it gives the same outputs however the ticks are timed
+    tick_dt_us = replay_tick ? Cfg::TICK_PERIOD_US : std::min(dt_us, Cfg::MAX_TICK_DT_US);
+    trace_flags = 0;
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    wheel_pi_ki_dt = WheelSpeedPI::integral_gain(tick_dt_us);
+#endif
+
+    apply_commands();
+
     update_state();
+    update_heading_hold();
+
+#if CONFIG_MOTORS_TICK_STATS
+    // an emergency stop flushes from apply_commands(), that belongs to the flush phase
+    uint32_t state_end = esp_cpu_get_cycle_count();
+    stats.phase[TickStats::PHASE_STATE].record(state_end - tick_start - flush_cycles);
+#endif
 
-    print_state();
-    
     switch (current_state) {
         case DriveState::IDLE:
             handle_idle();
@@ -429,29 +670,101 @@ void DriveSystem::tick() {
     // Apply innertian
     // it is used mainly in STOPPING state
     apply_inertia();
+
+#if CONFIG_MOTORS_TICK_STATS
+    uint32_t handler_end = esp_cpu_get_cycle_count();
+    stats.phase[TickStats::PHASE_HANDLER].record(handler_end - state_end);
+    uint32_t state_flush_cycles = flush_cycles;
+#endif
     
     // And now apply actual speed depending on state
     if (current_state == DriveState::SPINNING) {
         rotate_in_place(mem_speed);
     } else {
-        move_with_angle(mem_speed, mem_angle);
+        move_with_angle(mem_speed, mem_angle, heading_trim);
     }
+
+#if CONFIG_MOTORS_IMU
+    // the IMU is read after the frame, so its reads never hold a frame back
+    imu.frame_flushed();
+#endif
+
+#if CONFIG_MOTORS_TICK_STATS
+    uint32_t outputs_end = esp_cpu_get_cycle_count();
+    stats.phase[TickStats::PHASE_KINEMATICS].record(
+        outputs_end - handler_end - (flush_cycles - state_flush_cycles));
+    stats.phase[TickStats::PHASE_FLUSH].record(flush_cycles);
+#endif
+
+    int64_t now_us = esp_timer_get_time();
+    publish_snapshot(now_us);
+    push_trace(now_us);
+
+#if CONFIG_MOTORS_TICK_STATS
+    uint32_t tick_cycles = esp_cpu_get_cycle_count() - tick_start;
+    stats.phase[TickStats::PHASE_TICK].record(tick_cycles);
+    if (tick_cycles > Cfg::TICK_PERIOD_US * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ) {
+        stats.tick_overruns.store(stats.tick_overruns.load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+    }
+#endif
 }
-            
-void DriveSystem::print_state() {
-    [[maybe_unused]] const char* state_names[] = {
-        "IDLE", "ACCELERATING", "MOVING", "TURNING", "STOPPING", "SPINNING"
-    };
-    ESP_LOGI(TAG, "State: %s | Speed: %d/%d | Angle: %.1f/%.1f | Inertia: %u | Spinning: %s",
-            state_names[static_cast<int>(current_state)],
-            mem_speed, dest_speed,
-            mem_angle, dest_angle,
-            inertia_ticks_remaining,
-            is_spinning ? "YES" : "NO");
+
+void DriveSystem::publish_snapshot(int64_t now_us) {
+    RoverStateSnapshot s{};
+    s.seq = snapshot.sequence() + 1;
+    s.time_us = now_us;
+    s.state = current_state;
+    s.spinning = is_spinning;
+    s.mem_speed = mem_speed;
+    s.dest_speed = dest_speed;
+    s.mem_angle = mem_angle;
+    s.dest_angle = dest_angle;
+    s.inertia_speed = inertia_speed;
+    s.inertia_us_remaining = inertia_us_remaining;
+    wheels.for_each([&s](uint8_t i, const auto& wheel) { s.wheel_pwm[i] = wheel.get_wheel_duty(); });
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    for (uint8_t i = 0; i < 6; i++) s.wheel_speed[i] = encoders.get_speed(i);
+#endif
+    s.pose = odometry.get_pose();
+#if CONFIG_MOTORS_IMU
+    s.imu_yaw_deg = imu.get_yaw_deg();
+#endif
+    s.heading_trim = heading_trim;
+    for (uint8_t i = 0; i < 4; i++) {
+        s.servo_duty[i] = wheels.steerable(i).get_duty();
+        s.wheel_angle[i] = wheels.steerable(i).get_angle();
+    }
+    snapshot.store(s);
+
+    if (replay_tick && session.get_mode() == InputSession::Mode::REPLAYING) session.replay_outputs(s);
+}
+
+void DriveSystem::push_trace(int64_t now_us) {
+    TraceRecord rec;
+    rec.seq = snapshot.sequence();
+    rec.time_us = static_cast<uint32_t>(now_us);
+    rec.state = static_cast<uint8_t>(current_state);
+    rec.flags = trace_flags | (is_spinning ? TRACE_SPINNING : 0);
+    rec.mem_speed = mem_speed;
+    rec.dest_speed = dest_speed;
+    rec.mem_angle = static_cast<int16_t>(mem_angle * 100.0f);
+    rec.dest_angle = static_cast<int16_t>(dest_angle * 100.0f);
+    rec.front_angle[0] = static_cast<int16_t>(wheels.steerable_at<Board::LEFT_FRONT>().get_angle() * 100.0f);
+    rec.front_angle[1] = static_cast<int16_t>(wheels.steerable_at<Board::RIGHT_FRONT>().get_angle() * 100.0f);
+    rec.inertia_ms = static_cast<uint16_t>(std::min<uint32_t>(inertia_us_remaining / 1000, UINT16_MAX));
+    trace->push(rec);
 }
 
 void DriveSystem::stop() {
     mem_speed = 0;
+#if CONFIG_MOTORS_WHEEL_MCPWM
+    wheel_pwm.stop_all();
+#endif
+    // one ALL_CALL write takes the motor outputs of every PCA9685 off at once, ahead of any queued frame
+    buffer->stop_motors();
+    // the motor channels read 0 now: write the wheels again (motors stopped, servos straight)
+    outputs_valid = false;
     move_with_angle(mem_speed, 0);
 }
 
@@ -481,31 +794,35 @@ void DriveSystem::handle_spinning() {
     
     if (spin_speed > mem_speed) {
         mem_speed = std::min(spin_speed, 
-                            static_cast<int16_t>(mem_speed + Cfg::DC_ACCEL));
+                            static_cast<int16_t>(mem_speed + speed_step(Cfg::DC_ACCEL, 1)));
     } else if (spin_speed < mem_speed) {
         mem_speed = std::max(spin_speed, 
-                            static_cast<int16_t>(mem_speed - Cfg::DC_ACCEL));
+                            static_cast<int16_t>(mem_speed - speed_step(Cfg::DC_ACCEL, -1)));
     }
 
+    SteerableWheel& left_front = wheels.steerable_at<Board::LEFT_FRONT>();
+    SteerableWheel& right_front = wheels.steerable_at<Board::RIGHT_FRONT>();
+    SteerableWheel& left_back = wheels.steerable_at<Board::LEFT_BACK>();
+    SteerableWheel& right_back = wheels.steerable_at<Board::RIGHT_BACK>();
+
     // Front wheels
     if (fabsf(Cfg::SPIN_FRONT_ANGLE - left_front.get_angle()) > 0.5f) {
-        left_front.set_angle(left_front.get_angle() + Cfg::SERVO_SPEED);
-        right_front.set_angle(right_front.get_angle() - Cfg::SERVO_SPEED);
-        ESP_LOGI(TAG, "NOOO LEFT %.1f, RIGHT %.1f", left_front.get_angle(), right_front.get_angle());
+        left_front.set_angle(left_front.get_angle() + angle_step());
+        right_front.set_angle(right_front.get_angle() - angle_step());
     } else {
         left_front.set_angle(Cfg::SPIN_FRONT_ANGLE);
         right_front.set_angle(-Cfg::SPIN_FRONT_ANGLE);
-        ESP_LOGI(TAG, "TARGETED FRONT ANGLE ACHIEVED LEFT %.1f, RIGHT %.1f", left_front.get_angle(), right_front.get_angle());
+        trace_flags |= TRACE_SPIN_FRONT_SET;
     }
 
     // Back wheels
     if (fabsf(Cfg::SPIN_BACK_ANGLE - right_back.get_angle()) > 0.5f) {
-        right_back.set_angle(right_back.get_angle() + Cfg::SERVO_SPEED);
-        left_back.set_angle(left_back.get_angle() - Cfg::SERVO_SPEED);
+        right_back.set_angle(right_back.get_angle() + angle_step());
+        left_back.set_angle(left_back.get_angle() - angle_step());
     } else {
         right_back.set_angle(Cfg::SPIN_BACK_ANGLE);
         left_back.set_angle(-Cfg::SPIN_BACK_ANGLE);
-        //ESP_LOGI(TAG, "TARGETED BACK ANGLE ACHIEVED %.1f, %.1f", left_back.get_angle(), right_back.get_angle());
+        trace_flags |= TRACE_SPIN_BACK_SET;
     }
     
     //ESP_LOGI(TAG, "SPINNING: speed=%d, throttle=%d, brake=%d", 
@@ -1,21 +1,28 @@
 #ifndef DRIVE_SYSTEM_H
 #define DRIVE_SYSTEM_H
 
-#include "wheel_motor.h"
+#include "wheel_table.h"
+#include "steering_cache.h"
+#include "drive_command.h"
+#include "rover_state.h"
+#include "seqlock.h"
+#include "trace_ring.h"
+#include "tick_stats.h"
+#include "input_session.h"
+#include "speed_profile.h"
+#include "odometry.h"
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+#include "wheel_encoders.h"
+#endif
+#if CONFIG_MOTORS_WHEEL_MCPWM
+#include "wheel_pwm.h"
+#endif
+#if CONFIG_MOTORS_IMU
+#include "imu_heading.h"
+#endif
 #include "stepper_motor.h"
 
 
-// Enum for states of the drive system
-enum class DriveState {
-    IDLE,           // Mars rover is stationary
-    ACCELERATING,   // Accelerating to dest_speed
-    MOVING,         // Moving at constant speed
-    TURNING,        // Sharp turn with speed reduction
-    STOPPING,       // Immidiate stop
-    SPINNING        // Spinning in place
-};
-
-
 /* DriveSystem class
  This is a class where all the drive logic is implemented.
 
@@ -27,6 +34,11 @@ enum class DriveState {
 
     * Sets speed and turning angle for the rover (Applies acceleration and deceleration)
     * Handles special spinning mode for turning in place
+
+ Threads: everything runs on the tick task, except post() and
+ emergency_stop(), which other threads (Bluetooth) use to hand input over,
+ reset_odometry(), and get_snapshot(), which any thread can use to read
+ the state.
 */
 class DriveSystem {
 private:
@@ -36,22 +48,97 @@ private:
     // Buffer for PCA9685 commands. Every tick esp32 flushes it to the device
     PCA9685Buffer* buffer;
 
+    // Binary trace of every tick, emptied by its own low priority task
+    TraceRing* trace;
+
     // Logging tag for debugging
     const char* TAG = "DriverSystem";
 
-    // Wheel motor and steerable wheel instances
-    SteerableWheel right_back;
-    WheelMotor right_middle;
-    SteerableWheel right_front;
+    // Wheel motor and steerable wheel instances, as Board describes them
+    WheelTable wheels;
 
-    SteerableWheel left_back;
-    WheelMotor left_middle;
-    SteerableWheel left_front;
+#if CONFIG_MOTORS_WHEEL_MCPWM
+    // Motor PWM on chip; the PCA9685 then only drives the servos
+    WheelPwm wheel_pwm;
+#endif
 
-    // Arrays for easy access
-    SteerableWheel* all_steerable_wheels[4];
+    // Steering solutions for the whole angle range, built once in the constructor
+    SteeringCache steering_cache;
 
-    WheelMotor* all_wheels[6];
+    // Input from other threads, taken at the start of every tick
+    DriveCommandMailbox commands;
+
+    // Apply the latest posted command (or the replayed session) and a requested emergency stop
+    void apply_commands();
+
+    // Bring the rover to a standing, straight IDLE at once: all outputs off, no inertia
+    void halt();
+
+    // Recorded controller input; while it replays it drives the rover instead of live input
+    InputSession session;
+    bool replay_tick{false};
+
+    // State published at the end of every tick
+    DoubleBufferedSeqlock<RoverStateSnapshot> snapshot;
+    void publish_snapshot(int64_t now_us);
+    // TraceFlags raised during the current tick
+    uint8_t trace_flags{0};
+    void push_trace(int64_t now_us);
+
+    // Cycle counts of the tick phases, overruns
+    TickStats stats;
+    // Cycles spent in buffer->flush() so far in this tick
+    uint32_t flush_cycles{0};
+    // buffer->flush(), timed into flush_cycles
+    void flush_buffer();
+
+    // Timed command taken by this tick, its latency is recorded at the next flush
+    InputTiming input_timing{};
+    int64_t input_taken_us{0};
+    bool input_pending{false};
+
+    /* Steering currently applied to the wheels
+       move_with_angle() only solves the geometry again when the angle changes
+       and only rewrites the buffer when the angle or the speed changes
+    */
+    float geometry_angle{0.0f};
+    bool geometry_valid{false};
+    uint16_t speed_ratio[6];        // Q15, Board::WHEELS order
+
+    int16_t applied_speed{0};
+    bool outputs_valid{false};
+
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    // Measured wheel speeds and a speed loop per wheel around the setpoints
+    // of move_with_angle() and rotate_in_place()
+    WheelEncoders encoders;
+    WheelSpeedPI wheel_pi[6];
+    int32_t wheel_pi_ki_dt{0};
+#endif
+    // Setpoints of the wheels from the last move_with_angle() / rotate_in_place()
+    int16_t wheel_setpoint[6]{};
+
+    // Pose from the middle wheels: encoder counts, or their setpoints over the tick
+    Odometry odometry;
+    std::atomic<bool> odometry_reset_requested{false};
+    void update_odometry(uint32_t dt_us);
+
+#if CONFIG_MOTORS_IMU
+    // Gyro yaw, read from the bus after every frame
+    ImuHeading imu;
+    // Heading kept while driving with the stick centred
+    bool heading_hold_active{false};
+    uint32_t held_heading{0};
+#endif
+    // Steering added to mem_angle to keep the held heading, degrees (0 without an IMU);
+    // applied as it is, past the steering hysteresis and the straight snap
+    float heading_trim{0.0f};
+    void update_heading_hold();
+
+    // true when the wheel commands follow the encoders, so they change every tick
+    bool closed_loop() const;
+    // Motor command for wheel i (Board::WHEELS order) at setpoint
+    int16_t wheel_command(uint8_t i, int16_t setpoint);
 
     // Stepper motor for camera pan control
     StepperMotor* camera_stepper;
@@ -70,11 +157,15 @@ private:
     // so don't be tricked by its name
     // in most of the cases mem_speed is an actual speed applied for motors
 
-    // Internal method to directly move wheels without state machine
-    void move_with_angle(int16_t speed, float angle);
+    // Internal method to directly move wheels without state machine; trim is
+    // added after angle is snapped to straight
+    void move_with_angle(int16_t speed, float angle, float trim = 0.0f);
 
     void rotate_in_place(int16_t speed);
 
+    // Apply steering for rover angle to the wheels and speed_ratio
+    void update_steering(float angle);
+
     // === State machine ===
     DriveState current_state{DriveState::IDLE};
     DriveState previous_state{DriveState::IDLE};
@@ -84,13 +175,35 @@ private:
     
     // === Innercia parameters ===
     int16_t inertia_speed{0};
-    uint16_t inertia_ticks_remaining{0};
+    uint32_t inertia_us_remaining{0};
+
+    // === TIME STEP ===
+    // Time covered by the current tick, the smoothing limits are scaled by it
+    uint32_t tick_dt_us{Cfg::TICK_PERIOD_US};
+    // Speed change below one unit, carried over to the next tick (units * us),
+    // only while the ramp keeps the direction and limit it was accumulated for
+    uint32_t speed_step_remainder{0};
+    uint32_t speed_step_limit{0};
+    int8_t speed_step_direction{0};
+
+    // Speed change allowed in this tick for a limit in units per second,
+    // direction is the sign of the change (+1 up, -1 down)
+    int16_t speed_step(uint32_t units_per_s, int8_t direction);
+
+    // Jerk-limited DC speed profile (accelerating, moving, turning)
+    SpeedProfile speed_profile;
+    // mem_speed for this tick towards target, DC_ACCEL speeding up and decel slowing down
+    int16_t profile_step(int16_t target, uint32_t decel);
+
+    // Steering change allowed in this tick, degrees
+    float angle_step() const { return Cfg::SERVO_SPEED * tick_dt_us / 1000000.0f; }
     
     // === PARAMETERS FOR SPIN MODE ===
     // throttle and brake are buttons on joystick on front
     int16_t spin_input_throttle{0};    // Throttle value (0-512)
     int16_t spin_input_brake{0};       // Brake value (0-512)
     bool is_spinning{false};           // Whether we are in spinning mode
+    uint32_t not_spinning_us{0};       // Time since the spin input was released
     
     // Methods for state machine handling
     void update_state();
@@ -115,6 +228,7 @@ private:
 public:
 
     DriveSystem(i2c_dev_t* pca9685);
+    ~DriveSystem();
 
     /*
      * speed - it's a speed of mars rover center, so using it DriverSystem class calculates speed for every motor
@@ -140,6 +254,18 @@ public:
     void set_spin_input(int16_t throttle, int16_t brake);
     void stop_spinning();
 
+    /* === INPUT FROM OTHER THREADS ===
+        Wait-free, never block the caller or the tick.
+        post() - latest driver input (single producer), applied on the next tick
+        emergency_stop() - any thread; on the next tick the motors go off with
+        one broadcast write and the rover is brought to IDLE without inertia
+    */
+    void post(const DriveCommand& cmd) { commands.post(cmd); }
+    void emergency_stop() { commands.emergency_stop(); }
+
+    // Make the current position the odometry origin (from the next tick); any thread
+    void reset_odometry() { odometry_reset_requested.store(true, std::memory_order_relaxed); }
+
     /* === STEPPER MOTOR CONTROL ===
         Control camera pan stepper motor
         speed - normalized speed from -1.0 (full left) to 1.0 (full right)
@@ -154,20 +280,47 @@ public:
     
     StepperMotor* get_stepper_motor() { return camera_stepper; }
 
+    // PCA9685 buffer, e.g. for its bus traffic counters
+    const PCA9685Buffer* get_pca_buffer() const { return buffer; }
+
     
+    /* Consistent copy of the state at the end of the latest tick
+        Wait-free for the tick; safe from any thread and core, unlike the
+        getters below, which are for the tick task only
+    */
+    RoverStateSnapshot get_snapshot() const { return snapshot.load(); }
+
+    // Per-tick trace; set_drain_mode() turns the text or raw output on and off
+    TraceRing* get_trace() { return trace; }
+
+    // Tick timing; the tick task also records its wake-up latency here
+    TickStats& get_tick_stats() { return stats; }
+
+    // Controller input recorder and replay (see InputSession for the threads)
+    InputSession& get_input_session() { return session; }
+
+#if CONFIG_MOTORS_IMU
+    // IMU yaw; its read counters (get_stats()) from any thread
+    const ImuHeading& get_imu() const { return imu; }
+#endif
+
     // Methods to get internal parameters for debugging
-    uint16_t get_inertia_ticks_remaining() const { return inertia_ticks_remaining; }
+    uint32_t get_inertia_us_remaining() const { return inertia_us_remaining; }
     bool get_is_spinning() const { return is_spinning; }
     
     /* IMPORTANT METHOD!
-    * This method should be called periodically (e.g., every 10ms)
+    * This method should be called every Cfg::TICK_PERIOD_US (CONFIG_MOTORS_CONTROL_RATE_HZ)
     * It updates the drive system state and applies necessary changes to motors
     
     * It allows the DriveSystem to manage acceleration and make movements smooth
+    
+    * dt_us - measured time since the previous tick; accelerations and steering
+    * speed follow it, so a late or skipped tick does not change them
     */
-   void tick();
+   void tick(uint32_t dt_us = Cfg::TICK_PERIOD_US);
    
-   // Immediately stop all motors, all PWM values to 0
+   // Immediately stop all motors: their PWM values to 0 with one broadcast write
+   // (or the on-chip motor PWM forced low), then the servos are set straight
    void stop();
 
 
@@ -176,7 +329,6 @@ public:
 
     // Debugging methods
     void print_angles();
-    void print_state();
 
 };
 
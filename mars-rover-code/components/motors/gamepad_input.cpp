@@ -0,0 +1,42 @@
+#include "gamepad_input.h"
+#include <cmath>
+#include <cstdlib>
+
+using namespace Gamepad;
+
+static int32_t normalized_speed(int32_t y) {
+    if (abs(y) < DEAD_ZONE) return 0;
+
+    float normalized_input = fabsf((float)y / AXIS_MAX_INPUT);
+
+    float non_linear_scale = std::pow(normalized_input, POWER_EXPONENT);
+
+    int sign = (y >= 0) ? -1 : 1;
+
+    return (int32_t)(sign * non_linear_scale * MAX_SPEED);
+}
+
+static float normalized_angle(int32_t x) {
+    if (std::abs(x) < DEAD_ZONE) return 0.0f;
+
+    float normalized_input = fabsf((float)x / AXIS_MAX_INPUT);
+
+    float non_linear_scale = std::pow(normalized_input, POWER_EXPONENT);
+
+    int sign = (x >= 0) ? 1 : -1;
+
+    return (float)(sign * non_linear_scale * MAX_ANGLE);
+}
+
+DriveCommand gamepad_drive_command(const GamepadSample& sample) {
+    DriveCommand cmd{};
+    if (sample.throttle > 10 || sample.brake > 10) {
+        cmd.spin = true;
+        cmd.throttle = sample.throttle;
+        cmd.brake = sample.brake;
+    } else {
+        cmd.speed = static_cast<int16_t>(normalized_speed(sample.axis_y));
+        cmd.angle = normalized_angle(sample.axis_rx);
+    }
+    return cmd;
+}
@@ -0,0 +1,49 @@
+#ifndef MOTORS_GAMEPAD_INPUT_H
+#define MOTORS_GAMEPAD_INPUT_H
+
+#include "drive_command.h"
+#include <cstdint>
+
+// GamepadSample::flags
+enum GamepadSampleFlags : uint8_t {
+    GAMEPAD_SAMPLE_DISCONNECT = 0x01,   // controller disconnected, no axes
+};
+
+/*
+ One controller report, as much of uni_gamepad_t as the rover uses.
+ Recorded by InputSession, so the layout is a storage format: keep it packed
+ and bump InputSession::VERSION when it changes.
+*/
+struct __attribute__((packed)) GamepadSample {
+    uint32_t t_us;          // since the start of the recording
+    int16_t axis_x;         // -512..511
+    int16_t axis_y;
+    int16_t axis_rx;
+    int16_t axis_ry;
+    int16_t brake;          // 0..1023
+    int16_t throttle;
+    uint16_t buttons;
+    uint8_t dpad;
+    uint8_t flags;          // GamepadSampleFlags
+};
+
+static_assert(sizeof(GamepadSample) == 20, "GamepadSample is a storage format, keep it packed");
+
+namespace Gamepad {
+    // Stick mapping, shared by the drive command and the camera axes
+    constexpr int16_t DEAD_ZONE = 10;           // stick travel ignored around the centre
+    constexpr float AXIS_MAX_INPUT = 512.0f;    // full stick deflection
+    constexpr float POWER_EXPONENT = 3.0f;      // response curve, fine control near the centre
+    constexpr float MAX_SPEED = 4096.0f;        // full left stick Y, speed units
+    constexpr float MAX_ANGLE = 30.0f;          // full right stick X, rover angle in degrees
+}
+
+/*
+ Driver input for a controller report: left stick Y is the speed, right
+ stick X the rover angle (both cubic, with a dead zone), throttle and
+ brake above 10 switch to spinning in place.
+ Used for live input and for replayed sessions alike, so both map the same.
+*/
+DriveCommand gamepad_drive_command(const GamepadSample& sample);
+
+#endif
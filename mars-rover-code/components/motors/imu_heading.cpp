@@ -0,0 +1,168 @@
+#include "imu_heading.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
+
+// A read has to be off the bus this long after the flush, well before the next tick's frame
+static constexpr uint32_t READ_WINDOW_US = Cfg::TICK_PERIOD_US / 2;
+// Bus bytes of a read besides its samples: FIFO count, overflow status, burst header
+static constexpr uint32_t READ_OVERHEAD_BYTES = 15;
+
+// Samples a read started since_flush_us after the flush can take and still end in the window
+static size_t burst_size(uint32_t since_flush_us, uint32_t bus_hz) {
+    if (since_flush_us >= READ_WINDOW_US) return 0;
+    // 9 SCL clocks per byte with its ack
+    uint64_t bytes = static_cast<uint64_t>(READ_WINDOW_US - since_flush_us) * bus_hz / (9 * 1000000);
+    if (bytes <= READ_OVERHEAD_BYTES) return 0;
+    return std::min<uint64_t>(ImuHeading::MAX_BURST, (bytes - READ_OVERHEAD_BYTES) / MPU6050_FIFO_SAMPLE_SIZE);
+}
+
+
+esp_err_t ImuHeading::init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl) {
+    // the bus scheduler lets the reads through after the tick's frame, within a budget
+    dev.bus_class = I2C_DEV_CLASS_CONTROL;
+    esp_err_t err = mpu6050_init_desc(&dev, CONFIG_MOTORS_IMU_I2C_ADDR, port, sda, scl);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to init IMU descriptor: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t who_am_i = 0;
+    err = mpu6050_init(&dev, MPU6050_GYRO_RANGE_500, SAMPLE_RATE_HZ, &who_am_i);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No IMU at 0x%02x: %s", CONFIG_MOTORS_IMU_I2C_ADDR, esp_err_to_name(err));
+        return err;
+    }
+
+    ready = true;
+    ESP_LOGI(TAG, "IMU at 0x%02x (WHO_AM_I 0x%02x), gyro Z at %lu Hz",
+             CONFIG_MOTORS_IMU_I2C_ADDR, who_am_i, (unsigned long)SAMPLE_RATE_HZ);
+    return ESP_OK;
+}
+
+esp_err_t ImuHeading::start_task(const char* task_name, UBaseType_t priority, BaseType_t core_id,
+                                 const PCA9685Buffer* pca_buffer) {
+    if (read_task) {
+        ESP_LOGW(TAG, "Read task already running");
+        return ESP_OK;
+    }
+    if (!ready) return ESP_ERR_INVALID_STATE;
+
+    buffer = pca_buffer;
+    stop_requested.store(false, std::memory_order_relaxed);
+    task_exited.store(false, std::memory_order_relaxed);
+
+    BaseType_t result;
+    if (core_id == tskNO_AFFINITY) {
+        result = xTaskCreate(read_task_function, task_name, 4096, this, priority, &read_task);
+    } else {
+        result = xTaskCreatePinnedToCore(read_task_function, task_name, 4096, this,
+                                         priority, &read_task, core_id);
+    }
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create read task");
+        read_task = nullptr;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "IMU read task started: %s", task_name);
+    return ESP_OK;
+}
+
+void ImuHeading::stop_task() {
+    if (!read_task) return;
+
+    stop_requested.store(true, std::memory_order_release);
+    xTaskNotifyGive(read_task);
+    // a read in flight finishes first, then the task deletes itself
+    while (!task_exited.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    read_task = nullptr;
+    ESP_LOGI(TAG, "IMU read task stopped");
+}
+
+void ImuHeading::frame_flushed() {
+    if (!read_task) return;
+    flushed_us.store(static_cast<uint32_t>(esp_timer_get_time()), std::memory_order_relaxed);
+    xTaskNotifyGive(read_task);
+}
+
+void ImuHeading::read_task_function(void* arg) {
+    static_cast<ImuHeading*>(arg)->read_loop();
+    vTaskDelete(NULL);
+}
+
+void ImuHeading::read_loop() {
+    int16_t samples[MAX_BURST];
+    Totals t{};
+
+    // at most one tick period for the frame to leave, in FreeRTOS ticks
+    const TickType_t frame_wait = std::max<TickType_t>(1, pdMS_TO_TICKS(Cfg::TICK_PERIOD_US / 1000));
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (stop_requested.load(std::memory_order_acquire)) break;
+
+        // the frame goes first; a bus held for recovery is left alone
+        bool idle = !buffer || buffer->wait_idle(frame_wait);
+        uint32_t since_flush = static_cast<uint32_t>(esp_timer_get_time()) - flushed_us.load(std::memory_order_relaxed);
+        // at the IMU's own SCL speed, set per device, not the one the PCA9685 probe picked
+        size_t burst = buffer ? burst_size(since_flush, dev.cfg.master.clk_speed) : MAX_BURST;
+        if (!idle || burst == 0) {
+            t.stats.skipped++;
+            totals.store(t);
+            continue;
+        }
+
+        size_t count = 0;
+        bool overflow = false;
+        esp_err_t err = mpu6050_read_gyro_z_fifo(&dev, samples, burst, &count, &overflow);
+        if (err != ESP_OK) {
+            t.stats.errors++;
+        } else {
+            t.stats.reads++;
+            if (overflow) t.stats.overflows++;
+            for (size_t i = 0; i < count; i++) t.gyro_sum += samples[i];
+            t.stats.samples += count;
+        }
+        totals.store(t);
+    }
+
+    // the object may be gone right after this
+    task_exited.store(true, std::memory_order_release);
+}
+
+ImuHeading::Stats ImuHeading::get_stats() const {
+    return totals.load().stats;
+}
+
+void ImuHeading::update(uint32_t odometry_heading, bool standing) {
+    if (!ready) return;
+
+    Totals t = totals.load();
+    int32_t n = static_cast<int32_t>(t.stats.samples - seen.stats.samples);
+    int64_t sum = t.gyro_sum - seen.gyro_sum;
+    seen = t;
+    if (n == 0) return;
+#if CONFIG_MOTORS_IMU_UPSIDE_DOWN
+    sum = -sum;
+#endif
+
+    // standing still, the gyro reads nothing but its bias
+    if (standing) {
+        int32_t mean_q8 = static_cast<int32_t>(sum * 256 / n);
+        bias_q8 += (mean_q8 - bias_q8) / BIAS_DIV;
+    }
+
+    // integrate the rate over the n sample periods
+    int64_t rate_q8 = sum * 256 - static_cast<int64_t>(bias_q8) * n;
+    uint32_t turned = static_cast<uint32_t>(rate_q8 * ANGLE_PER_LSB_Q8 / 65536);
+    yaw += turned;
+    gyro_yaw += turned;
+
+    // and pull it towards the odometry heading
+    int32_t err = static_cast<int32_t>(odometry_heading - yaw);
+    yaw += static_cast<uint32_t>(static_cast<int64_t>(err) * FUSION_GAIN_Q16 * n / 65536);
+}
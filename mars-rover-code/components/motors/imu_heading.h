@@ -0,0 +1,127 @@
+#ifndef MOTORS_IMU_HEADING_H
+#define MOTORS_IMU_HEADING_H
+
+#include "motors_cfg.h"
+#include "seqlock.h"
+#include "pca_buffer.h"
+#include "mpu6050.h"
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstdint>
+
+/*
+ Rover yaw from an MPU6050 class IMU on the PCA9685 bus.
+
+ The IMU samples its gyro Z axis into its FIFO at CONFIG_MOTORS_IMU_SAMPLE_RATE_HZ.
+ A low priority task empties the FIFO with one burst read per tick, and
+ only once the tick's PWM frame is on the wire: the tick calls
+ frame_flushed() after its last flush, the task waits for the PCA9685
+ buffer to go idle and takes as many samples as the IMU's SCL speed can
+ carry in the first half of the tick period, or none when that has passed.
+ A skipped or short read costs nothing, the samples wait in the FIFO. The task
+ publishes running totals, so the tick picks up every sample however the
+ reads fall between ticks.
+
+ update() runs on the tick and fuses the gyro with the odometry heading in
+ fixed point (binary angle, 2^32 is a full turn, like Odometry): the gyro
+ carries the yaw from tick to tick, the odometry heading pulls it back
+ with time constant CONFIG_MOTORS_IMU_FUSION_TAU_MS so the gyro bias
+ cannot make it drift away. The bias itself is learnt while the rover
+ stands. The gyro yaw alone, without that pull, is kept as well: the
+ odometry never sees a disturbance the wheels do not feel (a side slope,
+ a dragging wheel), so over the time constant the fused yaw follows the
+ odometry and hides it. Holding a heading takes the gyro yaw.
+
+ Threads: init() and start_task() once, frame_flushed(), update() and the
+ getters on the tick task, get_stats() anywhere. stop_task() (and the
+ destructor) on the tick task, or once the tick no longer runs.
+*/
+class ImuHeading {
+public:
+    static constexpr uint32_t SAMPLE_RATE_HZ = CONFIG_MOTORS_IMU_SAMPLE_RATE_HZ;
+    // Samples taken by one read at most (fewer late in the read window); the rest waits for the next one
+    static constexpr size_t MAX_BURST = 32;
+
+    // One LSB over one sample period as a binary angle, Q8 (+-500 deg/s: 65.5 LSB per deg/s)
+    static constexpr int64_t ANGLE_PER_LSB_Q8 =
+        (static_cast<int64_t>(1) << 40) * 10 / (static_cast<int64_t>(360) * 655 * SAMPLE_RATE_HZ);
+    // Pull towards the odometry heading per sample, Q16
+    static constexpr int64_t FUSION_GAIN_Q16 = CONFIG_MOTORS_IMU_FUSION_TAU_MS > 0 ?
+        (static_cast<int64_t>(65536) * 1000) / (static_cast<int64_t>(SAMPLE_RATE_HZ) * CONFIG_MOTORS_IMU_FUSION_TAU_MS) : 0;
+    // Bias estimate moves 1/BIAS_DIV of the way per standing tick
+    static constexpr int32_t BIAS_DIV = 256;
+
+    struct Stats {
+        uint32_t reads;         // burst reads
+        uint32_t samples;       // gyro samples read
+        uint32_t overflows;     // FIFO overflowed and was reset (samples lost)
+        uint32_t errors;        // failed reads
+        uint32_t skipped;       // reads given up so as not to delay a frame
+    };
+
+    ~ImuHeading() { stop_task(); }
+
+    // Set up and start the IMU on the bus of the PCA9685s
+    esp_err_t init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl);
+    bool is_ready() const { return ready; }
+
+    // Start the read task; it only uses the bus while buffer is idle
+    esp_err_t start_task(const char* task_name, UBaseType_t priority, BaseType_t core_id,
+                         const PCA9685Buffer* buffer);
+
+    // Stop the read task and wait until it has left the bus and this object
+    void stop_task();
+
+    // Tick task: the tick's last frame has been handed to the buffer
+    void frame_flushed();
+
+    // Tick task: take the samples read since the last update; odometry_heading - binary angle,
+    // standing - the wheels have been still since the last update (the gyro reads its bias)
+    void update(uint32_t odometry_heading, bool standing);
+
+    // Yaw to heading (binary angle), e.g. with the odometry reset
+    void reset(uint32_t heading) { yaw = gyro_yaw = heading; }
+
+    // Yaw, binary angle, counter-clockwise
+    uint32_t get_yaw() const { return yaw; }
+    float get_yaw_deg() const { return static_cast<int32_t>(yaw) * (360.0f / 4294967296.0f); }
+    // Bias corrected gyro alone, binary angle: drifts slowly with the bias error
+    uint32_t get_gyro_yaw() const { return gyro_yaw; }
+
+    Stats get_stats() const;
+
+private:
+    // Published by the read task, counted since start
+    struct Totals {
+        int64_t gyro_sum;
+        Stats stats;
+    };
+    DoubleBufferedSeqlock<Totals> totals;
+
+    i2c_dev_t dev{};
+    bool ready{false};
+
+    const PCA9685Buffer* buffer{nullptr};
+    TaskHandle_t read_task{nullptr};
+    // esp_timer time of the last frame_flushed(), low 32 bits
+    std::atomic<uint32_t> flushed_us{0};
+    // set by stop_task(), the task answers with task_exited as its last access to this
+    std::atomic<bool> stop_requested{false};
+    std::atomic<bool> task_exited{false};
+
+    static void read_task_function(void* arg);
+    void read_loop();
+
+    // tick side
+    Totals seen{};
+    uint32_t yaw{0};
+    uint32_t gyro_yaw{0};
+    int32_t bias_q8{0};         // LSB, Q8
+
+    const char* TAG = "ImuHeading";
+};
+
+#endif
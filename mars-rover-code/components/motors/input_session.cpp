@@ -0,0 +1,135 @@
+#include "input_session.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <cstring>
+
+static constexpr uint32_t FNV_OFFSET = 2166136261u;
+static constexpr uint32_t FNV_PRIME = 16777619u;
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+
+esp_err_t InputSession::start_recording() {
+    Mode current = get_mode();
+    if (current == Mode::REPLAYING) return ESP_ERR_INVALID_STATE;
+
+    // the controller thread sees the new start time once it sees RECORDING
+    mode.store(Mode::IDLE, std::memory_order_release);
+    count.store(0, std::memory_order_relaxed);
+    record_start_us = esp_timer_get_time();
+    mode.store(Mode::RECORDING, std::memory_order_release);
+
+    ESP_LOGI(TAG, "Recording, up to %lu samples", (unsigned long)CAPACITY);
+    return ESP_OK;
+}
+
+void InputSession::stop_recording() {
+    Mode expected = Mode::RECORDING;
+    if (mode.compare_exchange_strong(expected, Mode::IDLE, std::memory_order_acq_rel)) {
+        ESP_LOGI(TAG, "Recorded %lu samples", (unsigned long)get_count());
+    }
+}
+
+void InputSession::record(GamepadSample sample) {
+    if (get_mode() != Mode::RECORDING) return;
+
+    uint32_t n = count.load(std::memory_order_relaxed);
+    if (n >= CAPACITY) return;
+
+    sample.t_us = static_cast<uint32_t>(esp_timer_get_time() - record_start_us);
+    samples[n] = sample;
+    count.store(n + 1, std::memory_order_release);
+}
+
+esp_err_t InputSession::start_replay() {
+    if (get_count() == 0) return ESP_ERR_INVALID_STATE;
+
+    // a running replay is left alone: its state belongs to the tick
+    Mode expected = Mode::IDLE;
+    if (!mode.compare_exchange_strong(expected, Mode::REPLAYING, std::memory_order_acq_rel)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    stop_requested.store(false, std::memory_order_relaxed);
+    return ESP_OK;
+}
+
+bool InputSession::replay_begin() {
+    if (replay_started) return false;
+
+    replay_started = true;
+    replay_index = 0;
+    replay_clock_us = 0;
+    output_hash.store(FNV_OFFSET, std::memory_order_relaxed);
+    replayed_ticks.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+bool InputSession::replay_advance(uint32_t dt_us) {
+    if (stop_requested.exchange(false, std::memory_order_relaxed)) return false;
+
+    replay_clock_us += dt_us;
+    uint32_t n = get_count();
+    return replay_index < n || replay_clock_us <= samples[n - 1].t_us + static_cast<uint64_t>(REPLAY_TAIL_US);
+}
+
+bool InputSession::take_due(GamepadSample& out) {
+    if (replay_index >= get_count() || samples[replay_index].t_us > replay_clock_us) return false;
+
+    out = samples[replay_index++];
+    return true;
+}
+
+void InputSession::replay_outputs(const RoverStateSnapshot& s) {
+    uint32_t hash = output_hash.load(std::memory_order_relaxed);
+    hash = fnv1a(hash, s.wheel_pwm, sizeof(s.wheel_pwm));
+    hash = fnv1a(hash, s.servo_duty, sizeof(s.servo_duty));
+    output_hash.store(hash, std::memory_order_relaxed);
+    replayed_ticks.store(replayed_ticks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void InputSession::replay_end() {
+    replay_started = false;
+    mode.store(Mode::IDLE, std::memory_order_release);
+}
+
+size_t InputSession::blob_size() const {
+    return sizeof(Header) + get_count() * sizeof(GamepadSample);
+}
+
+size_t InputSession::serialize(void* out, size_t size) const {
+    size_t needed = blob_size();
+    if (size < needed) return 0;
+
+    Header header{MAGIC, VERSION, sizeof(GamepadSample), get_count()};
+    memcpy(out, &header, sizeof(header));
+    memcpy(static_cast<uint8_t*>(out) + sizeof(header), samples, header.count * sizeof(GamepadSample));
+    return needed;
+}
+
+esp_err_t InputSession::load(const void* blob, size_t size) {
+    if (get_mode() != Mode::IDLE) return ESP_ERR_INVALID_STATE;
+
+    Header header;
+    if (size < sizeof(header)) return ESP_ERR_INVALID_SIZE;
+    memcpy(&header, blob, sizeof(header));
+
+    if (header.magic != MAGIC || header.version != VERSION || header.sample_size != sizeof(GamepadSample)) {
+        ESP_LOGE(TAG, "Not a version %u session", VERSION);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (header.count > CAPACITY || size < sizeof(header) + header.count * sizeof(GamepadSample)) {
+        ESP_LOGE(TAG, "Session of %lu samples does not fit", (unsigned long)header.count);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(samples, static_cast<const uint8_t*>(blob) + sizeof(header), header.count * sizeof(GamepadSample));
+    count.store(header.count, std::memory_order_release);
+    return ESP_OK;
+}
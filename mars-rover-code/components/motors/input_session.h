@@ -0,0 +1,112 @@
+#ifndef MOTORS_INPUT_SESSION_H
+#define MOTORS_INPUT_SESSION_H
+
+#include "gamepad_input.h"
+#include "rover_state.h"
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ Record and replay of controller input.
+
+ Recording: the controller thread calls record() with every report it hands
+ to the rover; samples are stamped with the time since start_recording() and
+ kept in RAM until the session is full. serialize()/load() turn the session
+ into a blob, to keep it in flash (NVS) or move it to a host build.
+
+ Replay: DriveSystem::tick() takes over. It brings the rover to a stop,
+ ignores live input (an emergency stop still ends the replay) and applies
+ every sample once the replay clock reaches its time. However the replay
+ ends, the rover is brought to rest again and waits for live input. The
+ replay clock and the drive model advance by the nominal tick period, not
+ by the measured time (the encoders and the odometry keep the measured
+ time), so a session replays to the same PWM outputs every time, on target
+ and in the host bench alike; the outputs of every tick are folded into
+ get_output_hash() to compare runs. Host and target agree as far as their
+ float math does (the stick curves use powf), and with the wheel speed
+ loop as far as the wheels turn alike.
+
+ Threads: record() - one controller thread; replay_*() and take_due() - the
+ tick task; the rest any thread. The tick does not log, the trace marks the
+ first and the last tick of a replay (TRACE_REPLAY_START, TRACE_REPLAY_END).
+ Recording must be stopped before the session is replayed, saved or loaded.
+*/
+class InputSession {
+public:
+    static constexpr uint32_t CAPACITY = CONFIG_MOTORS_INPUT_SESSION_SAMPLES;
+
+    // Blob header
+    static constexpr uint32_t MAGIC = 0x4e495652;     // "RVIN"
+    static constexpr uint16_t VERSION = 1;
+
+    // Replay keeps running this long after the last sample, so the rover comes to rest
+    static constexpr uint32_t REPLAY_TAIL_US = 3000000;
+
+    enum class Mode : uint8_t { IDLE, RECORDING, REPLAYING };
+
+    Mode get_mode() const { return mode.load(std::memory_order_acquire); }
+    uint32_t get_count() const { return count.load(std::memory_order_acquire); }
+    // Time of the last sample since the start of the recording
+    uint32_t get_duration_us() const { uint32_t n = get_count(); return n ? samples[n - 1].t_us : 0; }
+    bool is_full() const { return get_count() >= CAPACITY; }
+
+    // Clear the session and record from now on; ESP_ERR_INVALID_STATE while replaying
+    esp_err_t start_recording();
+    void stop_recording();
+
+    // Controller thread: append sample (t_us is set here), dropped unless recording
+    void record(GamepadSample sample);
+
+    // Replay the session from the next tick; ESP_ERR_INVALID_STATE if recording or empty
+    esp_err_t start_replay();
+    // Any thread: end the replay at the next tick
+    void stop_replay() { stop_requested.store(true, std::memory_order_relaxed); }
+
+    // === Tick task, while replaying ===
+    // true on the first tick of a replay
+    bool replay_begin();
+    // Move the replay clock on by dt_us; false when the replay is over
+    bool replay_advance(uint32_t dt_us);
+    // Next sample due at the current replay clock
+    bool take_due(GamepadSample& out);
+    // Fold the outputs of a replayed tick into the output hash
+    void replay_outputs(const RoverStateSnapshot& s);
+    void replay_end();
+
+    // FNV-1a of the wheel PWM and servo duty of every replayed tick, and the ticks hashed
+    uint32_t get_output_hash() const { return output_hash.load(std::memory_order_relaxed); }
+    uint32_t get_replayed_ticks() const { return replayed_ticks.load(std::memory_order_relaxed); }
+
+    // Blob of the session: header and samples, little endian
+    size_t blob_size() const;
+    size_t serialize(void* out, size_t size) const;
+    esp_err_t load(const void* blob, size_t size);
+
+private:
+    struct __attribute__((packed)) Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t sample_size;
+        uint32_t count;
+    };
+
+    GamepadSample samples[CAPACITY];
+    std::atomic<uint32_t> count{0};
+    std::atomic<Mode> mode{Mode::IDLE};
+    int64_t record_start_us{0};
+
+    // replay state, tick task only
+    bool replay_started{false};
+    uint32_t replay_index{0};
+    uint64_t replay_clock_us{0};
+    std::atomic<bool> stop_requested{false};
+    std::atomic<uint32_t> output_hash{0};
+    std::atomic<uint32_t> replayed_ticks{0};
+
+    const char* TAG = "InputSession";
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "kinematics.h"
+#include "motors_cfg.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include <cinttypes>
+#include <cmath>
+#include <cstdlib>
+
+static const char* TAG = "Kinematics";
+
+// helper
+static inline uint16_t clamp_pwm(int32_t v) {
+    if (v <= 0) return 0;
+    if (v > 4095) return 4095;
+    return static_cast<uint16_t>(v);
+}
+
+
+uint32_t Kinematics::isqrt(uint32_t n) {
+    if (n == 0) return 0;
+    uint32_t x = n;
+    uint32_t y = (x + 1) / 2;
+    while (y < x) {
+        x = y;
+        y = (x + n / x) / 2;
+    }
+    return x;
+}
+
+uint32_t Kinematics::isqrt_fast(uint32_t n) {
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > n) bit >>= 2;
+
+    while (bit != 0) {
+        if (n >= result + bit) {
+            n -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+
+// ============================== Float path ==============================
+
+int32_t Kinematics::Float::turn_radius(float rvr_angle) {
+    if (fabsf(rvr_angle) <= STRAIGHT_ANGLE) return STRAIGHT_RADIUS;
+
+    float alpha_rad = rvr_angle * PI / 180.0f;
+    return static_cast<int32_t>(Cfg::FRONT_Y / tanf(alpha_rad));
+}
+
+uint32_t Kinematics::Float::wheel_radius(int16_t l, int32_t offset) {
+    int32_t l_squared = (int32_t)l * l;
+    int32_t offset_squared = offset * offset;
+
+    return isqrt((uint32_t)(l_squared + offset_squared));
+}
+
+float Kinematics::Float::wheel_angle(int16_t l, int32_t /*offset*/, uint32_t radius) {
+    float ratio = (float)l / (float)radius;
+    if (ratio > 1.0f) ratio = 1.0f;
+    if (ratio < -1.0f) ratio = -1.0f;
+
+    float angle_rad = asinf(ratio);
+    return angle_rad * 180.0f / PI;
+}
+
+int16_t Kinematics::Float::wheel_speed(int16_t speed, uint32_t radius, uint32_t max_radius) {
+    float rot_speed = static_cast<float>(speed) / static_cast<float>(max_radius);
+    return static_cast<int16_t>(rot_speed * static_cast<float>(radius));
+}
+
+uint16_t Kinematics::Float::motor_pwm(int32_t abs_speed) {
+    return clamp_pwm(static_cast<int32_t>(abs_speed * Cfg::MOTOR_SCALE));
+}
+
+
+// ============================== Fixed path ==============================
+
+namespace {
+    // tan() of 0..60 degrees in Q20, linearly interpolated between whole degrees
+    constexpr uint32_t TAN_Q20[] = {
+        0, 18303, 36617, 54954, 73324, 91739, 110210, 128749,
+        147368, 166078, 184892, 203823, 222882, 242083, 261439, 280965,
+        300674, 320582, 340703, 361054, 381650, 402511, 423652, 445094,
+        466856, 488959, 511425, 534276, 557538, 581235, 605396, 630048,
+        655223, 680953, 707273, 734221, 761835, 790159, 819237, 849120,
+        879860, 911513, 944142, 977813, 1012598, 1048576, 1085832, 1124460,
+        1164562, 1206249, 1249644, 1294884, 1342116, 1391507, 1443241, 1497522,
+        1554578, 1614665, 1678072, 1745124, 1816187,
+    };
+    static_assert(sizeof(TAN_Q20) / sizeof(TAN_Q20[0]) == static_cast<size_t>(Cfg::WHEEL_MAX_DEVIATION) + 1,
+                  "TAN_Q20 must cover the whole steering range");
+
+    // atan(z), z in [0, 1]: Abramowitz & Stegun 4.4.49 (|error| <= 1e-5 rad), coefficients in Q15
+    constexpr int32_t ATAN_A1 = 32764;
+    constexpr int32_t ATAN_A3 = -10823;
+    constexpr int32_t ATAN_A5 = 5903;
+    constexpr int32_t ATAN_A7 = -2790;
+    constexpr int32_t ATAN_A9 = 683;
+
+    constexpr int32_t HALF_PI_Q15 = 51472;
+    constexpr float Q15_RAD_TO_DEG = 180.0f / PI / 32768.0f;
+}
+
+int32_t Kinematics::Fixed::turn_radius(float rvr_angle) {
+    float magnitude = fabsf(rvr_angle);
+    if (magnitude <= STRAIGHT_ANGLE) return STRAIGHT_RADIUS;
+    if (magnitude > Cfg::WHEEL_MAX_DEVIATION) magnitude = Cfg::WHEEL_MAX_DEVIATION;
+
+    // degrees in Q16
+    uint32_t angle = static_cast<uint32_t>(magnitude * 65536.0f);
+    uint32_t index = angle >> 16;
+    uint32_t frac = angle & 0xffff;
+
+    uint32_t tan_q20 = TAN_Q20[index];
+    if (frac) {
+        tan_q20 += static_cast<uint32_t>(
+            (static_cast<uint64_t>(TAN_Q20[index + 1] - tan_q20) * frac) >> 16);
+    }
+
+    int32_t radius = static_cast<int32_t>((static_cast<uint32_t>(Cfg::FRONT_Y) << 20) / tan_q20);
+    return rvr_angle < 0 ? -radius : radius;
+}
+
+uint32_t Kinematics::Fixed::wheel_radius(int16_t l, int32_t offset) {
+    int32_t l_squared = (int32_t)l * l;
+    int32_t offset_squared = offset * offset;
+
+    return isqrt_fast((uint32_t)(l_squared + offset_squared));
+}
+
+float Kinematics::Fixed::wheel_angle(int16_t l, int32_t offset, uint32_t /*radius*/) {
+    // asin(l / radius) == atan2(|l|, |offset|) with the sign of l
+    uint32_t y = static_cast<uint32_t>(std::abs(l));
+    uint32_t x = static_cast<uint32_t>(std::abs(offset));
+    if (y == 0) return 0.0f;
+
+    bool swap = y > x;
+    uint32_t num = swap ? x : y;
+    uint32_t den = swap ? y : x;
+
+    int32_t z = static_cast<int32_t>((num << 15) / den);    // Q15, 0..1
+    int32_t z2 = (z * z) >> 15;
+
+    int32_t p = ATAN_A9;
+    p = ATAN_A7 + ((p * z2) >> 15);
+    p = ATAN_A5 + ((p * z2) >> 15);
+    p = ATAN_A3 + ((p * z2) >> 15);
+    p = ATAN_A1 + ((p * z2) >> 15);
+
+    int32_t angle_q15 = (p * z) >> 15;                     // radians, Q15
+    if (swap) angle_q15 = HALF_PI_Q15 - angle_q15;
+
+    float angle = static_cast<float>(angle_q15) * Q15_RAD_TO_DEG;
+    return l < 0 ? -angle : angle;
+}
+
+int16_t Kinematics::Fixed::wheel_speed(int16_t speed, uint32_t radius, uint32_t max_radius) {
+    return static_cast<int16_t>((static_cast<int32_t>(speed) * static_cast<int32_t>(radius))
+                                / static_cast<int32_t>(max_radius));
+}
+
+uint16_t Kinematics::Fixed::motor_pwm(int32_t abs_speed) {
+    return clamp_pwm(abs_speed * 4095 / Cfg::MOTOR_INTERNAL_MAX);
+}
+
+
+// ============================== Comparison ==============================
+
+namespace {
+    struct FloatPath {
+        static int32_t turn_radius(float a) { return Kinematics::Float::turn_radius(a); }
+        static uint32_t wheel_radius(int16_t l, int32_t o) { return Kinematics::Float::wheel_radius(l, o); }
+        static float wheel_angle(int16_t l, int32_t o, uint32_t r) { return Kinematics::Float::wheel_angle(l, o, r); }
+        static int16_t wheel_speed(int16_t s, uint32_t r, uint32_t m) { return Kinematics::Float::wheel_speed(s, r, m); }
+    };
+
+    struct FixedPath {
+        static int32_t turn_radius(float a) { return Kinematics::Fixed::turn_radius(a); }
+        static uint32_t wheel_radius(int16_t l, int32_t o) { return Kinematics::Fixed::wheel_radius(l, o); }
+        static float wheel_angle(int16_t l, int32_t o, uint32_t r) { return Kinematics::Fixed::wheel_angle(l, o, r); }
+        static int16_t wheel_speed(int16_t s, uint32_t r, uint32_t m) { return Kinematics::Fixed::wheel_speed(s, r, m); }
+    };
+
+    // The wheels of DriveSystem
+    constexpr const WheelSpec (&WHEELS)[6] = Board::WHEELS;
+
+    constexpr int16_t COMPARE_SPEED = 1500;
+
+    struct Solution {
+        int32_t turn_radius;
+        uint32_t radius[6];
+        float angle[6];
+        int16_t speed[6];
+    };
+
+    // Mirrors move_with_angle() + WheelMotor/SteerableWheel::update_geometry()
+    template <typename Path>
+    void solve(float rvr_angle, Solution& out) {
+        out.turn_radius = Path::turn_radius(rvr_angle);
+
+        uint32_t max_radius = 0;
+        for (int i = 0; i < 6; i++) {
+            int32_t offset = out.turn_radius - WHEELS[i].d;
+            if (!WHEELS[i].steerable()) {
+                out.radius[i] = (uint32_t)abs(offset);
+                out.angle[i] = 0.0f;
+            } else if (abs(out.turn_radius) > 16000) {
+                out.radius[i] = 16000;
+                out.angle[i] = 0.0f;
+            } else {
+                out.radius[i] = Path::wheel_radius(WHEELS[i].l, offset);
+                float angle = Path::wheel_angle(WHEELS[i].l, offset, out.radius[i]);
+                if (out.turn_radius < 0) angle = -angle;
+                if (angle < -Cfg::WHEEL_MAX_DEVIATION) angle = -Cfg::WHEEL_MAX_DEVIATION;
+                if (angle >  Cfg::WHEEL_MAX_DEVIATION) angle =  Cfg::WHEEL_MAX_DEVIATION;
+                out.angle[i] = angle;
+            }
+            if (out.radius[i] > max_radius) max_radius = out.radius[i];
+        }
+
+        for (int i = 0; i < 6; i++) {
+            out.speed[i] = Path::wheel_speed(COMPARE_SPEED, out.radius[i], max_radius);
+        }
+    }
+
+    template <typename Path>
+    uint32_t measure(float from, float to, float step) {
+        volatile int32_t sink = 0;
+        Solution s;
+        uint32_t samples = 0;
+
+        uint32_t start = esp_cpu_get_cycle_count();
+        for (float a = from; a <= to; a += step, samples++) {
+            solve<Path>(a, s);
+            sink = sink + s.speed[0] + s.turn_radius;
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+        (void)sink;
+        return samples ? cycles / samples : 0;
+    }
+}
+
+Kinematics::Report Kinematics::compare(float step_deg) {
+    Report report{};
+    const float from = -Cfg::WHEEL_MAX_DEVIATION;
+    const float to = Cfg::WHEEL_MAX_DEVIATION;
+
+    for (float a = from; a <= to; a += step_deg) {
+        Solution ref, fix;
+        solve<FloatPath>(a, ref);
+        solve<FixedPath>(a, fix);
+        report.samples++;
+
+        uint32_t turn_err = static_cast<uint32_t>(abs(fix.turn_radius - ref.turn_radius));
+        if (turn_err > report.max_turn_radius_err) report.max_turn_radius_err = turn_err;
+
+        for (int i = 0; i < 6; i++) {
+            uint32_t radius_err = static_cast<uint32_t>(abs(static_cast<int32_t>(fix.radius[i] - ref.radius[i])));
+            float angle_err = fabsf(fix.angle[i] - ref.angle[i]);
+            int32_t speed_err = abs(fix.speed[i] - ref.speed[i]);
+
+            if (radius_err > report.max_wheel_radius_err) report.max_wheel_radius_err = radius_err;
+            if (angle_err > report.max_wheel_angle_err) report.max_wheel_angle_err = angle_err;
+            if (speed_err > report.max_wheel_speed_err) report.max_wheel_speed_err = speed_err;
+        }
+    }
+
+    report.float_cycles = measure<FloatPath>(from, to, step_deg);
+    report.fixed_cycles = measure<FixedPath>(from, to, step_deg);
+
+    ESP_LOGI(TAG, "%" PRIu32 " samples over +-%.0f deg", report.samples, Cfg::WHEEL_MAX_DEVIATION);
+    ESP_LOGI(TAG, "max error: turn radius %" PRIu32 " mm | wheel radius %" PRIu32 " mm | wheel angle %.3f deg | wheel speed %" PRId32,
+             report.max_turn_radius_err, report.max_wheel_radius_err,
+             report.max_wheel_angle_err, report.max_wheel_speed_err);
+    ESP_LOGI(TAG, "cycles per solve: float %" PRIu32 " | fixed %" PRIu32,
+             report.float_cycles, report.fixed_cycles);
+
+    return report;
+}
@@ -0,0 +1,94 @@
+#ifndef MOTORS_KINEMATICS_H
+#define MOTORS_KINEMATICS_H
+
+#include "sdkconfig.h"
+#include <cstdint>
+
+/*
+ Steering kinematics used by DriveSystem and the wheel classes.
+
+ There are two interchangeable implementations:
+    * Kinematics::Float - the original libm path (tanf, asinf, Newton isqrt)
+    * Kinematics::Fixed - integer/Q-format path (table tan, polynomial atan,
+                          division-free isqrt), no libm calls
+
+ CONFIG_MOTORS_FIXED_POINT_KINEMATICS selects which one Kinematics::Active
+ points to. Both are always compiled so they can be compared on target.
+
+ Fixed path tolerance against Float (checked by Kinematics::compare()):
+    * turn radius      - within 1 mm
+    * wheel radius     - within 1 mm
+    * wheel angle      - within 0.3 degree. Float takes asinf() against the
+                         floored integer wheel radius and is itself off by up
+                         to 0.3 degree; Fixed uses atan2 on the exact geometry
+                         and stays within 0.01 degree of it.
+    * wheel speed      - within 3 units (radius rounding feeds the speed ratio)
+ Rover angles beyond +-WHEEL_MAX_DEVIATION are clamped by the fixed path.
+*/
+namespace Kinematics {
+
+    // Turn radius reported for (almost) straight movement, in mm
+    constexpr int32_t STRAIGHT_RADIUS = 16001;
+
+    // Rover angles at or below this (degrees) are treated as straight movement
+    constexpr float STRAIGHT_ANGLE = 1.0f;
+
+    namespace Float {
+        // Radius of rover turn (mm, signed) for rover angle in degrees
+        int32_t turn_radius(float rvr_angle);
+
+        // Distance from the turn centre to a wheel at (l, d) for offset = rvr_radius - d
+        uint32_t wheel_radius(int16_t l, int32_t offset);
+
+        // Steering angle (degrees, unsigned by turn side) for a wheel at distance l along Y
+        float wheel_angle(int16_t l, int32_t offset, uint32_t radius);
+
+        // Scale rover speed by radius/max_radius
+        int16_t wheel_speed(int16_t speed, uint32_t radius, uint32_t max_radius);
+
+        // Absolute internal speed -> PWM value (0..4095)
+        uint16_t motor_pwm(int32_t abs_speed);
+    }
+
+    namespace Fixed {
+        int32_t turn_radius(float rvr_angle);
+        uint32_t wheel_radius(int16_t l, int32_t offset);
+        float wheel_angle(int16_t l, int32_t offset, uint32_t radius);
+        int16_t wheel_speed(int16_t speed, uint32_t radius, uint32_t max_radius);
+        uint16_t motor_pwm(int32_t abs_speed);
+    }
+
+#if CONFIG_MOTORS_FIXED_POINT_KINEMATICS
+    namespace Active = Fixed;
+#else
+    namespace Active = Float;
+#endif
+
+    // Integer square root (Newton iterations, uses division)
+    uint32_t isqrt(uint32_t n);
+
+    // Integer square root (digit-by-digit, shifts and adds only)
+    uint32_t isqrt_fast(uint32_t n);
+
+    struct Report {
+        uint32_t samples;
+
+        // Largest deviation of Fixed from Float over the sweep
+        uint32_t max_turn_radius_err;   // mm
+        uint32_t max_wheel_radius_err;  // mm
+        float max_wheel_angle_err;      // degrees
+        int32_t max_wheel_speed_err;    // internal units
+
+        // Average cost of a full move_with_angle() solve (turn radius, six wheels, speeds)
+        uint32_t float_cycles;
+        uint32_t fixed_cycles;
+    };
+
+    /*
+     Sweep the rover angle over +-WHEEL_MAX_DEVIATION with both paths,
+     measure the deviation and the CPU cycles per solve, and log the result.
+    */
+    Report compare(float step_deg = 0.05f);
+}
+
+#endif
@@ -1,4 +1,9 @@
+#ifndef MOTORS_CFG_H
+#define MOTORS_CFG_H
+
 #include "hal/ledc_types.h"
+#include "sdkconfig.h"
+#include "rover_board.h"
 #include <cstdint>
 #include <cmath>
 
@@ -30,40 +35,60 @@ namespace Cfg {
     constexpr float WHEEL_CENTER_ANGLE = 90.0f; // by default
     constexpr float WHEEL_MAX_DEVIATION = 60.0f;
     
-    // Coordinates of wheels relative to mars rover center (in mm)
-    constexpr int16_t FRONT_Y = 300;
-    constexpr int16_t BACK_Y = -273;
-    constexpr int16_t LEFT_X = -269;
-    constexpr int16_t RIGHT_X = 269;
+    // Coordinates of the outer wheels relative to mars rover center (in mm), from the board
+    constexpr int16_t FRONT_Y = Board::FRONT_Y;
+    constexpr int16_t BACK_Y = Board::BACK_Y;
+    constexpr int16_t LEFT_X = Board::LEFT_X;
+    constexpr int16_t RIGHT_X = Board::RIGHT_X;
 
     // I am not sure whether we need these parameters
     // usually it is used for deviation from center that we neglect
     constexpr float ANGLE_DEVIATION = 0.5f;
 
-    // dc motor acceleration (units per control loop tick)
-    constexpr int16_t DC_ACCEL = 10;
-    constexpr int16_t DC_DECEL = DC_ACCEL * 2;
-    // servo speed (degrees per control loop tick)
-    constexpr float SERVO_SPEED = 0.8f;
+    // === CONTROL LOOP RATE ===
+    // DriveSystem::tick() runs CONTROL_RATE_HZ times per second (CONFIG_MOTORS_CONTROL_RATE_HZ)
+    // and is given the time since the previous tick; the limits below are per second,
+    // so the rover moves the same at any rate and across late or dropped ticks.
+    constexpr uint16_t CONTROL_RATE_HZ = CONFIG_MOTORS_CONTROL_RATE_HZ;
+    constexpr uint32_t TICK_PERIOD_US = 1000000 / CONTROL_RATE_HZ;
+    // A longer gap (stalled loop) counts as this much, so nothing jumps afterwards
+    constexpr uint32_t MAX_TICK_DT_US = 100000;
+
+    // dc motor acceleration (internal speed units per second, CONFIG_MOTORS_DC_ACCEL)
+    constexpr uint32_t DC_ACCEL = CONFIG_MOTORS_DC_ACCEL;
+    constexpr uint32_t DC_DECEL = DC_ACCEL * 2;
+    // dc motor jerk: how fast the acceleration itself ramps (units per second^2, CONFIG_MOTORS_DC_JERK)
+    constexpr uint32_t DC_JERK = CONFIG_MOTORS_DC_JERK;
+    // servo speed (degrees per second)
+    constexpr float SERVO_SPEED = 80.0f;
+
+#if CONFIG_MOTORS_IMU
+    // heading hold: steering trim per degree of heading error (CONFIG_MOTORS_HEADING_HOLD_KP, 1/256)
+    constexpr float HEADING_HOLD_KP = CONFIG_MOTORS_HEADING_HOLD_KP / 256.0f;
+    // largest trim, degrees; under the 5 degrees at which TURNING hands back to MOVING
+    constexpr float HEADING_HOLD_MAX_TRIM = CONFIG_MOTORS_HEADING_HOLD_MAX_TRIM;
+#endif
     
     // === НОВI ПАРАМЕТРИ ІНЕРЦІЇ ===
-    // Час (в тактах) потрібний щоб зменшити швидкість на 1 одиницю при ковзанні
-    // На швидкості 3000 будет гальмування протягом: 3000 * INERTIA_TICKS_PER_UNIT * 10ms
-    // Приклад: INERTIA_TICKS_PER_UNIT = 2 => на 3000 потрібно 3000*2*10ms = 60 секунд
-    constexpr float INERTIA_TICKS_PER_UNIT = 0.01f;  // Кількість тактів (×10мс) на одиницю швидкості
-    constexpr float UINT_PER_INERTIA_TICKS = 1.0f / INERTIA_TICKS_PER_UNIT;
+    // Час ковзання на одиницю швидкості при зупинці
+    // На швидкості 3000 будет гальмування протягом: 3000 * 100 us = 0.3 секунди
+    constexpr uint32_t INERTIA_US_PER_UNIT = 100;
+    // Residual (inertia) speed decay, units per second
+    constexpr uint32_t INERTIA_DECAY = 1000000 / INERTIA_US_PER_UNIT;
 
-    // Max time for inertia effect (in ticks) to avoid too long sliding
-    // 1000 тактів * 10 ms = 10 seconds
-    constexpr uint16_t MAX_INERTIA_TICKS = 1000;
+    // Max time for inertia effect to avoid too long sliding, 10 seconds
+    constexpr uint32_t MAX_INERTIA_US = 10000000;
     
     // === PARAMETERS FOR SPINNING MODE ===
-    constexpr uint16_t SPIN_DEACTIVATE_TICKS = 5; // ticks to wait before stopping spin mode after buttons released
+    // time to wait before stopping spin mode after buttons released
+    constexpr uint32_t SPIN_DEACTIVATE_US = 50000;
     // Angle for front wheels when spinning around center
-    constexpr float SPIN_FRONT_ANGLE = 48.11847;      // degrees
+    constexpr float SPIN_FRONT_ANGLE = Board::SPIN_FRONT_ANGLE;    // degrees
     // Angle for back wheels when spinning around center
-    constexpr float SPIN_BACK_ANGLE  = 45.42284;      // degrees
+    constexpr float SPIN_BACK_ANGLE  = Board::SPIN_BACK_ANGLE;     // degrees
     
     // Max speed in spinning mode (internal units)
     constexpr int16_t SPIN_MAX_SPEED = 600;
 }
+
+#endif
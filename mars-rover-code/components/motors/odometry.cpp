@@ -0,0 +1,103 @@
+#include "odometry.h"
+#include <cmath>
+#include <cstdlib>
+
+// Heading change (binary angle) per um of difference between the two sides, Q16
+static constexpr double TWO_PI = 6.283185307179586;
+static constexpr int64_t ANGLE_PER_UM_Q16 =
+    static_cast<int64_t>(4294967296.0 / (TWO_PI * Odometry::TRACK_MM * 1000.0) * 65536.0);
+
+// Variance of a wheel's travel per um, mm^2
+static constexpr float NOISE_PER_UM = CONFIG_MOTORS_ODOMETRY_NOISE / 1000000.0f;
+
+
+Odometry::Odometry() {
+    for (int i = 0; i <= 256; i++) {
+        quarter_sine[i] = static_cast<int16_t>(lroundf(sinf(i * PI / 512.0f) * 32767.0f));
+    }
+    quarter_sine[257] = quarter_sine[256];
+}
+
+void Odometry::reset() {
+    x_um = 0;
+    y_um = 0;
+    heading = 0;
+    for (float& c : cov) c = 0.0f;
+}
+
+int32_t Odometry::sin_q15(uint32_t angle) const {
+    uint32_t quadrant = angle >> 30;
+    uint32_t pos = (angle >> 14) & 0xffff;         // 0..65535 within the quadrant
+    if (quadrant & 1) pos = 0x10000 - pos;          // falling half: mirror
+
+    uint32_t index = pos >> 8;
+    int32_t frac = pos & 0xff;
+    int32_t value = quarter_sine[index] + (((quarter_sine[index + 1] - quarter_sine[index]) * frac) >> 8);
+    return (quadrant & 2) ? -value : value;
+}
+
+void Odometry::update(int32_t right_um, int32_t left_um) {
+    if (right_um == 0 && left_um == 0) return;
+
+    int64_t distance_um = (static_cast<int64_t>(right_um) + left_um) / 2;
+    int32_t turn = static_cast<int32_t>(((static_cast<int64_t>(right_um) - left_um) * ANGLE_PER_UM_Q16) / 65536);
+
+    // integrate along the heading halfway through the turn
+    uint32_t mid = heading + static_cast<uint32_t>(turn / 2);
+    int32_t c = cos_q15(mid);
+    int32_t s = sin_q15(mid);
+    x_um += (distance_um * c) / 32768;
+    y_um += (distance_um * s) / 32768;
+    heading += static_cast<uint32_t>(turn);
+
+    // Covariance: P = F P F' + Q, F the Jacobian of the step wrt (x, y, heading)
+    float cf = c / 32768.0f;
+    float sf = s / 32768.0f;
+    float d = distance_um / 1000.0f;
+    float a = -d * sf;                              // dx / dheading
+    float b = d * cf;                               // dy / dheading
+
+    float& xx = cov[0];
+    float& xy = cov[1];
+    float& xh = cov[2];
+    float& yy = cov[3];
+    float& yh = cov[4];
+    float& hh = cov[5];
+
+    xx += 2.0f * a * xh + a * a * hh;
+    yy += 2.0f * b * yh + b * b * hh;
+    xy += a * yh + b * xh + a * b * hh;
+    xh += a * hh;
+    yh += b * hh;
+
+    // wheel travel noise -> distance and heading noise -> pose
+    float var_r = NOISE_PER_UM * std::abs(right_um);
+    float var_l = NOISE_PER_UM * std::abs(left_um);
+    float track = static_cast<float>(TRACK_MM);
+    float var_d = (var_r + var_l) / 4.0f;
+    float var_h = (var_r + var_l) / (track * track);
+    float cov_dh = (var_r - var_l) / (2.0f * track);
+
+    xx += cf * cf * var_d;
+    xy += cf * sf * var_d;
+    yy += sf * sf * var_d;
+    xh += cf * cov_dh;
+    yh += sf * cov_dh;
+    hh += var_h;
+}
+
+OdometryPose Odometry::get_pose() const {
+    OdometryPose pose;
+    pose.x_mm = static_cast<int32_t>(x_um / 1000);
+    pose.y_mm = static_cast<int32_t>(y_um / 1000);
+    pose.heading_deg = static_cast<int32_t>(heading) * (360.0f / 4294967296.0f);
+    for (int i = 0; i < 6; i++) pose.cov[i] = cov[i];
+    return pose;
+}
+
+uint32_t Odometry::speed_scale(uint32_t dt_us) {
+    // speed * FULL_SPEED_MM_S / MOTOR_INTERNAL_MAX mm/s over dt_us, in um
+    return static_cast<uint32_t>(
+        (static_cast<uint64_t>(dt_us) * CONFIG_MOTORS_ODOMETRY_FULL_SPEED_MM_S << 16) /
+        (static_cast<uint64_t>(Cfg::MOTOR_INTERNAL_MAX) * 1000));
+}
@@ -0,0 +1,74 @@
+#ifndef MOTORS_ODOMETRY_H
+#define MOTORS_ODOMETRY_H
+
+#include "rover_state.h"
+#include "motors_cfg.h"
+#include "sdkconfig.h"
+#include <cstdint>
+
+/*
+ Dead reckoning of the rover pose from its wheels.
+
+ The middle wheels are not steered, so as long as the wheels do not slip
+ sideways they roll exactly along the rover: a rigid body moving at v and
+ turning at w moves the right middle wheel by v + w * RIGHT_X and the left
+ one by v + w * LEFT_X, whatever the steering. update() takes the travel of
+ those two wheels over a tick (from the encoders, or from the speeds they
+ were commanded) and integrates v and w at the middle of the heading change.
+
+ The pose is integer: position in um, heading as a binary angle (2^32 is a
+ full turn, so it wraps by itself), sin/cos from a quarter wave table. The
+ covariance is propagated with the usual linearised model, every wheel's
+ travel carrying variance CONFIG_MOTORS_ODOMETRY_NOISE per metre; it is
+ float, its range (mm^2 to km^2) does not suit one fixed-point format.
+
+ Threads: tick task only; other threads read the pose from the snapshot.
+*/
+class Odometry {
+public:
+    // Distance between the middle wheels
+    static constexpr int32_t TRACK_MM = Cfg::RIGHT_X - Cfg::LEFT_X;
+
+    Odometry();
+
+    // Back to the origin, heading 0, no uncertainty
+    void reset();
+
+    // Travel of the right and the left middle wheel since the last update, um
+    void update(int32_t right_um, int32_t left_um);
+
+    OdometryPose get_pose() const;
+    // Heading, binary angle (2^32 is a full turn), counter-clockwise
+    uint32_t get_heading() const { return heading; }
+
+    // um per speed unit for a tick of dt_us, Q16 (one division, once per tick)
+    static uint32_t speed_scale(uint32_t dt_us);
+    static int32_t speed_to_um(int16_t speed, uint32_t scale_q16) {
+        return static_cast<int32_t>((static_cast<int64_t>(speed) * scale_q16) / 65536);
+    }
+
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    // um per encoder count, Q16: full speed is both FULL_SPEED_MM_S and COUNTS_PER_S_FULL
+    static constexpr int64_t UM_PER_COUNT_Q16 =
+        (static_cast<int64_t>(CONFIG_MOTORS_ODOMETRY_FULL_SPEED_MM_S) * 1000 << 16) / CONFIG_MOTORS_ENCODER_COUNTS_PER_S_FULL;
+    static int32_t counts_to_um(int32_t counts) {
+        return static_cast<int32_t>((counts * UM_PER_COUNT_Q16) / 65536);
+    }
+#endif
+
+private:
+    int64_t x_um{0};
+    int64_t y_um{0};
+    uint32_t heading{0};
+
+    // xx, xy, xh, yy, yh, hh (mm, rad)
+    float cov[6]{};
+
+    // sin of 0..90 degrees in 256 steps, Q15 (last entry repeated for the interpolation)
+    int16_t quarter_sine[258];
+
+    int32_t sin_q15(uint32_t angle) const;
+    int32_t cos_q15(uint32_t angle) const { return sin_q15(angle + (1u << 30)); }
+};
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef MOTORS_ROVER_BOARD_H
+#define MOTORS_ROVER_BOARD_H
+
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+#include <cstddef>
+#include <cstdint>
+
+/*
+ Compile-time description of the rover: which wheels it has, where they
+ sit, which PCA9685 channels drive them, their encoder and H-bridge pins,
+ and the camera mount pins.
+
+ A rover variant is one header (CONFIG_MOTORS_BOARD_HEADER) defining
+ struct RoverBoard with:
+    WHEELS              WheelSpec of every wheel; this order is the wheel
+                        order everywhere (encoders, MCPWM, the snapshot)
+    SPIN_FRONT_ANGLE    steering of the front and back wheels, degrees,
+    SPIN_BACK_ANGLE     when the rover spins in place
+    CAMERA              CameraSpec of the pan stepper and tilt servo
+
+ BoardLayout derives the rest at compile time (outer wheel positions, the
+ mirror of every wheel, the steerable wheels) and rejects a board the
+ drive code cannot run with, e.g. two outputs on one PCA9685 channel, one
+ GPIO used twice or an encoder on a pin that cannot read.
+ Board is the layout of the selected RoverBoard.
+*/
+
+// Steering servo channel of a wheel that is not steered
+constexpr int8_t NO_SERVO = -1;
+
+struct WheelSpec {
+    const char* tag;
+    uint8_t pca_fwd;        // PCA9685 channel driven while the wheel turns forward
+    uint8_t pca_rev;        // and while it reverses
+    int16_t l;              // mm from the rover centre along Y, forward positive
+    int16_t d;              // mm from the rover centre along X, right positive
+    int8_t servo;           // steering servo channel, NO_SERVO for a fixed wheel
+    // Quadrature encoder inputs (CONFIG_MOTORS_WHEEL_ENCODERS)
+    gpio_num_t encoder_a = GPIO_NUM_NC;
+    gpio_num_t encoder_b = GPIO_NUM_NC;
+    // H-bridge inputs on the MCPWM (CONFIG_MOTORS_WHEEL_MCPWM), A driven
+    // while the wheel turns forward, B while it reverses
+    gpio_num_t bridge_a = GPIO_NUM_NC;
+    gpio_num_t bridge_b = GPIO_NUM_NC;
+
+    constexpr bool steerable() const { return servo != NO_SERVO; }
+};
+
+struct CameraSpec {
+    gpio_num_t stepper_en;
+    gpio_num_t stepper_dir;
+    gpio_num_t stepper_step;
+    gpio_num_t tilt_servo;
+    uint8_t enable_level;   // stepper driver enabled at this level
+};
+
+#ifndef CONFIG_MOTORS_BOARD_HEADER
+#define CONFIG_MOTORS_BOARD_HEADER "board_mars_rover.h"
+#endif
+#include CONFIG_MOTORS_BOARD_HEADER
+
+
+namespace board_detail {
+    template <size_t N>
+    constexpr int16_t extreme_l(const WheelSpec (&w)[N], bool largest) {
+        int16_t v = w[0].l;
+        for (size_t i = 1; i < N; i++) if (largest ? w[i].l > v : w[i].l < v) v = w[i].l;
+        return v;
+    }
+
+    template <size_t N>
+    constexpr int16_t extreme_d(const WheelSpec (&w)[N], bool largest) {
+        int16_t v = w[0].d;
+        for (size_t i = 1; i < N; i++) if (largest ? w[i].d > v : w[i].d < v) v = w[i].d;
+        return v;
+    }
+
+    template <size_t N>
+    constexpr uint8_t count_steerable(const WheelSpec (&w)[N]) {
+        uint8_t n = 0;
+        for (size_t i = 0; i < N; i++) n += w[i].steerable();
+        return n;
+    }
+
+    // Wheel at l, d, or N
+    template <size_t N>
+    constexpr uint8_t find(const WheelSpec (&w)[N], int16_t l, int16_t d) {
+        for (size_t i = 0; i < N; i++) if (w[i].l == l && w[i].d == d) return static_cast<uint8_t>(i);
+        return N;
+    }
+
+    // Steerable wheel at l, d, or N
+    template <size_t N>
+    constexpr uint8_t find_steerable(const WheelSpec (&w)[N], int16_t l, int16_t d) {
+        uint8_t i = find(w, l, d);
+        return i < N && w[i].steerable() ? i : N;
+    }
+
+    // Wheels before wheel that are (not) steerable
+    template <size_t N>
+    constexpr uint8_t rank(const WheelSpec (&w)[N], uint8_t wheel, bool steerable) {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < wheel; i++) n += w[i].steerable() == steerable;
+        return n;
+    }
+
+    template <size_t N>
+    constexpr bool mirrored(const WheelSpec (&w)[N]) {
+        for (size_t i = 0; i < N; i++) {
+            uint8_t m = find(w, w[i].l, -w[i].d);
+            if (m == N || w[m].steerable() != w[i].steerable()) return false;
+        }
+        return true;
+    }
+
+    template <size_t N>
+    constexpr bool channels_exist(const WheelSpec (&w)[N], uint8_t channels) {
+        for (size_t i = 0; i < N; i++) {
+            if (w[i].pca_fwd >= channels || w[i].pca_rev >= channels) return false;
+            if (w[i].steerable() && (w[i].servo < 0 || w[i].servo >= channels)) return false;
+        }
+        return true;
+    }
+
+    template <size_t N>
+    constexpr bool channels_unique(const WheelSpec (&w)[N]) {
+        uint8_t used[3 * N]{};
+        size_t n = 0;
+        for (size_t i = 0; i < N; i++) {
+            used[n++] = w[i].pca_fwd;
+            used[n++] = w[i].pca_rev;
+            if (w[i].steerable()) used[n++] = static_cast<uint8_t>(w[i].servo);
+        }
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = i + 1; j < n; j++) if (used[i] == used[j]) return false;
+        }
+        return true;
+    }
+
+    // GPIOs of the board in use: the camera, then the encoder and bridge pins of every wheel
+    template <size_t N>
+    struct PinList {
+        gpio_num_t pins[4 + 4 * N]{};
+        size_t n{0};
+        constexpr void add(gpio_num_t pin) { if (pin != GPIO_NUM_NC) pins[n++] = pin; }
+    };
+
+    template <size_t N>
+    constexpr PinList<N> board_pins(const WheelSpec (&w)[N], const CameraSpec& c) {
+        PinList<N> list;
+        list.add(c.stepper_en);
+        list.add(c.stepper_dir);
+        list.add(c.stepper_step);
+        list.add(c.tilt_servo);
+        for (size_t i = 0; i < N; i++) {
+            list.add(w[i].encoder_a);
+            list.add(w[i].encoder_b);
+            list.add(w[i].bridge_a);
+            list.add(w[i].bridge_b);
+        }
+        return list;
+    }
+
+    template <size_t N>
+    constexpr bool pins_unique(const WheelSpec (&w)[N], const CameraSpec& c) {
+        const PinList<N> list = board_pins(w, c);
+        for (size_t i = 0; i < list.n; i++) {
+            for (size_t j = i + 1; j < list.n; j++) if (list.pins[i] == list.pins[j]) return false;
+        }
+        return true;
+    }
+
+    template <size_t N>
+    constexpr bool uses_pin(const WheelSpec (&w)[N], const CameraSpec& c, gpio_num_t pin) {
+        const PinList<N> list = board_pins(w, c);
+        for (size_t i = 0; i < list.n; i++) if (list.pins[i] == pin) return true;
+        return false;
+    }
+
+    constexpr bool input_pin(gpio_num_t pin) { return pin == GPIO_NUM_NC || GPIO_IS_VALID_GPIO(pin); }
+    constexpr bool output_pin(gpio_num_t pin) { return pin == GPIO_NUM_NC || GPIO_IS_VALID_OUTPUT_GPIO(pin); }
+
+    // Encoders read their pins, the bridges and the camera drive theirs
+    template <size_t N>
+    constexpr bool pins_capable(const WheelSpec (&w)[N], const CameraSpec& c) {
+        if (!output_pin(c.stepper_en) || !output_pin(c.stepper_dir) ||
+            !output_pin(c.stepper_step) || !output_pin(c.tilt_servo)) return false;
+        for (size_t i = 0; i < N; i++) {
+            if (!input_pin(w[i].encoder_a) || !input_pin(w[i].encoder_b)) return false;
+            if (!output_pin(w[i].bridge_a) || !output_pin(w[i].bridge_b)) return false;
+        }
+        return true;
+    }
+
+    template <size_t N>
+    constexpr bool encoders_wired(const WheelSpec (&w)[N]) {
+        for (size_t i = 0; i < N; i++) if (w[i].encoder_a == GPIO_NUM_NC || w[i].encoder_b == GPIO_NUM_NC) return false;
+        return true;
+    }
+
+    template <size_t N>
+    constexpr bool bridges_wired(const WheelSpec (&w)[N]) {
+        for (size_t i = 0; i < N; i++) if (w[i].bridge_a == GPIO_NUM_NC || w[i].bridge_b == GPIO_NUM_NC) return false;
+        return true;
+    }
+}
+
+template <class B>
+struct BoardLayout : B {
+    static constexpr uint8_t WHEEL_COUNT = sizeof(B::WHEELS) / sizeof(B::WHEELS[0]);
+    static constexpr uint8_t STEERABLE_COUNT = board_detail::count_steerable(B::WHEELS);
+    static constexpr uint8_t FIXED_COUNT = WHEEL_COUNT - STEERABLE_COUNT;
+
+    // Outermost wheel positions, mm
+    static constexpr int16_t FRONT_Y = board_detail::extreme_l(B::WHEELS, true);
+    static constexpr int16_t BACK_Y = board_detail::extreme_l(B::WHEELS, false);
+    static constexpr int16_t RIGHT_X = board_detail::extreme_d(B::WHEELS, true);
+    static constexpr int16_t LEFT_X = board_detail::extreme_d(B::WHEELS, false);
+
+    // Corner wheels, indices into WHEELS
+    static constexpr uint8_t RIGHT_FRONT = board_detail::find_steerable(B::WHEELS, FRONT_Y, RIGHT_X);
+    static constexpr uint8_t RIGHT_BACK = board_detail::find_steerable(B::WHEELS, BACK_Y, RIGHT_X);
+    static constexpr uint8_t LEFT_FRONT = board_detail::find_steerable(B::WHEELS, FRONT_Y, LEFT_X);
+    static constexpr uint8_t LEFT_BACK = board_detail::find_steerable(B::WHEELS, BACK_Y, LEFT_X);
+    // Unsteered wheels on the rover's X axis (odometry)
+    static constexpr uint8_t RIGHT_MIDDLE = board_detail::find(B::WHEELS, 0, RIGHT_X);
+    static constexpr uint8_t LEFT_MIDDLE = board_detail::find(B::WHEELS, 0, LEFT_X);
+
+    // Steerable wheels in the order of the snapshot's servo_duty and wheel_angle
+    static constexpr uint8_t STEERING[4] = {RIGHT_BACK, RIGHT_FRONT, LEFT_BACK, LEFT_FRONT};
+
+    // Position of wheel i in STEERING, or among the fixed wheels in WHEELS order
+    static constexpr uint8_t slot_of(uint8_t i) {
+        if (!B::WHEELS[i].steerable()) return board_detail::rank(B::WHEELS, i, false);
+        for (uint8_t k = 0; k < 4; k++) if (STEERING[k] == i) return k;
+        return STEERABLE_COUNT;
+    }
+
+    // WHEELS index of fixed wheel k
+    static constexpr uint8_t fixed_wheel(uint8_t k) {
+        for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+            if (!B::WHEELS[i].steerable() && board_detail::rank(B::WHEELS, i, false) == k) return i;
+        }
+        return WHEEL_COUNT;
+    }
+
+    // Wheel at the same position on the other side of the rover
+    static constexpr uint8_t mirror_of(uint8_t i) { return board_detail::find(B::WHEELS, B::WHEELS[i].l, -B::WHEELS[i].d); }
+};
+
+using Board = BoardLayout<RoverBoard>;
+
+// DriveSystem, the snapshot, the encoders and the MCPWM are laid out for this wheel set
+static_assert(Board::WHEEL_COUNT == 6 && Board::STEERABLE_COUNT == 4,
+    "the drive code runs six wheels, four of them steered");
+static_assert(Board::RIGHT_FRONT < 3 && Board::RIGHT_BACK < 3 && Board::RIGHT_MIDDLE < 3 &&
+              Board::LEFT_FRONT >= 3 && Board::LEFT_FRONT < 6 && Board::LEFT_BACK >= 3 && Board::LEFT_BACK < 6 &&
+              Board::LEFT_MIDDLE >= 3 && Board::LEFT_MIDDLE < 6,
+    "WHEELS lists the three right wheels, then the three left ones; the corner wheels steer");
+static_assert(!Board::WHEELS[Board::RIGHT_MIDDLE].steerable() && !Board::WHEELS[Board::LEFT_MIDDLE].steerable(),
+    "odometry needs an unsteered wheel on the X axis on each side");
+static_assert(Board::RIGHT_X > 0 && Board::LEFT_X == -Board::RIGHT_X && board_detail::mirrored(Board::WHEELS),
+    "SteeringCache mirrors left and right wheels, the rover must be symmetric");
+static_assert(board_detail::channels_exist(Board::WHEELS, 16 * CONFIG_PCA9685_BUFFER_DEVICES),
+    "a wheel uses a PCA9685 channel beyond CONFIG_PCA9685_BUFFER_DEVICES");
+static_assert(board_detail::channels_unique(Board::WHEELS), "two outputs share a PCA9685 channel");
+static_assert(board_detail::pins_unique(Board::WHEELS, Board::CAMERA),
+    "two board pins share a GPIO, e.g. a wheel encoder and an H-bridge input");
+static_assert(board_detail::pins_capable(Board::WHEELS, Board::CAMERA),
+    "an encoder is on a pin that is no GPIO, or a bridge or camera output on an input-only pin");
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+static_assert(board_detail::encoders_wired(Board::WHEELS), "CONFIG_MOTORS_WHEEL_ENCODERS needs the encoder pins of every wheel");
+#endif
+#if CONFIG_MOTORS_WHEEL_MCPWM
+static_assert(board_detail::bridges_wired(Board::WHEELS), "CONFIG_MOTORS_WHEEL_MCPWM needs the H-bridge pins of every wheel");
+#endif
+
+#endif
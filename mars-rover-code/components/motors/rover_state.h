@@ -0,0 +1,70 @@
+#ifndef MOTORS_ROVER_STATE_H
+#define MOTORS_ROVER_STATE_H
+
+#include <cstdint>
+
+// Enum for states of the drive system
+enum class DriveState {
+    IDLE,           // Mars rover is stationary
+    ACCELERATING,   // Accelerating to dest_speed
+    MOVING,         // Moving at constant speed
+    TURNING,        // Sharp turn with speed reduction
+    STOPPING,       // Immidiate stop
+    SPINNING        // Spinning in place
+};
+
+inline const char* drive_state_name(DriveState state) {
+    static const char* const names[] = {
+        "IDLE", "ACCELERATING", "MOVING", "TURNING", "STOPPING", "SPINNING"
+    };
+    return names[static_cast<int>(state)];
+}
+
+/*
+ Dead-reckoned pose of the rover (Odometry), relative to where it was last reset:
+ x forward, y to the left, heading counter-clockwise.
+*/
+struct OdometryPose {
+    int32_t x_mm;
+    int32_t y_mm;
+    float heading_deg;          // -180..180
+    // Covariance of (x mm, y mm, heading rad): xx, xy, xh, yy, yh, hh
+    float cov[6];
+};
+
+/*
+ DriveSystem state as of the end of one tick.
+ Published by DriveSystem::tick(), read with DriveSystem::get_snapshot()
+ from any thread.
+*/
+struct RoverStateSnapshot {
+    uint32_t seq;               // ticks published so far
+    int64_t time_us;            // esp_timer time at the end of the tick
+
+    DriveState state;
+    bool spinning;
+
+    int16_t mem_speed;          // speed applied to the motors
+    int16_t dest_speed;         // speed requested by the driver
+    float mem_angle;            // rover angle applied to the wheels, degrees
+    float dest_angle;           // rover angle requested by the driver
+
+    int16_t inertia_speed;
+    uint32_t inertia_us_remaining;
+
+    // DriveSystem wheel order: right front, middle, back, left front, middle, back
+    int16_t wheel_pwm[6];       // motor PWM, negative when reversing
+    int16_t wheel_speed[6];     // measured by the encoders (CONFIG_MOTORS_WHEEL_ENCODERS), else 0
+
+    // Steerable wheels: right back, right front, left back, left front
+    uint16_t servo_duty[4];
+    float wheel_angle[4];       // degrees
+
+    OdometryPose pose;
+
+    // Heading hold (CONFIG_MOTORS_IMU), else 0
+    float imu_yaw_deg;          // gyro yaw fused with the odometry heading, -180..180, counter-clockwise
+    float heading_trim;         // steering added to mem_angle to hold the heading, degrees
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef MOTORS_SEQLOCK_H
+#define MOTORS_SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/*
+ Double-buffered seqlock: one writer publishes values of T, any number of
+ readers on any core copy the latest one. Nobody takes a lock.
+
+ store() writes the slot readers are not using and then flips to it, so a
+ reader only has to retry when two stores overlap its copy (it was
+ preempted for a whole writer period). A reader of higher priority than
+ the writer, on the same core, therefore never spins on a half-written
+ value.
+
+ T is kept as words of relaxed atomics, which makes the concurrent copies
+ well-defined; it must be trivially copyable.
+*/
+template <typename T>
+class DoubleBufferedSeqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "DoubleBufferedSeqlock needs a trivially copyable T");
+
+public:
+    DoubleBufferedSeqlock() {
+        T initial{};
+        write_slot(0, initial);
+    }
+
+    // Writer only
+    void store(const T& value) {
+        uint32_t n = end.load(std::memory_order_relaxed) + 1;
+        // readers still copying slot n & 1 (published as n - 2) must see this before the data
+        begin.store(n, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        write_slot(n & 1, value);
+        end.store(n, std::memory_order_release);
+    }
+
+    // Any thread: copy of the latest stored value
+    T load() const {
+        T value;
+        uint32_t n;
+        do {
+            n = end.load(std::memory_order_acquire);
+            read_slot(n & 1, value);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // slot n & 1 is only rewritten by store n + 2
+        } while (begin.load(std::memory_order_relaxed) - n > 1);
+        return value;
+    }
+
+    // Number of store() calls so far
+    uint32_t sequence() const { return end.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    void write_slot(uint32_t slot, const T& value) {
+        uint32_t words[WORDS]{};
+        memcpy(words, &value, sizeof(T));
+        for (size_t i = 0; i < WORDS; i++) data[slot][i].store(words[i], std::memory_order_relaxed);
+    }
+
+    void read_slot(uint32_t slot, T& value) const {
+        uint32_t words[WORDS];
+        for (size_t i = 0; i < WORDS; i++) words[i] = data[slot][i].load(std::memory_order_relaxed);
+        memcpy(&value, words, sizeof(T));
+    }
+
+    std::atomic<uint32_t> begin{0};     // store in progress (or last finished)
+    std::atomic<uint32_t> end{0};       // last finished store, its slot is end & 1
+    std::atomic<uint32_t> data[2][WORDS];
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "speed_profile.h"
+#include <algorithm>
+
+
+void SpeedProfile::reset(int16_t speed) {
+    v_q16 = static_cast<int32_t>(speed) * 65536;
+    a_q16 = 0;
+    output = speed;
+}
+
+int16_t SpeedProfile::step(int16_t current, int16_t target, uint32_t accel, uint32_t decel, uint32_t jerk,
+                           uint32_t dt_us) {
+    if (current != output) reset(current);
+
+    // the tick length rarely changes: one 64-bit division when it does
+    if (dt_us != cached_dt_us) {
+        cached_dt_us = dt_us;
+        dt_q20 = static_cast<uint32_t>((static_cast<uint64_t>(dt_us) << 20) / 1000000);
+    }
+
+    int32_t target_q16 = static_cast<int32_t>(target) * 65536;
+    int32_t err = target_q16 - v_q16;
+    if (err == 0 && a_q16 == 0) return output;
+
+    int32_t da = static_cast<int32_t>((static_cast<int64_t>(jerk) * dt_q20) >> 4);
+
+    // Within one step's reach (|a|*dt + j*dt^2/2) the target is reached this tick. On long
+    // ticks the step overshoots the braking point, and the acceleration would flip sign every
+    // tick and stop the speed short of the target for good
+    int64_t abs_a = a_q16 < 0 ? -static_cast<int64_t>(a_q16) : a_q16;
+    int64_t reach = ((abs_a * dt_q20) >> 20) + ((static_cast<int64_t>(da) * dt_q20) >> 21);
+    if ((err < 0 ? -static_cast<int64_t>(err) : err) <= reach) {
+        v_q16 = target_q16;
+        a_q16 = 0;
+        output = target;
+        return output;
+    }
+
+    // Speed still gained while the acceleration is ramped down to zero is a*|a| / 2j.
+    // Compared as 2j * err against a*|a| (both Q16 speed scaled by 2j), no division
+    int64_t a_q8 = a_q16 / 256;
+    int64_t coast = a_q8 * (a_q8 < 0 ? -a_q8 : a_q8);
+    int64_t remaining = static_cast<int64_t>(err) * 2 * jerk - coast;
+
+    int32_t dir = remaining > 0 ? 1 : (remaining < 0 ? -1 : 0);
+
+    // accel while speeding up (away from zero), decel while slowing down
+    bool speeding_up = v_q16 == 0 || (v_q16 > 0) == (dir > 0);
+    int32_t a_goal = dir * static_cast<int32_t>((speeding_up ? accel : decel) * 65536);
+
+    if (a_q16 < a_goal) {
+        a_q16 = std::min(a_q16 + da, a_goal);
+    } else {
+        a_q16 = std::max(a_q16 - da, a_goal);
+    }
+
+    int32_t next = v_q16 + static_cast<int32_t>((static_cast<int64_t>(a_q16) * dt_q20) >> 20);
+
+    // reached or passed the target: settle there, the acceleration is near zero by now
+    if ((err > 0 && next >= target_q16) || (err < 0 && next <= target_q16)) {
+        next = target_q16;
+        a_q16 = 0;
+    }
+
+    v_q16 = next;
+    output = static_cast<int16_t>((v_q16 + 32768) >> 16);
+    return output;
+}
@@ -0,0 +1,50 @@
+#ifndef MOTORS_SPEED_PROFILE_H
+#define MOTORS_SPEED_PROFILE_H
+
+#include <cstdint>
+
+/*
+ Jerk-limited (S-curve) speed profile for the DC wheel motors.
+
+ Every step() replans from the current speed and acceleration toward the
+ target: the acceleration ramps toward the limit at no more than the jerk
+ limit, and ramps back down early enough (a*|a| / 2j before the target)
+ that the speed arrives at the target with the acceleration near zero.
+ A new target takes effect on the next step, from whatever speed and
+ acceleration the profile has at that moment. Once the target is within one
+ step's reach (|a|*dt + j*dt^2/2) the speed settles on it, so long ticks
+ cannot leave the acceleration flipping around a target it never reaches.
+
+ All integer: speed and acceleration in Q16, tick time in Q20 seconds
+ (computed once per tick length), 64-bit products, no division per tick.
+
+ When the speed is changed outside the profile (stop, inertia, spin mode),
+ step() notices that current differs from its last output and restarts
+ from there with zero acceleration.
+*/
+class SpeedProfile {
+public:
+    /*
+     Speed for the next tick of dt_us, moving current toward target.
+     accel - limit while |speed| grows, decel - while it shrinks (units/s)
+     jerk - limit of the acceleration change (units/s^2)
+    */
+    int16_t step(int16_t current, int16_t target, uint32_t accel, uint32_t decel, uint32_t jerk,
+                 uint32_t dt_us);
+
+    // Start from speed, at rest (zero acceleration)
+    void reset(int16_t speed);
+
+    // Current acceleration, units/s
+    int32_t get_accel() const { return a_q16 / 65536; }
+
+private:
+    int32_t v_q16{0};           // speed, Q16
+    int32_t a_q16{0};           // acceleration, units/s Q16
+    int16_t output{0};          // last speed returned by step()
+
+    uint32_t cached_dt_us{0};
+    uint32_t dt_q20{0};         // cached_dt_us in seconds, Q20
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "steering_cache.h"
+#include "esp_log.h"
+#include <cmath>
+#include <math.h>
+
+static_assert(SteeringCache::ENTRIES < 0xffff, "SteeringCache index does not fit");
+
+// Wheel on the other side of the rover at the same position (the board is symmetric)
+static constexpr uint8_t MIRROR_WHEEL[6] = {
+    Board::mirror_of(0), Board::mirror_of(1), Board::mirror_of(2),
+    Board::mirror_of(3), Board::mirror_of(4), Board::mirror_of(5),
+};
+// The same for the steerable wheels, Board::STEERING order
+static constexpr uint8_t MIRROR_STEERABLE[4] = {
+    Board::slot_of(Board::mirror_of(Board::STEERING[0])), Board::slot_of(Board::mirror_of(Board::STEERING[1])),
+    Board::slot_of(Board::mirror_of(Board::STEERING[2])), Board::slot_of(Board::mirror_of(Board::STEERING[3])),
+};
+
+
+void SteeringCache::build(WheelTable& wheels) {
+    for (size_t k = 0; k < ENTRIES; k++) {
+        float rvr_angle = Kinematics::STRAIGHT_ANGLE + k * STEP;
+        // STRAIGHT_ANGLE itself is solved as straight movement, the table starts just above it
+        if (k == 0) rvr_angle = nextafterf(rvr_angle, Cfg::WHEEL_MAX_DEVIATION);
+
+        int32_t rvr_radius = Kinematics::Active::turn_radius(rvr_angle);
+        uint32_t radius[6];
+        wheels.for_each([&](uint8_t i, auto& wheel) {
+            wheel.update_geometry(rvr_radius);
+            radius[i] = wheel.get_radius();
+        });
+
+        uint32_t maxR = radius[0];
+        for (uint8_t i = 1; i < 6; i++)
+            if (radius[i] > maxR)
+                maxR = radius[i];
+
+        Entry& entry = table[k];
+        for (uint8_t i = 0; i < 6; i++) {
+            entry.ratio[i] = static_cast<uint16_t>(
+                ((uint64_t)radius[i] * RATIO_ONE + maxR / 2) / maxR);
+        }
+
+        for (uint8_t i = 0; i < 4; i++) {
+            SteerableWheel& wheel = wheels.steerable(i);
+            float angle = wheel.get_angle();
+            entry.angle[i] = static_cast<int16_t>(lroundf(angle * 100.0f));
+            entry.duty[i] = wheel.get_duty();
+
+            wheel.set_angle(-angle);
+            entry.mirror_duty[i] = wheel.get_duty();
+        }
+    }
+
+    wheels.for_each([](uint8_t, auto& wheel) { wheel.update_geometry(Kinematics::STRAIGHT_RADIUS); });
+
+    // the same speed for every wheel, as DriveSystem drives straight
+    for (uint8_t i = 0; i < 6; i++) straight.ratio[i] = RATIO_ONE;
+    for (uint8_t i = 0; i < 4; i++) {
+        SteerableWheel& wheel = wheels.steerable(i);
+        straight.angle[i] = static_cast<int16_t>(lroundf(wheel.get_angle() * 100.0f));
+        straight.duty[i] = wheel.get_duty();
+        straight.mirror_duty[i] = wheel.get_duty();
+    }
+
+    ESP_LOGI(TAG, "%u entries, %.2f deg step, %u bytes",
+             static_cast<unsigned>(ENTRIES), STEP, static_cast<unsigned>(sizeof(table) + sizeof(straight)));
+}
+
+void SteeringCache::lookup(float rvr_angle, Solution& out) const {
+    bool mirrored = rvr_angle < 0.0f;
+    float magnitude = fabsf(rvr_angle);
+    if (magnitude > Cfg::WHEEL_MAX_DEVIATION) magnitude = Cfg::WHEEL_MAX_DEVIATION;
+
+    const Entry* first;
+    const Entry* second;
+    int32_t frac;
+    if (magnitude < Kinematics::STRAIGHT_ANGLE) {
+        // below the table: from straight movement into its first entry
+        first = &straight;
+        second = &table[0];
+        frac = static_cast<int32_t>(magnitude * (256.0f / Kinematics::STRAIGHT_ANGLE));
+    } else {
+        // table position in Q8
+        uint32_t position = static_cast<uint32_t>((magnitude - Kinematics::STRAIGHT_ANGLE) * (256.0f / STEP));
+        uint32_t index = position >> 8;
+        frac = position & 0xff;
+        if (index >= ENTRIES - 1) {
+            index = ENTRIES - 1;
+            frac = 0;
+        }
+        first = &table[index];
+        second = frac ? &table[index + 1] : first;
+    }
+
+    const Entry& e0 = *first;
+    const Entry& e1 = *second;
+
+    for (uint8_t i = 0; i < 6; i++) {
+        uint8_t src = mirrored ? MIRROR_WHEEL[i] : i;
+        out.ratio[i] = static_cast<uint16_t>(
+            e0.ratio[src] + (((e1.ratio[src] - e0.ratio[src]) * frac + 128) >> 8));
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t src = mirrored ? MIRROR_STEERABLE[i] : i;
+        int32_t angle = e0.angle[src] + (((e1.angle[src] - e0.angle[src]) * frac + 128) >> 8);
+
+        // the mirrored wheel turns the same amount to the other side
+        const uint16_t* d0 = mirrored ? e0.mirror_duty : e0.duty;
+        const uint16_t* d1 = mirrored ? e1.mirror_duty : e1.duty;
+        int32_t duty = d0[src] + (((d1[src] - d0[src]) * frac + 128) >> 8);
+
+        out.angle[i] = (mirrored ? -angle : angle) * 0.01f;
+        out.duty[i] = static_cast<uint16_t>(duty);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef MOTORS_STEERING_CACHE_H
+#define MOTORS_STEERING_CACHE_H
+
+#include "kinematics.h"
+#include "wheel_table.h"
+#include <cstddef>
+#include <cstdint>
+
+/*
+ Precomputed steering solution for every rover angle.
+
+ build() runs the wheels' own update_geometry() (so the Float or Fixed
+ kinematics, whichever is active) for rover angles from STRAIGHT_ANGLE up to
+ WHEEL_MAX_DEVIATION in STEP increments and stores per entry:
+    * speed ratio of every wheel (wheel radius / largest radius, Q15)
+    * steering angle of every steerable wheel (0.01 degree)
+    * servo duty of every steerable wheel, for both turn sides
+
+ Negative rover angles reuse the table with left and right wheels swapped,
+ the rover being symmetric around its Y axis. Rover angles below
+ STRAIGHT_ANGLE, which the kinematics solve as straight movement, blend
+ from straight movement into the first entry, so a heading hold trim of a
+ fraction of a degree still steers by a fraction of a degree.
+
+ lookup() interpolates linearly between the two nearest entries. Against a
+ direct solve with the same kinematics it stays within 5 internal speed units,
+ 0.25 degree of wheel angle and 4 servo duty steps (0.1 degree with the
+ fixed-point path; the float path's own noise is up to 0.3 degree).
+ Where the direct solve has a kink - steerable wheels reaching the
+ WHEEL_MAX_DEVIATION clamp, or held straight while the turn radius is above
+ 16 m just past STRAIGHT_ANGLE - the table blends across it instead.
+ Rover angles beyond +-WHEEL_MAX_DEVIATION are clamped.
+*/
+class SteeringCache {
+public:
+    // Table step, degrees of rover angle
+    static constexpr float STEP = 0.25f;
+
+    static constexpr size_t ENTRIES = static_cast<size_t>(
+        (Cfg::WHEEL_MAX_DEVIATION - Kinematics::STRAIGHT_ANGLE) / STEP) + 1;
+
+    // Fixed-point one for the speed ratios
+    static constexpr uint32_t RATIO_ONE = 1u << 15;
+
+    struct Solution {
+        uint16_t ratio[6];      // Q15, Board::WHEELS order
+        float angle[4];         // degrees, Board::STEERING order
+        uint16_t duty[4];
+    };
+
+    // Fill the table with the geometry of wheels; they are left in straight geometry
+    void build(WheelTable& wheels);
+
+    // Steering solution for rover angle (rvr_angle != 0)
+    void lookup(float rvr_angle, Solution& out) const;
+
+private:
+    struct Entry {
+        uint16_t ratio[6];
+        int16_t angle[4];       // 0.01 degree
+        uint16_t duty[4];       // servo duty for  angle
+        uint16_t mirror_duty[4];// servo duty for -angle
+    };
+
+    Entry table[ENTRIES];
+    // Rover angle 0, the start of the blend below the table
+    Entry straight;
+
+    const char* TAG = "SteeringCache";
+};
+
+#endif
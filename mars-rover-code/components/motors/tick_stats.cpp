@@ -0,0 +1,88 @@
+#include "tick_stats.h"
+#include "motors_cfg.h"
+#include <cstdio>
+
+
+void CycleHistogram::reset() {
+    for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint32_t CycleHistogram::percentile(float fraction) const {
+    uint32_t total = get_count();
+    if (!total) return 0;
+
+    uint32_t target = static_cast<uint32_t>(total * fraction);
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+        seen += get_bucket(i);
+        if (seen > target) return i == BUCKETS - 1 ? UINT32_MAX : 2u << i;
+    }
+    return get_max();
+}
+
+void TickStats::apply_reset() {
+    if (!reset_requested.exchange(false, std::memory_order_relaxed)) return;
+
+    for (auto& h : phase) h.reset();
+    wake_us.reset();
+    for (auto& h : input_us) h.reset();
+    tick_overruns.store(0, std::memory_order_relaxed);
+    missed_periods.store(0, std::memory_order_relaxed);
+}
+
+const char* TickStats::phase_name(uint8_t phase) {
+    static const char* const names[] = { "state", "handler", "kinematics", "flush", "tick" };
+    return phase < PHASE_COUNT ? names[phase] : "?";
+}
+
+void TickStats::record_input(const InputTiming& timing, int64_t taken_us, int64_t flushed_us) {
+    input_us[INPUT_PARSE].record(static_cast<uint32_t>(timing.parsed_us - timing.rx_us));
+    input_us[INPUT_PLATFORM].record(static_cast<uint32_t>(timing.posted_us - timing.parsed_us));
+    input_us[INPUT_MAILBOX].record(static_cast<uint32_t>(taken_us - timing.posted_us));
+    input_us[INPUT_TICK].record(static_cast<uint32_t>(flushed_us - taken_us));
+    input_us[INPUT_TOTAL].record(static_cast<uint32_t>(flushed_us - timing.rx_us));
+}
+
+const char* TickStats::input_stage_name(uint8_t stage) {
+    static const char* const names[] = { "parse", "platform", "mailbox", "to flush", "input total" };
+    return stage < INPUT_STAGE_COUNT ? names[stage] : "?";
+}
+
+// per_us: cycles per microsecond for a cycle histogram, 0 when it already counts microseconds
+static void print_histogram(const char* name, const char* unit, const CycleHistogram& h,
+                            uint32_t per_us, bool buckets) {
+    printf("%-11s %9lu %9lu %9lu %9lu", name,
+           (unsigned long)h.get_count(), (unsigned long)h.percentile(0.5f),
+           (unsigned long)h.percentile(0.99f), (unsigned long)h.get_max());
+    if (per_us) printf(" %10lu", (unsigned long)(h.get_max() / per_us));
+    printf("\n");
+    if (!buckets) return;
+
+    for (uint8_t i = 0; i < CycleHistogram::BUCKETS; i++) {
+        uint32_t n = h.get_bucket(i);
+        if (n) printf("    < %10llu %s: %lu\n", 2ull << i, unit, (unsigned long)n);
+    }
+}
+
+void TickStats::print(bool buckets) const {
+    constexpr uint32_t cycles_per_us = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+
+    printf("Control loop %u Hz, period %lu us, CPU %u MHz\n",
+           Cfg::CONTROL_RATE_HZ, (unsigned long)Cfg::TICK_PERIOD_US, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    printf("%-11s %9s %9s %9s %9s %10s\n", "cycles", "count", "p50 <", "p99 <", "max", "max us");
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        print_histogram(phase_name(i), "cycles", phase[i], cycles_per_us, buckets);
+    }
+
+    printf("%-11s %9s %9s %9s %9s\n", "us", "count", "p50 <", "p99 <", "max");
+    print_histogram("wake-up", "us", wake_us, 0, buckets);
+    for (uint8_t i = 0; i < INPUT_STAGE_COUNT; i++) {
+        print_histogram(input_stage_name(i), "us", input_us[i], 0, buckets);
+    }
+
+    printf("tick overruns: %lu, missed periods: %lu\n",
+           (unsigned long)tick_overruns.load(std::memory_order_relaxed),
+           (unsigned long)missed_periods.load(std::memory_order_relaxed));
+}
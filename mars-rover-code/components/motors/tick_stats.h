@@ -0,0 +1,112 @@
+#ifndef MOTORS_TICK_STATS_H
+#define MOTORS_TICK_STATS_H
+
+#include "drive_command.h"
+#include "sdkconfig.h"
+#include <atomic>
+#include <cstdint>
+
+/*
+ Log2 histogram of durations.
+ Bucket i counts values in [2^i, 2^(i+1)), bucket 0 also counts 0.
+
+ One writer; readers on other threads see every word whole, but the words
+ of one histogram are not a consistent set (a count may be one ahead of the
+ buckets). Good enough for statistics.
+*/
+class CycleHistogram {
+public:
+    static constexpr uint8_t BUCKETS = 32;
+
+    // Writer only
+    void record(uint32_t value) {
+        uint8_t bucket = value ? 31 - __builtin_clz(value) : 0;
+        bump(buckets[bucket]);
+        bump(count);
+        if (value > max.load(std::memory_order_relaxed)) max.store(value, std::memory_order_relaxed);
+    }
+
+    // Writer only
+    void reset();
+
+    uint32_t get_count() const { return count.load(std::memory_order_relaxed); }
+    uint32_t get_max() const { return max.load(std::memory_order_relaxed); }
+    uint32_t get_bucket(uint8_t i) const { return buckets[i].load(std::memory_order_relaxed); }
+
+    // Upper bound (exclusive) of the bucket holding the given fraction (0..1) of the values
+    uint32_t percentile(float fraction) const;
+
+private:
+    // single writer: a plain load and store, no read-modify-write needed
+    static void bump(std::atomic<uint32_t>& word) {
+        word.store(word.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> buckets[BUCKETS]{};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> max{0};
+};
+
+/*
+ Timing of the control loop, in CPU cycles (esp_cpu_get_cycle_count())
+ unless noted otherwise.
+
+ Written by the tick task only; print() and request_reset() can be used
+ from any thread (e.g. the rover_stats console command).
+*/
+class TickStats {
+public:
+    enum Phase : uint8_t {
+        PHASE_STATE,        // apply_commands() + update_state()
+        PHASE_HANDLER,      // state handler + apply_inertia()
+        PHASE_KINEMATICS,   // wheel speeds and steering into the buffer
+        PHASE_FLUSH,        // PCA9685Buffer::flush() calls; with the async flush task
+                            // only the hand-off to it, not the I2C write
+        PHASE_TICK,         // whole DriveSystem::tick()
+        PHASE_COUNT
+    };
+
+    CycleHistogram phase[PHASE_COUNT];
+
+    enum InputStage : uint8_t {
+        INPUT_PARSE,        // L2CAP receive to parsed report
+        INPUT_PLATFORM,     // parsed report to command posted
+        INPUT_MAILBOX,      // posted to taken by the tick
+        INPUT_TICK,         // taken to the first PCA9685Buffer::flush() after it returned
+                            // (async flush: handed to the flush task, not yet on the bus)
+        INPUT_TOTAL,        // L2CAP receive to that flush
+        INPUT_STAGE_COUNT
+    };
+
+    // Control timer alarm to tick task wake-up, microseconds
+    CycleHistogram wake_us;
+
+    // Controller input to actuator latency by stage, microseconds
+    CycleHistogram input_us[INPUT_STAGE_COUNT];
+
+    // Tick task: record the latency of a timed command that was taken at taken_us
+    // and whose first flush returned at flushed_us
+    void record_input(const InputTiming& timing, int64_t taken_us, int64_t flushed_us);
+
+    // tick() took longer than a control period
+    std::atomic<uint32_t> tick_overruns{0};
+    // Timer periods that passed without a tick (the loop fell behind)
+    std::atomic<uint32_t> missed_periods{0};
+
+    // Tick task: apply a pending reset request
+    void apply_reset();
+
+    // Any thread: clear everything at the start of the next tick
+    void request_reset() { reset_requested.store(true, std::memory_order_relaxed); }
+
+    // Any thread: print a summary of all histograms to stdout
+    void print(bool buckets) const;
+
+    static const char* phase_name(uint8_t phase);
+    static const char* input_stage_name(uint8_t stage);
+
+private:
+    std::atomic<bool> reset_requested{false};
+};
+
+#endif
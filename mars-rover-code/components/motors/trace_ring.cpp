@@ -0,0 +1,97 @@
+#include "trace_ring.h"
+#include "esp_log.h"
+#include <cstdio>
+
+
+bool TraceRing::pop(TraceRecord& out) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+
+    out = records[t & (RECORDS - 1)];
+    // the slot may be reused by the producer once tail moves past it
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+void TraceRing::print(const TraceRecord& rec) {
+    ESP_LOGI(TAG, "#%lu %lu us | State: %s | Speed: %d/%d | Angle: %.1f/%.1f | Inertia: %u ms | "
+             "Spinning: %s | Front: %.1f/%.1f%s%s%s%s%s",
+             (unsigned long)rec.seq, (unsigned long)rec.time_us,
+             drive_state_name(static_cast<DriveState>(rec.state)),
+             rec.mem_speed, rec.dest_speed,
+             rec.mem_angle / 100.0f, rec.dest_angle / 100.0f,
+             rec.inertia_ms,
+             (rec.flags & TRACE_SPINNING) ? "YES" : "NO",
+             rec.front_angle[0] / 100.0f, rec.front_angle[1] / 100.0f,
+             (rec.flags & TRACE_SPIN_FRONT_SET) ? " | front set" : "",
+             (rec.flags & TRACE_SPIN_BACK_SET) ? " | back set" : "",
+             (rec.flags & TRACE_EMERGENCY_STOP) ? " | EMERGENCY STOP" : "",
+             (rec.flags & TRACE_REPLAY_START) ? " | replay start" : "",
+             (rec.flags & TRACE_REPLAY_END) ? " | replay end" : "");
+}
+
+void TraceRing::drain() {
+    DrainMode mode = get_drain_mode();
+    uint32_t count = 0;
+
+    TraceRecord rec;
+    while (pop(rec)) {
+        count++;
+        switch (mode) {
+            case DrainMode::OFF:
+                break;
+            case DrainMode::TEXT:
+                print(rec);
+                break;
+            case DrainMode::RAW: {
+                uint16_t sync = RAW_SYNC;
+                fwrite(&sync, sizeof(sync), 1, stdout);
+                fwrite(&rec, sizeof(rec), 1, stdout);
+                break;
+            }
+        }
+    }
+
+    if (mode == DrainMode::RAW && count) fflush(stdout);
+}
+
+void TraceRing::drain_task_function(void* param) {
+    TraceRing* ring = static_cast<TraceRing*>(param);
+    uint32_t reported_dropped = 0;
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_PERIOD_MS));
+        ring->drain();
+
+        // a text line would corrupt the raw stream
+        uint32_t lost = ring->get_dropped();
+        if (lost != reported_dropped && ring->get_drain_mode() == DrainMode::TEXT) {
+            ESP_LOGW(TAG, "%lu records dropped, drain too slow", (unsigned long)(lost - reported_dropped));
+        }
+        reported_dropped = lost;
+    }
+}
+
+esp_err_t TraceRing::start_drain(const char* task_name, UBaseType_t priority, BaseType_t core_id) {
+    if (drain_task) {
+        ESP_LOGW(TAG, "Drain task already running");
+        return ESP_OK;
+    }
+
+    BaseType_t result;
+    if (core_id == tskNO_AFFINITY) {
+        result = xTaskCreate(drain_task_function, task_name, 4096, this, priority, &drain_task);
+    } else {
+        result = xTaskCreatePinnedToCore(drain_task_function, task_name, 4096, this,
+                                         priority, &drain_task, core_id);
+    }
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create drain task");
+        drain_task = nullptr;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Trace drain task started: %s, %lu records", task_name, (unsigned long)RECORDS);
+    return ESP_OK;
+}
@@ -0,0 +1,114 @@
+#ifndef MOTORS_TRACE_RING_H
+#define MOTORS_TRACE_RING_H
+
+#include "rover_state.h"
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstdint>
+
+// TraceRecord::flags
+enum TraceFlags : uint8_t {
+    TRACE_SPINNING       = 0x01,    // spin mode requested
+    TRACE_SPIN_FRONT_SET = 0x02,    // front wheels reached SPIN_FRONT_ANGLE
+    TRACE_SPIN_BACK_SET  = 0x04,    // back wheels reached SPIN_BACK_ANGLE
+    TRACE_EMERGENCY_STOP = 0x08,    // emergency stop applied in this tick
+    TRACE_REPLAY_START   = 0x10,    // first tick of a session replay
+    TRACE_REPLAY_END     = 0x20,    // the replay ended in this tick
+};
+
+/*
+ One DriveSystem tick, as DriveSystem::tick() leaves it.
+ Angles are in 0.01 degree, speeds in internal units.
+*/
+struct __attribute__((packed)) TraceRecord {
+    uint32_t seq;               // tick number (RoverStateSnapshot::seq)
+    uint32_t time_us;           // esp_timer time, low 32 bits
+    uint8_t state;              // DriveState
+    uint8_t flags;              // TraceFlags
+    int16_t mem_speed;
+    int16_t dest_speed;
+    int16_t mem_angle;
+    int16_t dest_angle;
+    int16_t front_angle[2];     // left front, right front wheel
+    uint16_t inertia_ms;        // inertia time remaining, saturated
+};
+
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord is a wire format, keep it packed");
+
+/*
+ Lock-free binary trace of the drive tick.
+
+ The tick task pushes one fixed-size record per tick; a low priority drain
+ task empties the ring every DRAIN_PERIOD_MS and, depending on the drain
+ mode, drops the records, logs them as text or writes them raw to stdout.
+ push() is a handful of loads and stores whatever the log level or drain
+ mode; formatting and the UART happen on the drain task only.
+
+ Single producer (tick task), single consumer (drain task). When the drain
+ falls behind, new records are dropped and counted, the producer never waits.
+
+ Raw stream: every record is sent as RAW_SYNC (2 bytes, little endian)
+ followed by the 24 byte TraceRecord, little endian as in memory. The sync
+ word lets a host decoder skip log lines interleaved with the stream.
+*/
+class TraceRing {
+public:
+    static constexpr uint32_t RECORDS = CONFIG_MOTORS_TRACE_RING_RECORDS;
+    static_assert((RECORDS & (RECORDS - 1)) == 0, "MOTORS_TRACE_RING_RECORDS must be a power of two");
+
+    static constexpr uint16_t RAW_SYNC = 0x5aa5;
+    static constexpr uint32_t DRAIN_PERIOD_MS = 100;
+
+    enum class DrainMode : uint8_t {
+        OFF,    // discard records, keeps the ring fresh for when tracing is turned on
+        TEXT,   // ESP_LOGI one line per record
+        RAW,    // binary records on stdout
+    };
+
+    // Producer: append rec, wait-free; dropped when the ring is full
+    void push(const TraceRecord& rec) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= RECORDS) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        records[h & (RECORDS - 1)] = rec;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Consumer: oldest record, false when the ring is empty
+    bool pop(TraceRecord& out);
+
+    // Records lost because the ring was full
+    uint32_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Any thread: what the drain task does with the records from now on
+    void set_drain_mode(DrainMode mode) { drain_mode.store(mode, std::memory_order_relaxed); }
+    DrainMode get_drain_mode() const { return drain_mode.load(std::memory_order_relaxed); }
+
+    // Start the drain task
+    esp_err_t start_drain(const char* task_name, UBaseType_t priority, BaseType_t core_id = tskNO_AFFINITY);
+
+    // Log rec as one line of text
+    static void print(const TraceRecord& rec);
+
+private:
+    TraceRecord records[RECORDS];
+    std::atomic<uint32_t> head{0};          // written by the producer
+    std::atomic<uint32_t> tail{0};          // written by the consumer
+    std::atomic<uint32_t> dropped{0};       // written by the producer
+
+    std::atomic<DrainMode> drain_mode{DrainMode::OFF};
+    TaskHandle_t drain_task{nullptr};
+
+    // Empty the ring according to the drain mode
+    void drain();
+    static void drain_task_function(void* param);
+
+    static constexpr const char* TAG = "TraceRing";
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "wheel_encoders.h"
+#include "esp_log.h"
+#include <algorithm>
+
+// PCNT limits: the driver extends the count past them (accum_count)
+static constexpr int PCNT_HIGH_LIMIT = 30000;
+static constexpr int PCNT_LOW_LIMIT = -30000;
+
+
+esp_err_t WheelEncoders::init(const gpio_num_t pins[WHEELS][2]) {
+    for (uint8_t i = 0; i < WHEELS; i++) {
+        esp_err_t err = init_unit(i, pins[i][0], pins[i][1]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Encoder %u (GPIO %d/%d): %s", i, pins[i][0], pins[i][1], esp_err_to_name(err));
+            release();
+            return err;
+        }
+    }
+
+    ready = true;
+    ESP_LOGI(TAG, "%u encoders, speed over %lu ticks", WHEELS, (unsigned long)WINDOW_TICKS);
+    return ESP_OK;
+}
+
+esp_err_t WheelEncoders::init_unit(uint8_t wheel, gpio_num_t a, gpio_num_t b) {
+    pcnt_unit_config_t unit_config = {
+        .low_limit = PCNT_LOW_LIMIT,
+        .high_limit = PCNT_HIGH_LIMIT,
+        .intr_priority = 0,
+        .flags = {
+            .accum_count = 1,
+        },
+    };
+    pcnt_unit_handle_t unit = nullptr;
+    esp_err_t err = pcnt_new_unit(&unit_config, &unit);
+    if (err != ESP_OK) return err;
+    units[wheel] = unit;
+
+    pcnt_glitch_filter_config_t filter_config = {
+        .max_glitch_ns = CONFIG_MOTORS_ENCODER_GLITCH_NS,
+    };
+    if (CONFIG_MOTORS_ENCODER_GLITCH_NS > 0) {
+        err = pcnt_unit_set_glitch_filter(unit, &filter_config);
+        if (err != ESP_OK) return err;
+    }
+
+    // x4 decoding: A edges gated by B, B edges gated by A
+    pcnt_chan_config_t chan_a_config = {
+        .edge_gpio_num = a,
+        .level_gpio_num = b,
+    };
+    pcnt_chan_config_t chan_b_config = {
+        .edge_gpio_num = b,
+        .level_gpio_num = a,
+    };
+    pcnt_channel_handle_t& chan_a = channels[wheel][0];
+    pcnt_channel_handle_t& chan_b = channels[wheel][1];
+    err = pcnt_new_channel(unit, &chan_a_config, &chan_a);
+    if (err != ESP_OK) return err;
+    err = pcnt_new_channel(unit, &chan_b_config, &chan_b);
+    if (err != ESP_OK) return err;
+
+    pcnt_channel_set_edge_action(chan_a, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+    pcnt_channel_set_level_action(chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    pcnt_channel_set_edge_action(chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+    pcnt_channel_set_level_action(chan_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+    // the driver carries the count over these limits
+    err = pcnt_unit_add_watch_point(unit, PCNT_HIGH_LIMIT);
+    if (err != ESP_OK) return err;
+    err = pcnt_unit_add_watch_point(unit, PCNT_LOW_LIMIT);
+    if (err != ESP_OK) return err;
+
+    err = pcnt_unit_enable(unit);
+    if (err != ESP_OK) return err;
+    unit_enabled[wheel] = true;
+    err = pcnt_unit_clear_count(unit);
+    if (err != ESP_OK) return err;
+    return pcnt_unit_start(unit);
+}
+
+void WheelEncoders::release() {
+    // the reverse of init(): a unit stopped and disabled, its channels before it
+    for (int wheel = WHEELS - 1; wheel >= 0; wheel--) {
+        if (unit_enabled[wheel]) {
+            pcnt_unit_stop(units[wheel]);
+            pcnt_unit_disable(units[wheel]);
+            unit_enabled[wheel] = false;
+        }
+        for (int side = 1; side >= 0; side--) {
+            if (channels[wheel][side]) pcnt_del_channel(channels[wheel][side]);
+            channels[wheel][side] = nullptr;
+        }
+        if (units[wheel]) pcnt_del_unit(units[wheel]);
+        units[wheel] = nullptr;
+    }
+}
+
+void WheelEncoders::sample(uint32_t dt_us) {
+    if (!ready) return;
+
+    constexpr uint32_t SLOTS = WINDOW_TICKS + 1;
+    uint32_t next = (head + 1) % SLOTS;
+
+    for (uint8_t i = 0; i < WHEELS; i++) {
+        int value = 0;
+        pcnt_unit_get_count(units[i], &value);
+        history[next][i] = value;
+    }
+
+    // the interval ending at the new oldest sample leaves the window
+    history_dt[next] = dt_us;
+    window_us += dt_us;
+    if (filled == WINDOW_TICKS) {
+        window_us -= history_dt[(next + 1) % SLOTS];
+    } else {
+        filled++;
+    }
+    uint32_t oldest = (next + SLOTS - filled) % SLOTS;
+    head = next;
+
+    if (window_us == 0) return;
+
+    // counts over the window -> speed units, one division shared by the six wheels
+    uint32_t scale_q16 = static_cast<uint32_t>(
+        (static_cast<uint64_t>(1000000) * Cfg::MOTOR_INTERNAL_MAX << 16) /
+        (static_cast<uint64_t>(CONFIG_MOTORS_ENCODER_COUNTS_PER_S_FULL) * window_us));
+
+    for (uint8_t i = 0; i < WHEELS; i++) {
+        int64_t delta = history[next][i] - history[oldest][i];
+        int64_t value = (delta * scale_q16) / 65536;
+        speed[i] = static_cast<int16_t>(std::clamp<int64_t>(value, INT16_MIN, INT16_MAX));
+    }
+}
+
+
+int32_t WheelSpeedPI::integral_gain(uint32_t dt_us) {
+    // KI_Q8 / 256 * dt / 1e6 in Q16
+    return static_cast<int32_t>((static_cast<uint64_t>(KI_Q8) * dt_us * 256) / 1000000);
+}
+
+int16_t WheelSpeedPI::update(int16_t setpoint, int16_t measured, int32_t ki_dt_q16) {
+    if (setpoint == 0) {
+        integral_q16 = 0;
+        return 0;
+    }
+
+    int32_t err = static_cast<int32_t>(setpoint) - measured;
+    int32_t previous = integral_q16;
+    integral_q16 = static_cast<int32_t>(std::clamp<int64_t>(
+        integral_q16 + static_cast<int64_t>(err) * ki_dt_q16,
+        -(MAX_TRIM << 16), MAX_TRIM << 16));
+
+    int32_t out = setpoint + KP_Q8 * err / 256 + integral_q16 / 65536;
+
+    // saturated: clamp, and hold the integral instead of winding it up further
+    int32_t low = setpoint > 0 ? 0 : -Cfg::MOTOR_INTERNAL_MAX;
+    int32_t high = setpoint > 0 ? Cfg::MOTOR_INTERNAL_MAX : 0;
+    if (out > high || out < low) {
+        if ((out > high) == (integral_q16 > previous)) integral_q16 = previous;
+        out = std::clamp(out, low, high);
+    }
+    return static_cast<int16_t>(out);
+}
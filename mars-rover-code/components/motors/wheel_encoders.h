@@ -0,0 +1,104 @@
+#ifndef MOTORS_WHEEL_ENCODERS_H
+#define MOTORS_WHEEL_ENCODERS_H
+
+#include "motors_cfg.h"
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include <cstdint>
+
+/*
+ Quadrature encoders of the six wheel motors, counted by the PCNT peripheral.
+
+ Every wheel takes one PCNT unit: both channels count the edges of one
+ encoder line gated by the level of the other, so every edge of A and B
+ counts (x4 decoding), up when the wheel turns forward. If a wheel counts
+ backwards, swap its A and B pins. The glitch filter drops pulses shorter
+ than CONFIG_MOTORS_ENCODER_GLITCH_NS. The 16 bit hardware counter is
+ extended in the driver (accum_count), so counts never wrap in practice.
+
+ sample() runs once per tick: it reads the six counters and measures the
+ wheel speeds over the last CONFIG_MOTORS_ENCODER_WINDOW_US of ticks (one
+ tick is far too few counts at high control rates), in the same internal
+ speed units as the wheel setpoints: CONFIG_MOTORS_ENCODER_COUNTS_PER_S_FULL
+ counts per second is Cfg::MOTOR_INTERNAL_MAX.
+
+ Wheel order is the order of Board::WHEELS.
+ Threads: init() once, the rest on the tick task.
+*/
+class WheelEncoders {
+public:
+    static constexpr uint8_t WHEELS = 6;
+
+    // Ticks in the speed window
+    static constexpr uint32_t WINDOW_TICKS =
+        CONFIG_MOTORS_ENCODER_WINDOW_US > Cfg::TICK_PERIOD_US ? CONFIG_MOTORS_ENCODER_WINDOW_US / Cfg::TICK_PERIOD_US : 1;
+
+    // A and B pin of every wheel
+    esp_err_t init(const gpio_num_t pins[WHEELS][2]);
+    bool is_ready() const { return ready; }
+
+    // Read the counters; dt_us - time since the previous sample
+    void sample(uint32_t dt_us);
+
+    // Speed of wheel measured over the window, internal speed units
+    int16_t get_speed(uint8_t wheel) const { return speed[wheel]; }
+    // Counts since init(), forward positive
+    int32_t get_count(uint8_t wheel) const { return history[head][wheel]; }
+    // Counts of the last sample
+    int32_t get_delta(uint8_t wheel) const {
+        return history[head][wheel] - history[(head + WINDOW_TICKS) % (WINDOW_TICKS + 1)][wheel];
+    }
+
+private:
+    pcnt_unit_handle_t units[WHEELS]{};
+    pcnt_channel_handle_t channels[WHEELS][2]{};
+    bool unit_enabled[WHEELS]{};
+    bool ready{false};
+
+    // counts at the end of the last WINDOW_TICKS + 1 samples and the time between them
+    int32_t history[WINDOW_TICKS + 1][WHEELS]{};
+    uint32_t history_dt[WINDOW_TICKS + 1]{};
+    uint32_t head{0};
+    uint32_t filled{0};             // samples in history, up to WINDOW_TICKS
+    uint32_t window_us{0};          // sum of history_dt over the window
+
+    int16_t speed[WHEELS]{};
+
+    esp_err_t init_unit(uint8_t wheel, gpio_num_t a, gpio_num_t b);
+    // Stop and delete the units and channels init() created so far
+    void release();
+
+    const char* TAG = "WheelEncoders";
+};
+
+
+/*
+ Fixed-point PI speed loop of one wheel.
+
+ The setpoint goes to the motor as before (feed-forward) and the loop only
+ adds a trim: KP * error + the integral of KI * error, the integral limited
+ to +-MAX_TRIM units and frozen while the output saturates. The output keeps
+ the sign of the setpoint (the loop never drives a wheel backwards) and a
+ zero setpoint stops the wheel and clears the integral.
+*/
+class WheelSpeedPI {
+public:
+    static constexpr int32_t KP_Q8 = CONFIG_MOTORS_WHEEL_PI_KP;         // 1/256
+    static constexpr int32_t KI_Q8 = CONFIG_MOTORS_WHEEL_PI_KI;         // 1/s, 1/256
+    static constexpr int32_t MAX_TRIM = CONFIG_MOTORS_WHEEL_PI_MAX_TRIM;
+
+    // KI * dt in Q16 for a tick of dt_us; once per tick, shared by all wheels
+    static int32_t integral_gain(uint32_t dt_us);
+
+    // Motor command for setpoint, given the measured wheel speed
+    int16_t update(int16_t setpoint, int16_t measured, int32_t ki_dt_q16);
+
+    void reset() { integral_q16 = 0; }
+
+private:
+    int32_t integral_q16{0};
+};
+
+#endif
@@ -1,9 +1,13 @@
 #include "wheel_motor.h"
+#include "kinematics.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "hal/ledc_types.h"
 #include "i2cdev.h"
 #include "pca9685.h"
+#if CONFIG_MOTORS_WHEEL_MCPWM
+#include "wheel_pwm.h"
+#endif
 #include <cmath>
 #include <math.h>
 #include <cstdint>
@@ -11,26 +15,6 @@
 #include <sys/types.h>
 
 
-uint32_t isqrt(uint32_t n) {
-    if (n == 0) return 0;
-    uint32_t x = n;
-    uint32_t y = (x + 1) / 2;
-    while (y < x) {
-        x = y;
-        y = (x + n / x) / 2;
-    }
-    return x;
-}
-
-
-// helper
-static inline uint16_t clamp_pwm(int32_t v) {
-    if (v <= 0) return 0;
-    if (v > 4095) return 4095;
-    return static_cast<uint16_t>(v);
-}
-
-
 WheelMotor::WheelMotor(uint8_t pca1, uint8_t pca2,
         const char *TAG,
         int16_t l, int16_t d)
@@ -38,15 +22,24 @@ WheelMotor::WheelMotor(uint8_t pca1, uint8_t pca2,
       TAG{TAG},
       l{l}, d{d}
 {
-    spin_radius = isqrt(static_cast<uint32_t>(
+    spin_radius = Kinematics::isqrt(static_cast<uint32_t>(
         (uint32_t)l * l +
         (uint32_t)d * d)
     );
 }
 
-void WheelMotor::update_buffer(int16_t speed, PCA9685Buffer* buffer) {
+void WheelMotor::write_motor(int16_t speed, PCA9685Buffer* buffer) {
     int32_t abs_speed = std::abs(static_cast<int32_t>(speed));
-    uint16_t pwm = clamp_pwm(static_cast<int32_t>(abs_speed * Cfg::MOTOR_SCALE));
+    uint16_t pwm = Kinematics::Active::motor_pwm(abs_speed);
+
+    wheel_duty = speed < 0 ? -static_cast<int16_t>(pwm) : static_cast<int16_t>(pwm);
+
+#if CONFIG_MOTORS_WHEEL_MCPWM
+    if (pwm_output) {
+        pwm_output->set_duty(pwm_index, wheel_duty);
+        return;
+    }
+#endif
 
     if (speed > 0) {
         buffer->set_channel_value(pca1, pwm);
@@ -58,7 +51,11 @@ void WheelMotor::update_buffer(int16_t speed, PCA9685Buffer* buffer) {
         buffer->set_channel_value(pca1, 0);
         buffer->set_channel_value(pca2, 0);
     }
-    // ESP_LOGD(TAG, "speed=%d -> pwm=%u (ch%u/%u)", speed, pwm, pca1, pca2);
+}
+
+void WheelMotor::update_buffer(int16_t speed, PCA9685Buffer* buffer) {
+    write_motor(speed, buffer);
+    // ESP_LOGD(TAG, "speed=%d -> pwm=%d (ch%u/%u)", speed, wheel_duty, pca1, pca2);
 }
 
 
@@ -80,27 +77,15 @@ SteerableWheel::SteerableWheel(uint8_t pca1, uint8_t pca2,
     : WheelMotor{pca1, pca2, TAG, l, d},
         servo_pca{servo_pca}
 {
-    spin_target_angle = -std::atanf(static_cast<float>(l) / static_cast<float>(d));
+    spin_target_angle = -atanf(static_cast<float>(l) / static_cast<float>(d));
 }
 
 void SteerableWheel::update_buffer(int16_t speed, PCA9685Buffer* buffer) {
-    int32_t abs_speed = std::abs(static_cast<int32_t>(speed));
-    uint16_t pwm = clamp_pwm(static_cast<int32_t>(abs_speed * Cfg::MOTOR_SCALE));
-
-    if (speed > 0) {
-        buffer->set_channel_value(pca1, pwm);
-        buffer->set_channel_value(pca2, 0);
-    } else if (speed < 0) {
-        buffer->set_channel_value(pca1, 0);
-        buffer->set_channel_value(pca2, pwm);
-    } else {
-        buffer->set_channel_value(pca1, 0);
-        buffer->set_channel_value(pca2, 0);
-    }
+    write_motor(speed, buffer);
 
     // servo_duty вже обчислено в update_geometry; тут записуємо без зміни
     buffer->set_channel_value(servo_pca, servo_duty);
-    // ESP_LOGD(TAG, "speed=%d -> pwm=%u, servo=%u (servo ch %u)", speed, pwm, servo_duty, servo_pca);
+    // ESP_LOGD(TAG, "speed=%d -> pwm=%d, servo=%u (servo ch %u)", speed, wheel_duty, servo_duty, servo_pca);
 }
 
 void SteerableWheel::update_geometry(int32_t rvr_radius) {
@@ -110,20 +95,10 @@ void SteerableWheel::update_geometry(int32_t rvr_radius) {
     } else {
 
         int8_t sign = (rvr_radius >= 0) ? 1 : -1;
-        //inner_radius = isqrt((uint32_t)(l*l + (rvr_radius - d) * (rvr_radius - d)));
-
-        int32_t l_squared = (int32_t)l * l;
         int32_t offset = rvr_radius - d;
-        int32_t offset_squared = offset * offset;
-
-        inner_radius = isqrt((uint32_t)(l_squared + offset_squared));
 
-        float ratio = (float)l / (float)inner_radius;
-        if (ratio > 1.0f) ratio = 1.0f;
-        if (ratio < -1.0f) ratio = -1.0f;
-
-        float angle_rad = asinf(ratio);
-        current_angle = angle_rad * 180.0f / PI;
+        inner_radius = Kinematics::Active::wheel_radius(l, offset);
+        current_angle = Kinematics::Active::wheel_angle(l, offset, inner_radius);
 
         current_angle *= sign;
 
@@ -161,4 +136,9 @@ float SteerableWheel::get_angle() {
 void SteerableWheel::set_angle(float angle) {
     current_angle = angle;
     update_duty();
-}
\ No newline at end of file
+}
+
+void SteerableWheel::set_steering(float angle, uint16_t duty) {
+    current_angle = angle;
+    servo_duty = duty;
+}
@@ -6,11 +6,16 @@
 #include <cstdint>
 #include <sys/types.h>
 
+class WheelPwm;
+
 /*
 Class for basic wheel motor (dc motor)
 
 Is used for motors that do not rotate
 and as a base class for SteerableWheel
+
+No virtual methods: SteerableWheel hides update_geometry() and
+update_buffer(), and WheelTable always calls them on the wheel's own type
 */
 class WheelMotor {
 protected:
@@ -19,6 +24,10 @@ protected:
     uint8_t pca1;
     uint8_t pca2;
 
+    // On-chip motor PWM replacing pca1/pca2, see set_pwm_output()
+    WheelPwm* pwm_output{nullptr};
+    uint8_t pwm_index{0};
+
     // Logging tag for debugging
     const char *TAG;
 
@@ -31,7 +40,10 @@ protected:
 
     //    Current inner radius of the wheel path
     uint32_t inner_radius{16000};
-    uint16_t wheel_duty{0}; // Current PWM duty cycle for the wheel
+    int16_t wheel_duty{0}; // Current PWM duty cycle for the wheel, negative when reversing
+
+    // Motor part of update_buffer(): wheel_duty to the PCA9685 channels or the on-chip PWM
+    void write_motor(int16_t speed, PCA9685Buffer* buffer);
 
 public:
 
@@ -43,13 +55,23 @@ public:
 
 
     //  Update wheel geometry based on radius of rover movement (rvr_radius)
-    virtual void update_geometry(int32_t rvr_radius);
+    void update_geometry(int32_t rvr_radius);
 
     // Writes speed value to PCA9685 buffer that will be flushed later
-    virtual void update_buffer(int16_t speed, PCA9685Buffer* buffer);
+    void update_buffer(int16_t speed, PCA9685Buffer* buffer);
+
+    // Drive the motor from wheel index of pwm instead of pca1/pca2 (which are left alone)
+    void set_pwm_output(WheelPwm* pwm, uint8_t index) { pwm_output = pwm; pwm_index = index; }
 
     // Get current inner radius
     uint32_t get_radius();
+
+    // Motor PWM written by the last update_buffer(), negative when reversing
+    int16_t get_wheel_duty() const { return wheel_duty; }
+
+    // Position of the wheel relative to the rover center
+    int16_t get_l() const { return l; }
+    int16_t get_d() const { return d; }
 };
 
 
@@ -80,17 +102,22 @@ public:
             int16_t l, int16_t d,
             uint8_t servo_pca);
 
-    /* Override methods from WheelMotor
+    /* Hide methods of WheelMotor
         Update wheel geometry based on rvr_radius and position of the wheel in space
     */
-    void update_geometry(int32_t rvr_radius) override;
+    void update_geometry(int32_t rvr_radius);
 
     void update_duty();
 
     void set_angle(float angle);
 
+    // Set angle together with its already known servo duty (see SteeringCache)
+    void set_steering(float angle, uint16_t duty);
+
+    uint16_t get_duty() const { return servo_duty; }
+
     // Writes speed and servo angle to PCA9685 buffer that will be flushed later
-    void update_buffer(int16_t speed, PCA9685Buffer* buffer) override;
+    void update_buffer(int16_t speed, PCA9685Buffer* buffer);
 
     // Get current angle of the wheel for logging/debugging
     float get_angle();
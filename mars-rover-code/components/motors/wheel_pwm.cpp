@@ -0,0 +1,145 @@
+#include "wheel_pwm.h"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstdlib>
+
+// Right wheels (Board::WHEELS 0..2) on group 0, left ones on group 1
+static constexpr uint8_t WHEELS_PER_GROUP = 3;
+
+
+esp_err_t WheelPwm::init(const gpio_num_t pins[WHEELS][2]) {
+    for (int group = 0; group < 2; group++) {
+        esp_err_t err = init_timer(group);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "MCPWM timer of group %d: %s", group, esp_err_to_name(err));
+            release();
+            return err;
+        }
+    }
+
+    for (uint8_t i = 0; i < WHEELS; i++) {
+        esp_err_t err = init_bridge(i, pins[i][0], pins[i][1]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Wheel %u (GPIO %d/%d): %s", i, pins[i][0], pins[i][1], esp_err_to_name(err));
+            release();
+            return err;
+        }
+    }
+
+    // the outputs are forced low, the timers may run
+    for (int group = 0; group < 2; group++) {
+        esp_err_t err = mcpwm_timer_enable(timers[group]);
+        timer_enabled[group] = err == ESP_OK;
+        if (err == ESP_OK) err = mcpwm_timer_start_stop(timers[group], MCPWM_TIMER_START_NO_STOP);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "MCPWM timer of group %d did not start: %s", group, esp_err_to_name(err));
+            release();
+            return err;
+        }
+    }
+
+    ready = true;
+    ESP_LOGI(TAG, "%u wheels at %d Hz, %lu steps per period",
+             WHEELS, CONFIG_MOTORS_WHEEL_PWM_FREQ_HZ, (unsigned long)PERIOD_TICKS);
+    return ESP_OK;
+}
+
+esp_err_t WheelPwm::init_timer(int group) {
+    mcpwm_timer_config_t timer_config = {};
+    timer_config.group_id = group;
+    timer_config.clk_src = MCPWM_TIMER_CLK_SRC_DEFAULT;
+    timer_config.resolution_hz = RESOLUTION_HZ;
+    timer_config.count_mode = MCPWM_TIMER_COUNT_MODE_UP;
+    timer_config.period_ticks = PERIOD_TICKS;
+    return mcpwm_new_timer(&timer_config, &timers[group]);
+}
+
+esp_err_t WheelPwm::init_bridge(uint8_t wheel, gpio_num_t a, gpio_num_t b) {
+    int group = wheel / WHEELS_PER_GROUP;
+    Bridge& bridge = bridges[wheel];
+
+    mcpwm_operator_config_t oper_config = {};
+    oper_config.group_id = group;
+    esp_err_t err = mcpwm_new_operator(&oper_config, &bridge.oper);
+    if (err != ESP_OK) return err;
+    err = mcpwm_operator_connect_timer(bridge.oper, timers[group]);
+    if (err != ESP_OK) return err;
+
+    const gpio_num_t side_pins[2] = {a, b};
+    for (int side = 0; side < 2; side++) {
+        mcpwm_comparator_config_t cmpr_config = {};
+        cmpr_config.flags.update_cmp_on_tez = true;
+        err = mcpwm_new_comparator(bridge.oper, &cmpr_config, &bridge.cmpr[side]);
+        if (err != ESP_OK) return err;
+
+        mcpwm_generator_config_t gen_config = {};
+        gen_config.gen_gpio_num = side_pins[side];
+        err = mcpwm_new_generator(bridge.oper, &gen_config, &bridge.gen[side]);
+        if (err != ESP_OK) return err;
+
+        // low until the first set_duty() for this side
+        err = mcpwm_generator_set_force_level(bridge.gen[side], 0, true);
+        if (err != ESP_OK) return err;
+
+        // high from the period start to the comparator
+        err = mcpwm_generator_set_action_on_timer_event(bridge.gen[side],
+            MCPWM_GEN_TIMER_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, MCPWM_TIMER_EVENT_EMPTY, MCPWM_GEN_ACTION_HIGH));
+        if (err != ESP_OK) return err;
+        err = mcpwm_generator_set_action_on_compare_event(bridge.gen[side],
+            MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, bridge.cmpr[side], MCPWM_GEN_ACTION_LOW));
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
+
+void WheelPwm::release() {
+    // the reverse of init(): generators and comparators before their operator,
+    // operators before the timers, a timer stopped and disabled before it goes
+    for (int wheel = WHEELS - 1; wheel >= 0; wheel--) {
+        Bridge& bridge = bridges[wheel];
+        for (int side = 1; side >= 0; side--) {
+            if (bridge.gen[side]) mcpwm_del_generator(bridge.gen[side]);
+            if (bridge.cmpr[side]) mcpwm_del_comparator(bridge.cmpr[side]);
+        }
+        if (bridge.oper) mcpwm_del_operator(bridge.oper);
+        bridge = Bridge{};
+    }
+
+    for (int group = 1; group >= 0; group--) {
+        if (!timers[group]) continue;
+        if (timer_enabled[group]) {
+            mcpwm_timer_start_stop(timers[group], MCPWM_TIMER_STOP_EMPTY);
+            mcpwm_timer_disable(timers[group]);
+            timer_enabled[group] = false;
+        }
+        mcpwm_del_timer(timers[group]);
+        timers[group] = nullptr;
+    }
+}
+
+void WheelPwm::set_duty(uint8_t wheel, int16_t value) {
+    if (!ready || wheel >= WHEELS || value == duty[wheel]) return;
+    Bridge& bridge = bridges[wheel];
+
+    if (value == 0) {
+        mcpwm_generator_set_force_level(bridge.gen[0], 0, true);
+        mcpwm_generator_set_force_level(bridge.gen[1], 0, true);
+    } else {
+        int on = value > 0 ? 0 : 1;
+        uint32_t pwm = std::min<uint32_t>(std::abs(value), Servo::MAX_DUTY);
+        // MAX_DUTY is always on, as on the PCA9685; the smallest duty still gives a pulse
+        uint32_t compare = std::max<uint32_t>(1, (pwm * PERIOD_TICKS + Servo::MAX_DUTY / 2) / Servo::MAX_DUTY);
+
+        mcpwm_comparator_set_compare_value(bridge.cmpr[on], compare);
+        // starting or reversing: the other side goes down first, then this one is let go
+        if (duty[wheel] == 0 || (duty[wheel] > 0) != (value > 0)) {
+            mcpwm_generator_set_force_level(bridge.gen[1 - on], 0, true);
+            mcpwm_generator_set_force_level(bridge.gen[on], -1, true);
+        }
+    }
+    duty[wheel] = value;
+}
+
+void WheelPwm::stop_all() {
+    for (uint8_t i = 0; i < WHEELS; i++) set_duty(i, 0);
+}
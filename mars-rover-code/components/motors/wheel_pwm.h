@@ -0,0 +1,67 @@
+#ifndef MOTORS_WHEEL_PWM_H
+#define MOTORS_WHEEL_PWM_H
+
+#include "motors_cfg.h"
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/mcpwm_prelude.h"
+#include <cstdint>
+
+/*
+ H-bridge PWM of the six wheel motors from the MCPWM peripheral.
+
+ The PCA9685 runs all its outputs at one frequency, which the servos
+ limit to Servo::FREQ; on chip the motors get CONFIG_MOTORS_WHEEL_PWM_FREQ_HZ,
+ above the audible range. The right wheels use MCPWM group 0, the left
+ ones group 1: one timer per group, one operator per wheel. Each operator
+ drives the A (forward) and B (reverse) input of its bridge, like the two
+ PCA9685 channels of a wheel did: the side in use goes high at the start
+ of every period and low at its comparator, the other one is forced low.
+
+ Duties are on the PCA9685 scale (0..4095 of a period) so the kinematics
+ do not change. A new duty takes effect at the next period start
+ (comparators update on timer empty), a few microseconds after
+ set_duty(); a reversal or a stop forces the outputs low at once.
+
+ Wheel order is the order of Board::WHEELS.
+ Threads: init() once, the rest on the tick task.
+*/
+class WheelPwm {
+public:
+    static constexpr uint8_t WHEELS = 6;
+    static constexpr uint32_t RESOLUTION_HZ = 80000000;
+    static constexpr uint32_t PERIOD_TICKS = RESOLUTION_HZ / CONFIG_MOTORS_WHEEL_PWM_FREQ_HZ;
+
+    // A and B pin of every wheel; all outputs start low. On failure nothing is left allocated
+    esp_err_t init(const gpio_num_t pins[WHEELS][2]);
+    bool is_ready() const { return ready; }
+
+    // duty - PCA9685 scale, positive drives A, negative B, 0 both low
+    void set_duty(uint8_t wheel, int16_t duty);
+
+    // All outputs low
+    void stop_all();
+
+private:
+    struct Bridge {
+        mcpwm_oper_handle_t oper;
+        mcpwm_cmpr_handle_t cmpr[2];
+        mcpwm_gen_handle_t gen[2];
+    };
+
+    mcpwm_timer_handle_t timers[2]{};
+    bool timer_enabled[2]{};
+    Bridge bridges[WHEELS]{};
+    int16_t duty[WHEELS]{};
+    bool ready{false};
+
+    esp_err_t init_timer(int group);
+    esp_err_t init_bridge(uint8_t wheel, gpio_num_t a, gpio_num_t b);
+    // Delete whatever init() created so far, in reverse order
+    void release();
+
+    const char* TAG = "WheelPwm";
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef MOTORS_WHEEL_TABLE_H
+#define MOTORS_WHEEL_TABLE_H
+
+#include "rover_board.h"
+#include "wheel_motor.h"
+#include <cstdint>
+#include <utility>
+
+/*
+ The wheels of Board, built at compile time from Board::WHEELS.
+
+ The wheels live inside the table, the steered ones in one array (in
+ Board::STEERING order) and the fixed ones in another. for_each() visits
+ them in Board::WHEELS order and, since the order and the kind of every
+ wheel are known at compile time, calls its function with the wheel's own
+ type: no virtual calls and no pointers to follow in the tick.
+*/
+class WheelTable {
+public:
+    static constexpr uint8_t COUNT = Board::WHEEL_COUNT;
+    static constexpr uint8_t STEERABLE = Board::STEERABLE_COUNT;
+
+    WheelTable()
+        : WheelTable(std::make_index_sequence<STEERABLE>{}, std::make_index_sequence<Board::FIXED_COUNT>{}) {}
+
+    // f(i, wheel) for every wheel, i its index in Board::WHEELS, wheel a SteerableWheel& or WheelMotor&
+    template <class F>
+    void for_each(F&& f) { visit_all(f, std::make_index_sequence<COUNT>{}); }
+
+    template <class F>
+    void for_each(F&& f) const { visit_all(f, std::make_index_sequence<COUNT>{}); }
+
+    // Steerable wheel k of Board::STEERING
+    SteerableWheel& steerable(uint8_t k) { return steer[k]; }
+    const SteerableWheel& steerable(uint8_t k) const { return steer[k]; }
+
+    // Wheel i of Board::WHEELS, steerable
+    template <uint8_t I>
+    SteerableWheel& steerable_at() {
+        static_assert(Board::WHEELS[I].steerable(), "wheel is not steered");
+        return steer[Board::slot_of(I)];
+    }
+
+private:
+    SteerableWheel steer[STEERABLE];
+    WheelMotor fixed[Board::FIXED_COUNT];
+
+    template <size_t... S, size_t... F>
+    WheelTable(std::index_sequence<S...>, std::index_sequence<F...>)
+        : steer{make_steerable(Board::WHEELS[Board::STEERING[S]])...},
+          fixed{make_fixed(Board::WHEELS[Board::fixed_wheel(F)])...} {}
+
+    static SteerableWheel make_steerable(const WheelSpec& w) {
+        return SteerableWheel{w.pca_fwd, w.pca_rev, w.tag, w.l, w.d, static_cast<uint8_t>(w.servo)};
+    }
+    static WheelMotor make_fixed(const WheelSpec& w) {
+        return WheelMotor{w.pca_fwd, w.pca_rev, w.tag, w.l, w.d};
+    }
+
+    template <uint8_t I, class F>
+    void visit(F& f) {
+        if constexpr (Board::WHEELS[I].steerable()) f(I, steer[Board::slot_of(I)]);
+        else f(I, fixed[Board::slot_of(I)]);
+    }
+    template <uint8_t I, class F>
+    void visit(F& f) const {
+        if constexpr (Board::WHEELS[I].steerable()) f(I, steer[Board::slot_of(I)]);
+        else f(I, fixed[Board::slot_of(I)]);
+    }
+
+    template <class F, size_t... I>
+    void visit_all(F& f, std::index_sequence<I...>) { (visit<I>(f), ...); }
+    template <class F, size_t... I>
+    void visit_all(F& f, std::index_sequence<I...>) const { (visit<I>(f), ...); }
+};
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * @file mpu6050.c
+ *
+ * ESP-IDF driver for the gyroscope FIFO of MPU6050 class IMUs
+ */
+
+#include "mpu6050.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_idf_lib_helpers.h>
+#include <esp_log.h>
+
+#define I2C_FREQ_HZ 400000 // 400 kHz, the fastest every part of the family takes
+
+#define REG_SMPLRT_DIV   0x19
+#define REG_CONFIG       0x1a
+#define REG_GYRO_CONFIG  0x1b
+#define REG_FIFO_EN      0x23
+#define REG_INT_ENABLE   0x38
+#define REG_INT_STATUS   0x3a
+#define REG_USER_CTRL    0x6a
+#define REG_PWR_MGMT_1   0x6b
+#define REG_FIFO_COUNTH  0x72
+#define REG_FIFO_R_W     0x74
+#define REG_WHO_AM_I     0x75
+
+#define GYRO_CONFIG_FS_SEL_BIT 3
+
+#define FIFO_EN_ZG       (1 << 4)
+
+#define INT_FIFO_OFLOW   (1 << 4)
+
+#define USER_CTRL_FIFO_EN    (1 << 6)
+#define USER_CTRL_FIFO_RESET (1 << 2)
+
+#define PWR_MGMT_1_DEVICE_RESET (1 << 7)
+#define PWR_MGMT_1_CLK_PLL_X    0x01
+
+#define GYRO_OUTPUT_RATE_HZ 1000 // with the low pass filter on
+
+#define RESET_DELAY_MS 100
+
+// The FIFO is 512 bytes or more on every part; from this level on the overflow flag is checked
+#define FIFO_CHECK_LEVEL 512
+
+// 3 dB bandwidth of DLPF_CFG 1..6, Hz
+static const uint16_t dlpf_bandwidth[] = { 188, 98, 42, 20, 10, 5 };
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+
+static const char *TAG = "mpu6050";
+
+inline static esp_err_t write_reg(i2c_dev_t *dev, uint8_t reg, uint8_t val)
+{
+    return i2c_dev_write_reg(dev, reg, &val, 1);
+}
+
+inline static esp_err_t read_reg(i2c_dev_t *dev, uint8_t reg, uint8_t *val)
+{
+    return i2c_dev_read_reg(dev, reg, val, 1);
+}
+
+static esp_err_t reset_fifo(i2c_dev_t *dev)
+{
+    CHECK(write_reg(dev, REG_USER_CTRL, USER_CTRL_FIFO_RESET));
+    return write_reg(dev, REG_USER_CTRL, USER_CTRL_FIFO_EN);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Public
+
+esp_err_t mpu6050_init_desc(i2c_dev_t *dev, uint8_t addr, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio)
+{
+    CHECK_ARG(dev);
+
+    if (addr != MPU6050_I2C_ADDR_0 && addr != MPU6050_I2C_ADDR_1)
+    {
+        ESP_LOGE(TAG, "Invalid device address: 0x%02x", addr);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    dev->port = port;
+    dev->addr = addr;
+    dev->cfg.sda_io_num = sda_gpio;
+    dev->cfg.scl_io_num = scl_gpio;
+#if HELPER_TARGET_IS_ESP32
+    dev->cfg.master.clk_speed = I2C_FREQ_HZ;
+#endif
+
+    return i2c_dev_create_mutex(dev);
+}
+
+esp_err_t mpu6050_free_desc(i2c_dev_t *dev)
+{
+    CHECK_ARG(dev);
+
+    return i2c_dev_delete_mutex(dev);
+}
+
+esp_err_t mpu6050_init(i2c_dev_t *dev, mpu6050_gyro_range_t range, uint16_t sample_rate_hz, uint8_t *who_am_i)
+{
+    CHECK_ARG(dev && range <= MPU6050_GYRO_RANGE_2000);
+    CHECK_ARG(sample_rate_hz >= 4 && sample_rate_hz <= GYRO_OUTPUT_RATE_HZ && GYRO_OUTPUT_RATE_HZ % sample_rate_hz == 0);
+
+    // widest filter that still stops at a quarter of the sample rate
+    uint8_t dlpf = 6;
+    for (uint8_t i = 0; i < sizeof(dlpf_bandwidth) / sizeof(dlpf_bandwidth[0]); i++)
+    {
+        if (dlpf_bandwidth[i] * 4 <= sample_rate_hz)
+        {
+            dlpf = i + 1;
+            break;
+        }
+    }
+
+    uint8_t id = 0;
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, read_reg(dev, REG_WHO_AM_I, &id));
+
+    I2C_DEV_CHECK(dev, write_reg(dev, REG_PWR_MGMT_1, PWR_MGMT_1_DEVICE_RESET));
+    vTaskDelay(pdMS_TO_TICKS(RESET_DELAY_MS));
+    // awake, clocked from the gyro PLL
+    I2C_DEV_CHECK(dev, write_reg(dev, REG_PWR_MGMT_1, PWR_MGMT_1_CLK_PLL_X));
+
+    I2C_DEV_CHECK(dev, write_reg(dev, REG_CONFIG, dlpf));
+    I2C_DEV_CHECK(dev, write_reg(dev, REG_SMPLRT_DIV, (uint8_t)(GYRO_OUTPUT_RATE_HZ / sample_rate_hz - 1)));
+    I2C_DEV_CHECK(dev, write_reg(dev, REG_GYRO_CONFIG, (uint8_t)(range << GYRO_CONFIG_FS_SEL_BIT)));
+    // latches the overflow in INT_STATUS, the INT pin may stay unconnected
+    I2C_DEV_CHECK(dev, write_reg(dev, REG_INT_ENABLE, INT_FIFO_OFLOW));
+
+    I2C_DEV_CHECK(dev, reset_fifo(dev));
+    I2C_DEV_CHECK(dev, write_reg(dev, REG_FIFO_EN, FIFO_EN_ZG));
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    ESP_LOGD(TAG, "WHO_AM_I 0x%02x, %u Hz, DLPF_CFG %u", id, sample_rate_hz, dlpf);
+    if (who_am_i)
+        *who_am_i = id;
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_read_gyro_z_fifo(i2c_dev_t *dev, int16_t *samples, size_t max, size_t *count, bool *overflow)
+{
+    CHECK_ARG(dev && samples && max && count);
+
+    *count = 0;
+    if (overflow)
+        *overflow = false;
+
+    uint8_t buf[2];
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, i2c_dev_read_reg(dev, REG_FIFO_COUNTH, buf, 2));
+    size_t level = ((size_t)buf[0] << 8) | buf[1];
+
+    bool lost = level % MPU6050_FIFO_SAMPLE_SIZE != 0;
+    if (!lost && level >= FIFO_CHECK_LEVEL)
+    {
+        uint8_t status;
+        I2C_DEV_CHECK(dev, read_reg(dev, REG_INT_STATUS, &status));
+        lost = status & INT_FIFO_OFLOW;
+    }
+    if (lost)
+    {
+        I2C_DEV_CHECK(dev, reset_fifo(dev));
+        I2C_DEV_GIVE_MUTEX(dev);
+        if (overflow)
+            *overflow = true;
+        return ESP_OK;
+    }
+
+    size_t n = level / MPU6050_FIFO_SAMPLE_SIZE;
+    if (n > max)
+        n = max;
+    if (n)
+    {
+        // the samples are unpacked in place, front to back: sample i never overwrites bytes not yet read
+        uint8_t *raw = (uint8_t *)samples;
+        I2C_DEV_CHECK(dev, i2c_dev_read_reg(dev, REG_FIFO_R_W, raw, n * MPU6050_FIFO_SAMPLE_SIZE));
+        for (size_t i = 0; i < n; i++)
+            samples[i] = (int16_t)(((uint16_t)raw[2 * i] << 8) | raw[2 * i + 1]);
+    }
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    *count = n;
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_reset_fifo(i2c_dev_t *dev)
+{
+    CHECK_ARG(dev);
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, reset_fifo(dev));
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return ESP_OK;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file mpu6050.h
+ * @defgroup mpu6050 mpu6050
+ * @{
+ *
+ * ESP-IDF driver for the gyroscope FIFO of MPU6050 class IMUs
+ * (MPU6050, MPU6500/9250, ICM-20602/20608/20689: same register map for
+ * everything used here)
+ *
+ * Only what the rover needs: the gyro Z axis is sampled into the FIFO at
+ * a fixed rate and read back in bursts, so a reader that comes by once
+ * per control tick gets every sample without timing its reads to the
+ * sensor.
+ */
+#ifndef __MPU6050_H__
+#define __MPU6050_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <i2cdev.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MPU6050_I2C_ADDR_0 0x68 //!< AD0 low
+#define MPU6050_I2C_ADDR_1 0x69 //!< AD0 high
+
+#define MPU6050_FIFO_SAMPLE_SIZE 2 //!< One gyro axis: 16 bit, big endian
+
+/**
+ * Gyroscope full scale
+ */
+typedef enum
+{
+    MPU6050_GYRO_RANGE_250 = 0, //!< +-250 deg/s, 131 LSB per deg/s
+    MPU6050_GYRO_RANGE_500,     //!< +-500 deg/s, 65.5 LSB per deg/s
+    MPU6050_GYRO_RANGE_1000,    //!< +-1000 deg/s, 32.8 LSB per deg/s
+    MPU6050_GYRO_RANGE_2000,    //!< +-2000 deg/s, 16.4 LSB per deg/s
+} mpu6050_gyro_range_t;
+
+/**
+ * @brief Initialize device descriptor
+ *
+ * @param dev Pointer to I2C device descriptor
+ * @param addr Device address, MPU6050_I2C_ADDR_0 or MPU6050_I2C_ADDR_1
+ * @param port I2C port number
+ * @param sda_gpio GPIO pin number for SDA
+ * @param scl_gpio GPIO pin number for SCL
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_init_desc(i2c_dev_t *dev, uint8_t addr, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio);
+
+/**
+ * @brief Free device descriptor
+ *
+ * @param dev Pointer to I2C device descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_free_desc(i2c_dev_t *dev);
+
+/**
+ * @brief Reset the device and start sampling gyro Z into the FIFO
+ *
+ * The device is reset and woken up on the gyro PLL clock, the digital
+ * low pass filter is set to about a quarter of the sample rate and the
+ * FIFO is emptied and enabled for the gyro Z axis only.
+ *
+ * @param dev Device descriptor
+ * @param range Gyro full scale
+ * @param sample_rate_hz Sample rate, 4..1000 Hz, a divisor of 1000
+ * @param[out] who_am_i Contents of WHO_AM_I (identifies the part), may be NULL
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_init(i2c_dev_t *dev, mpu6050_gyro_range_t range, uint16_t sample_rate_hz, uint8_t *who_am_i);
+
+/**
+ * @brief Read the gyro Z samples waiting in the FIFO
+ *
+ * One read of FIFO_COUNT and one burst read of up to `max` samples from
+ * FIFO_R_W, under a single take of the device mutex; samples beyond `max`
+ * stay in the FIFO for the next call. When the FIFO has overflowed, it is
+ * reset instead (its contents are no longer aligned to samples) and
+ * nothing is returned.
+ *
+ * @param dev Device descriptor
+ * @param[out] samples Gyro Z samples, oldest first
+ * @param max Size of samples
+ * @param[out] count Samples read
+ * @param[out] overflow True if the FIFO had overflowed and was reset, may be NULL
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_read_gyro_z_fifo(i2c_dev_t *dev, int16_t *samples, size_t max, size_t *count, bool *overflow);
+
+/**
+ * @brief Empty the FIFO
+ *
+ * @param dev Device descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t mpu6050_reset_fifo(i2c_dev_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MPU6050_H__ */
@@ -80,6 +80,8 @@
 
 #define WAKEUP_DELAY_US 500
 
+#define SPEED_CHECK_ROUNDS 8
+
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 #define CHECK_ARG_LOGE(VAL, msg, ...) do { if (!(VAL)) { ESP_LOGE(TAG, msg, ## __VA_ARGS__); return ESP_ERR_INVALID_ARG; } } while (0)
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
@@ -158,6 +160,54 @@ esp_err_t pca9685_init(i2c_dev_t *dev)
     return ESP_OK;
 }
 
+static esp_err_t check_readback(i2c_dev_t *dev)
+{
+    uint8_t saved, v;
+    CHECK(read_reg(dev, REG_SUBADR1, &saved));
+
+    esp_err_t res = ESP_OK;
+    for (int i = 0; i < SPEED_CHECK_ROUNDS && res == ESP_OK; i++)
+    {
+        // bit 0 of SUBADRx is read-only
+        uint8_t pattern = (uint8_t)((0xa5 ^ (i * 0x3c)) & 0xfe);
+        res = write_reg(dev, REG_SUBADR1, pattern);
+        if (res == ESP_OK)
+            res = read_reg(dev, REG_SUBADR1, &v);
+        if (res == ESP_OK && v != pattern)
+            res = ESP_ERR_INVALID_RESPONSE;
+    }
+
+    esp_err_t restore = write_reg(dev, REG_SUBADR1, saved);
+    return res != ESP_OK ? res : restore;
+}
+
+esp_err_t pca9685_select_bus_speed(i2c_dev_t *dev, const uint32_t *speeds, size_t count, uint32_t *selected)
+{
+    CHECK_ARG(dev && speeds && count);
+
+    esp_err_t res = ESP_ERR_NOT_FOUND;
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    for (size_t i = 0; i < count; i++)
+    {
+        I2C_DEV_CHECK(dev, i2c_dev_set_speed(dev, speeds[i]));
+
+        esp_err_t check = check_readback(dev);
+        if (check == ESP_OK)
+        {
+            res = ESP_OK;
+            break;
+        }
+        ESP_LOGW(TAG, "[0x%02x] Readback failed at %" PRIu32 " Hz: %s", dev->addr, speeds[i], esp_err_to_name(check));
+    }
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    if (selected)
+        *selected = dev->cfg.master.clk_speed;
+
+    return res;
+}
+
 esp_err_t pca9685_set_subaddr(i2c_dev_t *dev, uint8_t num, uint8_t subaddr, bool enable)
 {
     CHECK_ARG(dev);
@@ -348,24 +398,45 @@ esp_err_t pca9685_set_pwm_values(i2c_dev_t *dev, uint8_t first_ch, uint8_t chann
     CHECK_ARG_LOGE(channels > 0 && first_ch + channels - 1 < PCA9685_CHANNEL_ALL,
             "Invalid first_ch or channels: (%d, %d)", first_ch, channels);
 
-
-    size_t size = channels * 4;
+    // Register address goes first, the whole frame is handed to the bus as is
+    size_t size = 1 + channels * 4;
     uint8_t buf[size];
-    for (uint8_t ch = first_ch; ch < first_ch + channels; ch++)
-    {
-        bool full_on = values[ch] >= PCA9685_MAX_PWM_VALUE;
-        bool full_off = values[ch] == 0;
+    buf[0] = REG_LED_N(first_ch);
+    for (uint8_t i = 0; i < channels; i++)
+        pca9685_encode_pwm_value(values[i], buf + 1 + i * PCA9685_LED_REG_SIZE);
 
-        uint16_t val = full_on ? 4095 : values[ch];
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, i2c_dev_write_framed(dev, buf, size));
+    I2C_DEV_GIVE_MUTEX(dev);
 
-        buf[ch * 4] = 0;
-        buf[ch * 4 + 1] = full_on ? LED_FULL_ON_OFF : 0;
-        buf[ch * 4 + 2] = val;
-        buf[ch * 4 + 3] = full_off ? LED_FULL_ON_OFF | (val >> 8) : val >> 8;
-    }
+    return ESP_OK;
+}
+
+void pca9685_encode_pwm_value(uint16_t val, uint8_t *led)
+{
+    bool full_on = val >= PCA9685_MAX_PWM_VALUE;
+    bool full_off = val == 0;
+
+    if (full_on)
+        val = 4095;
+
+    led[0] = 0;
+    led[1] = full_on ? LED_FULL_ON_OFF : 0;
+    led[2] = val;
+    led[3] = full_off ? LED_FULL_ON_OFF | (val >> 8) : val >> 8;
+}
+
+uint8_t pca9685_led_reg(uint8_t channel)
+{
+    return channel >= PCA9685_CHANNEL_ALL ? REG_ALL_LED : REG_LED_N(channel);
+}
+
+esp_err_t pca9685_write_frame_timeout(i2c_dev_t *dev, const uint8_t *frame, size_t size, uint32_t timeout_us)
+{
+    CHECK_ARG(frame && size > 1);
 
     I2C_DEV_TAKE_MUTEX(dev);
-    I2C_DEV_CHECK(dev, i2c_dev_write_reg(dev, REG_LED_N(first_ch), buf, size));
+    I2C_DEV_CHECK(dev, i2c_dev_write_framed_timeout(dev, frame, size, timeout_us));
     I2C_DEV_GIVE_MUTEX(dev);
 
     return ESP_OK;
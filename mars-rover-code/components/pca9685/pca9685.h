@@ -50,9 +50,12 @@ extern "C" {
 #endif
 
 #define PCA9685_ADDR_BASE 0x40 //!< Base I2C device address
+#define PCA9685_ADDR_ALL_CALL 0x70 //!< Power-on ALL_CALL address, every PCA9685 on the bus responds to it
 
 #define PCA9685_MAX_PWM_VALUE 4096
 
+#define PCA9685_LED_REG_SIZE 4 //!< LEDn_ON_L, LEDn_ON_H, LEDn_OFF_L, LEDn_OFF_H
+
 /**
  * PWM channel
  */
@@ -105,6 +108,22 @@ esp_err_t pca9685_free_desc(i2c_dev_t *dev);
  */
 esp_err_t pca9685_init(i2c_dev_t *dev);
 
+/**
+ * @brief Select the fastest working I2C speed
+ *
+ * Tries the speeds in the given order. At each one a test pattern is
+ * written to the SUBADR1 register and read back several times (the
+ * original value is restored). The first speed where every readback
+ * matches is kept; if none works, the last one stays selected.
+ *
+ * @param dev Device descriptor
+ * @param speeds SCL frequencies to try, Hz, fastest first
+ * @param count Number of speeds
+ * @param[out] selected Speed in use afterwards, may be NULL
+ * @return `ESP_OK` if a speed passed, `ESP_ERR_NOT_FOUND` if none did
+ */
+esp_err_t pca9685_select_bus_speed(i2c_dev_t *dev, const uint32_t *speeds, size_t count, uint32_t *selected);
+
 /**
  * @brief Setup device subaddress
  *
@@ -242,6 +261,43 @@ esp_err_t pca9685_set_pwm_value(i2c_dev_t *dev, uint8_t channel, uint16_t val);
 esp_err_t pca9685_set_pwm_values(i2c_dev_t *dev, uint8_t first_ch, uint8_t channels,
         const uint16_t *values);
 
+/**
+ * @brief Encode a PWM value into LEDn registers
+ *
+ * Produces the bytes pca9685_set_pwm_value() would write, full-on and
+ * full-off bits included, so callers can keep a ready register image.
+ *
+ * @param val PWM value, 0..4096
+ * @param[out] led PCA9685_LED_REG_SIZE bytes, LEDn_ON_L first
+ */
+void pca9685_encode_pwm_value(uint16_t val, uint8_t *led);
+
+/**
+ * @brief Address of the first LEDn register of a channel
+ *
+ * @param channel Channel number, 0..15 or >15 for all channels
+ * @return LEDn_ON_L register address, ALL_LED_ON_L for all channels
+ */
+uint8_t pca9685_led_reg(uint8_t channel);
+
+/**
+ * @brief Write a pre-encoded register frame within a time budget
+ *
+ * `frame` is a register address (see pca9685_led_reg()) followed by
+ * encoded LEDn bytes (see pca9685_encode_pwm_value()). It is handed to the
+ * bus as is, without copying. Gives up when the write has not succeeded
+ * within `timeout_us` instead of retrying with backoff, and does not set
+ * the device up again: after an error run i2c_dev_recover(). Waiting for
+ * the device mutex is not part of the budget.
+ *
+ * @param dev Device descriptor
+ * @param frame Register address and LEDn bytes
+ * @param size Size of frame, 1 + 4 bytes per channel
+ * @param timeout_us Time budget, microseconds
+ * @return `ESP_OK` on success
+ */
+esp_err_t pca9685_write_frame_timeout(i2c_dev_t *dev, const uint8_t *frame, size_t size, uint32_t timeout_us);
+
 #ifdef __cplusplus
 }
 #endif
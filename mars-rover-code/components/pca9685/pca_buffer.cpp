@@ -2,29 +2,84 @@
 #include "pca9685.h"
 #include "../motors/motors_cfg.h"  // <-- додано
 #include <esp_log.h>
+#include <algorithm>
 #include <cstring>
 
 PCA9685Buffer::PCA9685Buffer(i2c_dev_t* pca9685):
-    device{pca9685},
-    dirty{false}
+    all_call{new i2c_dev_t{}}
 {
     ESP_ERROR_CHECK(i2cdev_init());
 
-    memset(device, 0, sizeof(i2c_dev_t));
-    ESP_ERROR_CHECK(pca9685_init_desc(device, PCA9685_ADDR, 
-                                    I2C_NUM_0, 
-                                    I2C_MASTER_SDA_IO, 
+    chips[0].device = pca9685;
+    for (uint8_t i = 1; i < DEVICES; i++) chips[i].device = new i2c_dev_t{};
+
+    for (uint8_t i = 0; i < DEVICES; i++) {
+        memset(chips[i].device, 0, sizeof(i2c_dev_t));
+        ESP_ERROR_CHECK(pca9685_init_desc(chips[i].device, PCA9685_ADDR + i,
+                                        I2C_NUM_0, 
+                                        I2C_MASTER_SDA_IO, 
+                                        I2C_MASTER_SCL_IO));
+    }
+    ESP_ERROR_CHECK(pca9685_init_desc(all_call, PCA9685_ADDR_ALL_CALL,
+                                    I2C_NUM_0,
+                                    I2C_MASTER_SDA_IO,
                                     I2C_MASTER_SCL_IO));
 
-    ESP_ERROR_CHECK(pca9685_init(device));
-    ESP_ERROR_CHECK(pca9685_set_pwm_frequency(device, Servo::FREQ));
+    select_bus_speed();
+
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        outputs[i] = {static_cast<uint8_t>(i / 16), static_cast<uint8_t>(i % 16), false, false};
+    }
+
+    for (Chip& chip : chips) {
+        for (uint8_t ch = 0; ch < 16; ch++) pca9685_encode_pwm_value(chip.buffer[ch], led_regs(chip.image, ch));
+    }
+
+    // Channel writes use the framed fast path: add the devices to the bus once, here
+    for (Chip& chip : chips) ESP_ERROR_CHECK(i2c_dev_attach(chip.device));
+    ESP_ERROR_CHECK(i2c_dev_attach(all_call));
+
+    for (Chip& chip : chips) {
+        ESP_ERROR_CHECK(pca9685_init(chip.device));
+        ESP_ERROR_CHECK(pca9685_set_pwm_frequency(chip.device, Servo::FREQ));
+    }
 
     clear();
+    // Device state is unknown after init: send every channel once
+    for (Chip& chip : chips) chip.dirty_mask = 0xffff;
     flush();
 }
 
+void PCA9685Buffer::select_bus_speed() {
+#if CONFIG_PCA9685_BUFFER_PROBE_BUS_SPEED
+    // Fast-mode Plus, Fast-mode, Standard-mode
+    static const uint32_t profiles[] = {1000000, 400000, 100000};
+
+    uint32_t speeds[3];
+    size_t count = 0;
+    for (uint32_t hz : profiles) {
+        if (hz <= I2C_MASTER_FREQ_HZ) speeds[count++] = hz;
+    }
+    if (!count) speeds[count++] = I2C_MASTER_FREQ_HZ;
+
+    // the first chip stands for the bus, the others run at whatever it can do
+    esp_err_t res = pca9685_select_bus_speed(chips[0].device, speeds, count, &bus_speed);
+    if (res != ESP_OK) {
+        ESP_LOGE(TAG, "No stable I2C speed found, staying at %lu Hz", (unsigned long)bus_speed);
+    }
+#else
+    esp_err_t res = ESP_OK;
+    bus_speed = I2C_MASTER_FREQ_HZ;
+    ESP_ERROR_CHECK(i2c_dev_set_speed(chips[0].device, bus_speed));
+#endif
+    for (uint8_t i = 1; i < DEVICES; i++) ESP_ERROR_CHECK(i2c_dev_set_speed(chips[i].device, bus_speed));
+    ESP_ERROR_CHECK(i2c_dev_set_speed(all_call, bus_speed));
+    if (res != ESP_OK) return;
+    ESP_LOGI(TAG, "I2C bus at %lu kHz", (unsigned long)(bus_speed / 1000));
+}
+
 void PCA9685Buffer::set_channel_value(uint8_t channel, uint16_t value) {
-    if (channel >= 16) {
+    if (channel >= CHANNELS) {
         ESP_LOGE(TAG, "Invalid channel %d", channel);
         return;
     }
@@ -32,26 +87,431 @@ void PCA9685Buffer::set_channel_value(uint8_t channel, uint16_t value) {
         ESP_LOGW(TAG, "clamping PWM %u->4095 for channel %u", value, channel);
         value = 4095;
     }
-    buffer[channel] = value;
-    dirty = true;
+    Chip& chip = chips[outputs[channel].chip];
+    uint8_t ch = outputs[channel].channel;
+    if (value != chip.buffer[ch]) {
+        chip.buffer[ch] = value;
+        pca9685_encode_pwm_value(value, led_regs(chip.image, ch));
+    }
+    if (value != chip.shadow[ch]) {
+        chip.dirty_mask |= (1u << ch);
+    } else {
+        chip.dirty_mask &= ~(1u << ch);
+    }
 }
 
 uint16_t PCA9685Buffer::get_channel_value(uint8_t channel) {
-    if (channel >= 16) {
+    if (channel >= CHANNELS) {
         ESP_LOGE(TAG, "Invalid channel %d", channel);
         return 0;
     }
-    return buffer[channel];
+    return chips[outputs[channel].chip].buffer[outputs[channel].channel];
+}
+
+esp_err_t PCA9685Buffer::map_channel(uint8_t logical, uint8_t address, uint8_t channel) {
+    if (logical >= CHANNELS || channel >= 16 ||
+        address < PCA9685_ADDR || address >= PCA9685_ADDR + DEVICES) {
+        ESP_LOGE(TAG, "Invalid mapping %u -> 0x%02x/%u", logical, address, channel);
+        return ESP_ERR_INVALID_ARG;
+    }
+    Output target{static_cast<uint8_t>(address - PCA9685_ADDR), channel, true, outputs[logical].motor};
+
+    // whoever has the default route there takes the place logical leaves
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        if (i == logical || outputs[i].chip != target.chip || outputs[i].channel != target.channel) continue;
+        if (outputs[i].mapped) {
+            ESP_LOGE(TAG, "Logical channels %u and %u both mapped to 0x%02x/%u", i, logical, address, channel);
+            return ESP_ERR_INVALID_STATE;
+        }
+        outputs[i].chip = outputs[logical].chip;
+        outputs[i].channel = outputs[logical].channel;
+    }
+    outputs[logical] = target;
+    update_motor_masks();
+    return ESP_OK;
+}
+
+esp_err_t PCA9685Buffer::set_motor_channel(uint8_t logical) {
+    if (logical >= CHANNELS) {
+        ESP_LOGE(TAG, "Invalid channel %d", logical);
+        return ESP_ERR_INVALID_ARG;
+    }
+    outputs[logical].motor = true;
+    update_motor_masks();
+    return ESP_OK;
+}
+
+void PCA9685Buffer::update_motor_masks() {
+    for (Chip& chip : chips) chip.motor_mask = 0;
+    for (const Output& o : outputs) {
+        if (o.motor) chips[o.chip].motor_mask |= 1u << o.channel;
+    }
+}
+
+esp_err_t PCA9685Buffer::write_burst(i2c_dev_t* device, uint8_t* regs, uint8_t first, uint8_t count) {
+    uint8_t* burst = led_regs(regs, first) - 1;
+    uint8_t saved = *burst;
+    *burst = pca9685_led_reg(first);
+    esp_err_t res = pca9685_write_frame_timeout(device, burst, 1 + count * PCA9685_LED_REG_SIZE,
+                                                CONFIG_PCA9685_BUFFER_WRITE_TIMEOUT_US);
+    *burst = saved;
+
+    taskENTER_CRITICAL(&frame_lock);
+    if (res != ESP_OK) {
+        stats.failures++;
+    } else {
+        stats.bursts++;
+        stats.channels += count;
+        stats.bytes += 2 + count * 4;   // address + register + 4 bytes per channel
+    }
+    taskEXIT_CRITICAL(&frame_lock);
+    return res;
+}
+
+uint16_t PCA9685Buffer::write_frame(i2c_dev_t* device, uint8_t* regs, uint16_t mask) {
+    // Walk the dirty runs; extend the current burst over a gap while
+    // the gap costs no more than opening a new burst.
+    // After a failed burst the bus is not tried again for this frame.
+    int8_t first = -1;
+    uint8_t last = 0;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        if (!(mask & (1u << ch))) continue;
+
+        if (first >= 0 && (ch - last - 1) * 4 > BURST_OVERHEAD_BYTES) {
+            if (write_burst(device, regs, first, last - first + 1) != ESP_OK) {
+                return mask & ~((1u << first) - 1);
+            }
+            first = -1;
+        }
+        if (first < 0) first = ch;
+        last = ch;
+    }
+    if (first >= 0 && write_burst(device, regs, first, last - first + 1) != ESP_OK) {
+        return mask & ~((1u << first) - 1);
+    }
+    return 0;
 }
 
 void PCA9685Buffer::flush() {
-    if (!dirty) return;
-    ESP_ERROR_CHECK(pca9685_set_pwm_values(device, 0, 16, buffer));
-    dirty = false;
+    if (flush_task) {
+        if (!is_dirty()) {
+            count_flush(false);
+            i2c_bus_actuators_done(get_port());
+            return;
+        }
+        count_flush(true);
+        publish();
+    } else {
+        taskENTER_CRITICAL(&frame_lock);
+        bool hold = degraded && recovery_task;
+        if (resync) {
+            for (Chip& chip : chips) chip.retry_mask = 0xffff;
+            resync = false;
+        }
+        taskEXIT_CRITICAL(&frame_lock);
+
+        if (!is_dirty()) {
+            count_flush(false);
+            i2c_bus_actuators_done(get_port());
+            return;
+        }
+        count_flush(true);
+
+        // Chips in bus order; after a failure the rest of the bank waits for the next flush
+        uint16_t failed = 0;
+        const i2c_dev_t* failed_device = nullptr;
+        if (!hold) i2c_bus_claim(get_port());
+        for (Chip& chip : chips) {
+            uint16_t mask = chip.dirty_mask | chip.retry_mask;
+            if (hold || failed) {
+                // the recovery task owns the bus, the frame goes out after it
+                chip.retry_mask = mask;
+                continue;
+            }
+            chip.retry_mask = mask ? write_frame(chip.device, chip.image, mask) : 0;
+            if (chip.retry_mask) {
+                failed = chip.retry_mask;
+                failed_device = chip.device;
+            }
+        }
+        if (!hold) {
+            i2c_bus_release(get_port());
+            frame_done(failed, failed_device);
+        }
+    }
+
+    for (Chip& chip : chips) {
+        memcpy(chip.shadow, chip.buffer, sizeof(chip.shadow));
+        chip.dirty_mask = 0;
+    }
+}
+
+void PCA9685Buffer::count_flush(bool changed) {
+    taskENTER_CRITICAL(&frame_lock);
+    if (changed) {
+        stats.flushes++;
+    } else {
+        stats.clean_flushes++;
+    }
+    taskEXIT_CRITICAL(&frame_lock);
+}
+
+PCA9685Buffer::Stats PCA9685Buffer::get_stats() const {
+    taskENTER_CRITICAL(&frame_lock);
+    Stats result = stats;
+    taskEXIT_CRITICAL(&frame_lock);
+    return result;
+}
+
+void PCA9685Buffer::reset_stats() {
+    taskENTER_CRITICAL(&frame_lock);
+    stats = {};
+    taskEXIT_CRITICAL(&frame_lock);
+}
+
+void PCA9685Buffer::publish() {
+    taskENTER_CRITICAL(&frame_lock);
+    bool pending = false;
+    for (Chip& chip : chips) {
+        pending |= chip.frame_mask != 0;
+        if (!chip.dirty_mask) continue;
+        memcpy(chip.frame, chip.image, sizeof(chip.frame));
+        chip.frame_mask |= chip.dirty_mask;
+    }
+    if (pending && !degraded) stats.overruns++;
+    taskEXIT_CRITICAL(&frame_lock);
+
+    xTaskNotifyGive(flush_task);
+}
+
+uint16_t PCA9685Buffer::write_stop(const i2c_dev_t** failed_device) {
+    uint8_t regs[IMAGE_SIZE];
+    for (uint8_t ch = 0; ch < 16; ch++) pca9685_encode_pwm_value(0, led_regs(regs, ch));
+
+    bool same = true;
+    for (const Chip& chip : chips) same &= chip.motor_mask == chips[0].motor_mask;
+    if (same) {
+        // every chip listens on ALL_CALL: one frame for the bank
+        uint16_t failed = write_frame(all_call, regs, chips[0].motor_mask);
+        if (failed) {
+            *failed_device = all_call;
+            return failed;
+        }
+        taskENTER_CRITICAL(&frame_lock);
+        stats.broadcasts++;
+        taskEXIT_CRITICAL(&frame_lock);
+        return 0;
+    }
+
+    for (Chip& chip : chips) {
+        if (!chip.motor_mask) continue;
+        uint16_t failed = write_frame(chip.device, regs, chip.motor_mask);
+        if (failed) {
+            *failed_device = chip.device;
+            return failed;
+        }
+    }
+    return 0;
+}
+
+void PCA9685Buffer::stop_motors() {
+    bool any = false;
+    for (Chip& chip : chips) {
+        any |= chip.motor_mask != 0;
+        for (uint8_t ch = 0; ch < 16; ch++) {
+            if (!(chip.motor_mask & (1u << ch))) continue;
+            chip.buffer[ch] = 0;
+            chip.shadow[ch] = 0;
+            pca9685_encode_pwm_value(0, led_regs(chip.image, ch));
+        }
+        chip.dirty_mask &= ~chip.motor_mask;
+    }
+    if (!any) return;
+
+    if (flush_task) {
+        // queued motor writes are older than the stop: drop them, the stop goes first
+        taskENTER_CRITICAL(&frame_lock);
+        for (Chip& chip : chips) {
+            for (uint8_t ch = 0; ch < 16; ch++) {
+                if (chip.motor_mask & (1u << ch)) {
+                    memcpy(led_regs(chip.frame, ch), led_regs(chip.image, ch), PCA9685_LED_REG_SIZE);
+                }
+            }
+            chip.frame_mask &= ~chip.motor_mask;
+        }
+        stop_pending = true;
+        taskEXIT_CRITICAL(&frame_lock);
+
+        xTaskNotifyGive(flush_task);
+        return;
+    }
+
+    taskENTER_CRITICAL(&frame_lock);
+    bool hold = degraded && recovery_task;
+    taskEXIT_CRITICAL(&frame_lock);
+
+    uint16_t failed = 0xffff;
+    const i2c_dev_t* failed_device = nullptr;
+    if (!hold) failed = write_stop(&failed_device);
+    if (!failed) {
+        for (Chip& chip : chips) chip.retry_mask &= ~chip.motor_mask;
+        frame_done(0, nullptr);
+        return;
+    }
+    // the chips get their (now zero) motor channels one by one on the next flushes
+    for (Chip& chip : chips) chip.retry_mask |= chip.motor_mask;
+    if (!hold) frame_done(failed, failed_device);
+}
+
+void PCA9685Buffer::frame_done(uint16_t failed, const i2c_dev_t* failed_device) {
+    taskENTER_CRITICAL(&frame_lock);
+    bool entered = failed && !degraded;
+    bool left = !failed && degraded && !recovery_task;
+    if (entered) {
+        degraded = true;
+        stats.degraded++;
+    }
+    if (left) degraded = false;
+    taskEXIT_CRITICAL(&frame_lock);
+
+    if (entered) {
+        ESP_LOGW(TAG, "Write to 0x%02x failed (channels 0x%04x), holding last good frame",
+                 failed_device ? failed_device->addr : 0, failed);
+        if (recovery_task) xTaskNotifyGive(recovery_task);
+    }
+    if (left) ESP_LOGI(TAG, "Writes succeed again");
+}
+
+bool PCA9685Buffer::is_degraded() const {
+    taskENTER_CRITICAL(&frame_lock);
+    bool result = degraded;
+    taskEXIT_CRITICAL(&frame_lock);
+    return result;
+}
+
+esp_err_t PCA9685Buffer::start_async(const char* task_name, UBaseType_t priority, BaseType_t core_id) {
+    if (flush_task) {
+        ESP_LOGW(TAG, "Flush task already running");
+        return ESP_OK;
+    }
+
+    idle_sem = xSemaphoreCreateBinary();
+    if (!idle_sem) {
+        ESP_LOGE(TAG, "Failed to create flush semaphore");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // the flush task resends the whole frame after a recovery, start it from what the devices have
+    for (Chip& chip : chips) memcpy(chip.frame, chip.image, sizeof(chip.frame));
+
+    BaseType_t result;
+    if (core_id == tskNO_AFFINITY) {
+        result = xTaskCreate(flush_task_function, task_name, 4096, this, priority, &flush_task);
+    } else {
+        result = xTaskCreatePinnedToCore(flush_task_function, task_name, 4096, this,
+                                         priority, &flush_task, core_id);
+    }
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create flush task");
+        flush_task = nullptr;
+        vSemaphoreDelete(idle_sem);
+        idle_sem = nullptr;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Async flush started: %s", task_name);
+    return ESP_OK;
+}
+
+void PCA9685Buffer::flush_task_function(void* param) {
+    PCA9685Buffer* pca = static_cast<PCA9685Buffer*>(param);
+    uint8_t regs[DEVICES][IMAGE_SIZE];
+    uint16_t masks[DEVICES];
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        taskENTER_CRITICAL(&pca->frame_lock);
+        if (pca->degraded && pca->recovery_task) {
+            // frame stays queued until the bus is recovered
+            taskEXIT_CRITICAL(&pca->frame_lock);
+            continue;
+        }
+        bool stop = pca->stop_pending;
+        bool pending = stop;
+        for (uint8_t i = 0; i < DEVICES; i++) {
+            Chip& chip = pca->chips[i];
+            masks[i] = chip.frame_mask;
+            if (masks[i]) memcpy(regs[i], chip.frame, IMAGE_SIZE);
+            chip.frame_mask = 0;
+            pending |= masks[i] != 0;
+        }
+        pca->stop_pending = false;
+        pca->transfer_busy = pending;
+        taskEXIT_CRITICAL(&pca->frame_lock);
+
+        if (!pending) continue;
+
+        // The whole bank in one pass; after a failure the rest stays queued
+        uint16_t failed = 0;
+        const i2c_dev_t* failed_device = nullptr;
+        i2c_bus_claim(pca->get_port());
+        if (stop) failed = pca->write_stop(&failed_device);
+        bool stop_failed = failed != 0;
+        for (uint8_t i = 0; i < DEVICES; i++) {
+            if (failed || !masks[i]) continue;
+            masks[i] = pca->write_frame(pca->chips[i].device, regs[i], masks[i]);
+            if (masks[i]) {
+                failed = masks[i];
+                failed_device = pca->chips[i].device;
+            }
+        }
+        i2c_bus_release(pca->get_port());
+
+        taskENTER_CRITICAL(&pca->frame_lock);
+        pca->stats.completions++;
+        pca->transfer_busy = false;
+        // frame[] holds these channels' latest values, whether or not a newer frame came in
+        if (failed) {
+            pca->stop_pending |= stop_failed;
+            for (uint8_t i = 0; i < DEVICES; i++) pca->chips[i].frame_mask |= masks[i];
+        }
+        taskEXIT_CRITICAL(&pca->frame_lock);
+
+        pca->frame_done(failed, failed_device);
+
+        xSemaphoreGive(pca->idle_sem);
+    }
+}
+
+bool PCA9685Buffer::wait_idle(TickType_t timeout) const {
+    if (!flush_task) return true;
+
+    TickType_t start = xTaskGetTickCount();
+    bool woken = false;
+    while (true) {
+        taskENTER_CRITICAL(&frame_lock);
+        bool held = degraded && recovery_task;
+        bool queued = stop_pending;
+        for (const Chip& chip : chips) queued |= chip.frame_mask != 0;
+        bool idle = (!queued || held) && !transfer_busy;
+        taskEXIT_CRITICAL(&frame_lock);
+        if (idle) {
+            // pass the wake-up on to the next task waiting, if any
+            if (woken) xSemaphoreGive(idle_sem);
+            return !held;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (timeout != portMAX_DELAY && elapsed >= timeout) return false;
+
+        woken = xSemaphoreTake(idle_sem, timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed) == pdTRUE;
+    }
 }
 
 void PCA9685Buffer::set_channel_immediate(uint8_t channel, uint16_t value) {
-    if (channel >= 16) {
+    if (channel >= CHANNELS) {
         ESP_LOGE(TAG, "Invalid channel %d", channel);
         return;
     }
@@ -59,15 +519,141 @@ void PCA9685Buffer::set_channel_immediate(uint8_t channel, uint16_t value) {
         ESP_LOGW(TAG, "clamping PWM %u->4095 for channel %u", value, channel);
         value = 4095;
     }
-    ESP_ERROR_CHECK(pca9685_set_pwm_value(device, channel, value));
+    if (flush_task) {
+        // the flush task owns the bus writes, go through it
+        set_channel_value(channel, value);
+        flush();
+        return;
+    }
+    Chip& chip = chips[outputs[channel].chip];
+    uint8_t ch = outputs[channel].channel;
+    uint16_t bit = 1u << ch;
+    uint8_t regs[IMAGE_SIZE];
+    pca9685_encode_pwm_value(value, led_regs(regs, ch));
+    if (is_degraded() && recovery_task) {
+        // the buffer value goes out after the recovery
+        chip.retry_mask |= bit;
+        return;
+    }
+    uint16_t failed = write_frame(chip.device, regs, bit);
+    frame_done(failed, chip.device);
+    if (failed) {
+        chip.retry_mask |= bit;
+        return;
+    }
+
+    chip.shadow[ch] = value;
+    if (chip.buffer[ch] != value) {
+        chip.dirty_mask |= bit;
+    } else {
+        chip.dirty_mask &= ~bit;
+    }
+}
+
+esp_err_t PCA9685Buffer::start_recovery(const char* task_name, UBaseType_t priority, BaseType_t core_id) {
+    if (recovery_task) {
+        ESP_LOGW(TAG, "Recovery task already running");
+        return ESP_OK;
+    }
+
+    BaseType_t result;
+    if (core_id == tskNO_AFFINITY) {
+        result = xTaskCreate(recovery_task_function, task_name, 4096, this, priority, &recovery_task);
+    } else {
+        result = xTaskCreatePinnedToCore(recovery_task_function, task_name, 4096, this,
+                                         priority, &recovery_task, core_id);
+    }
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create recovery task");
+        recovery_task = nullptr;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Bus recovery task started: %s", task_name);
+    return ESP_OK;
+}
+
+esp_err_t PCA9685Buffer::recover() {
+    // one bus reset for the whole bank
+    I2C_DEV_TAKE_MUTEX(all_call);
+    esp_err_t res = i2c_dev_recover(all_call);
+    I2C_DEV_GIVE_MUTEX(all_call);
+    if (res != ESP_OK) return res;
+
+    for (Chip& chip : chips) {
+        // the chips keep their handles across the reset; set up again the ones an error released
+        I2C_DEV_TAKE_MUTEX(chip.device);
+        res = i2c_dev_attach(chip.device);
+        I2C_DEV_GIVE_MUTEX(chip.device);
+        if (res != ESP_OK) return res;
+
+        // A brown-out resets the PCA9685 to sleep mode with the default prescaler
+        bool sleeping = false;
+        res = pca9685_is_sleeping(chip.device, &sleeping);
+        if (res == ESP_OK && sleeping) {
+            ESP_LOGW(TAG, "PCA9685 0x%02x was reset, configuring it again", chip.device->addr);
+            res = pca9685_init(chip.device);
+            if (res == ESP_OK) res = pca9685_set_pwm_frequency(chip.device, Servo::FREQ);
+        }
+        if (res != ESP_OK) return res;
+    }
+    return ESP_OK;
+}
+
+void PCA9685Buffer::recovery_task_function(void* param) {
+    PCA9685Buffer* pca = static_cast<PCA9685Buffer*>(param);
+
+    const TickType_t min_delay = std::max<TickType_t>(pdMS_TO_TICKS(RECOVERY_MIN_DELAY_MS), 1);
+    const TickType_t max_delay = pdMS_TO_TICKS(RECOVERY_MAX_DELAY_MS);
+    TickType_t delay = min_delay;
+    TickType_t last_recovery = 0;
+    bool recovered = false;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Failing again right after a recovery: back off instead of cycling at tick rate
+        if (recovered && xTaskGetTickCount() - last_recovery < max_delay) {
+            if (delay < max_delay) delay *= 2;
+        } else {
+            delay = min_delay;
+        }
+        vTaskDelay(delay);
+
+        esp_err_t res;
+        while ((res = pca->recover()) != ESP_OK) {
+            ESP_LOGW(pca->TAG, "Bus recovery failed: %s", esp_err_to_name(res));
+            vTaskDelay(delay);
+            if (delay < max_delay) delay *= 2;
+        }
+        last_recovery = xTaskGetTickCount();
+        recovered = true;
+
+        // Device state is unknown: everything goes out again
+        taskENTER_CRITICAL(&pca->frame_lock);
+        pca->degraded = false;
+        pca->stats.recoveries++;
+        if (pca->flush_task) {
+            for (Chip& chip : pca->chips) chip.frame_mask = 0xffff;
+        } else {
+            pca->resync = true;
+        }
+        taskEXIT_CRITICAL(&pca->frame_lock);
+
+        if (pca->flush_task) xTaskNotifyGive(pca->flush_task);
+        ESP_LOGI(pca->TAG, "Bus recovered, resending all channels");
+    }
 }
 
 bool PCA9685Buffer::is_dirty() const {
-    return dirty;
+    for (const Chip& chip : chips) {
+        if (chip.dirty_mask | chip.retry_mask) return true;
+    }
+    return false;
 }
 
 void PCA9685Buffer::clear() {
-    for (uint8_t i = 0; i < 4; i++)  buffer[i] = Servo::CENTER_DUTY;
-    for (uint8_t i = 4; i < 16; i++) buffer[i] = 0;
-    dirty = true;
+    for (uint8_t i = 0; i < 4; i++)  set_channel_value(i, Servo::CENTER_DUTY);
+    for (uint8_t i = 4; i < CHANNELS; i++) set_channel_value(i, 0);
 }
@@ -2,37 +2,248 @@
 #define PCA_BUFFER
 
 #include "i2cdev.h"
+#include "pca9685.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
 #include <stdint.h>
 
 // I2C and PCA9685 definitions
 #define I2C_MASTER_SCL_IO    GPIO_NUM_22    // GPIO for SCL
 #define I2C_MASTER_SDA_IO    GPIO_NUM_21    // GPIO for SDA
-#define I2C_MASTER_FREQ_HZ   100000
-#define PCA9685_ADDR         PCA9685_ADDR_BASE  // 0x40
+#define I2C_MASTER_FREQ_HZ   CONFIG_PCA9685_BUFFER_MAX_BUS_SPEED_HZ
+#define PCA9685_ADDR         PCA9685_ADDR_BASE  // 0x40, next chips of the bank follow at 0x41, 0x42...
 
 // Servo constants будуть включені через motors_cfg.h
 // Не дублюємо тут!
 
+/*
+ * Output bank of one or more PCA9685 chips on one I2C bus
+ * (CONFIG_PCA9685_BUFFER_DEVICES, at PCA9685_ADDR, PCA9685_ADDR + 1, ...).
+ *
+ * Callers use logical channels 0..CHANNELS-1. By default logical channel n
+ * is channel n % 16 of chip n / 16; map_channel() moves a logical channel
+ * to any (address, channel) of the bank. Channels marked with
+ * set_motor_channel() are the ones stop_motors() turns off.
+ * flush() is the one commit per tick for the whole bank: only chips with
+ * changed channels are written, all in the same pass (or hand-over to the
+ * flush task). The chips are actuator class devices of the i2cdev bus
+ * scheduler and the pass holds an i2c_bus_claim(), so control and
+ * background devices on the port wait until the whole frame is out; a
+ * flush with nothing to write lets them go at once.
+ */
 class PCA9685Buffer {
+public:
+    /*
+     * Bus traffic produced by flush()
+     * bytes counts everything on the wire: address, register and data bytes.
+     * Counted by the tick and the flush and recovery tasks, under frame_lock;
+     * get_stats() returns a consistent copy from any thread.
+     */
+    struct Stats {
+        uint32_t flushes;       // flush() calls that had something to send
+        uint32_t clean_flushes; // flush() calls with nothing changed
+        uint32_t bursts;        // auto-increment writes issued
+        uint32_t channels;      // channels written (including merged unchanged ones)
+        uint32_t bytes;
+        uint32_t broadcasts;    // motor stops written to ALL_CALL
+
+        // Async mode only
+        uint32_t completions;   // frames written by the flush task
+        uint32_t overruns;      // frames replaced by a newer one before the flush task got to them
+
+        // Bus faults
+        uint32_t failures;      // bursts that failed within the write timeout
+        uint32_t degraded;      // times degraded mode was entered
+        uint32_t recoveries;    // successful bus recoveries
+    };
+
+    static constexpr uint8_t DEVICES = CONFIG_PCA9685_BUFFER_DEVICES;
+    static constexpr uint8_t CHANNELS = DEVICES * 16;
+
+    /*
+     * Every burst costs the address byte, the register byte, START/STOP and
+     * the driver setup of a transaction. Unchanged channels between two
+     * changed ones (4 bytes each) are written along when that is cheaper
+     * than opening another burst.
+     */
+    static constexpr uint8_t BURST_OVERHEAD_BYTES = 8;
+
+    /*
+     * Register image: LEDn registers of all 16 channels, encoded, with one
+     * spare byte in front. A burst is sent straight from the image: the byte
+     * before its first channel (the spare byte or the previous channel's
+     * LEDn_OFF_H) briefly holds the register address during the write.
+     */
+    static constexpr size_t IMAGE_SIZE = 1 + 16 * PCA9685_LED_REG_SIZE;
+
+    // Backoff between failed bus recoveries
+    static constexpr uint32_t RECOVERY_MIN_DELAY_MS = 10;
+    static constexpr uint32_t RECOVERY_MAX_DELAY_MS = 1000;
+
 private:
-    i2c_dev_t* device;
-    uint16_t buffer[16];  // Буфер для 16 каналів (0-4095)
-    bool dirty;           // Чи є незбережені зміни
+    // One PCA9685 of the bank
+    struct Chip {
+        i2c_dev_t* device;
+        uint16_t buffer[16]{};  // Буфер для 16 каналів (0-4095)
+        uint8_t image[IMAGE_SIZE];  // buffer, закодований у регістри LEDn
+        uint16_t shadow[16]{}; // Значення, які вже відправлені в PCA9685 (або в задачу запису)
+        uint16_t dirty_mask{0};  // Канали, де buffer відрізняється від shadow
+        uint16_t retry_mask{0};  // sync mode: channels whose write failed
+        uint16_t motor_mask{0};  // channels of logical outputs marked with set_motor_channel()
+
+        // Async mode: frame handed over to the flush task, guarded by frame_lock
+        uint8_t frame[IMAGE_SIZE]{};
+        uint16_t frame_mask{0};  // changed channels in frame, 0 when the task has taken it
+    };
+
+    // Logical channel -> chip and channel on it
+    struct Output {
+        uint8_t chip;
+        uint8_t channel;
+        bool mapped;        // routed by map_channel(), not the default route
+        bool motor;         // set_motor_channel()
+    };
+
+    Chip chips[DEVICES];
+    Output outputs[CHANNELS];
+    i2c_dev_t* all_call;    // ALL_CALL address, reaches every chip at once
+    uint32_t bus_speed{0};  // SCL frequency in use, Hz
+    Stats stats{};          // guarded by frame_lock
     const char* TAG = "PCA9685Buffer";
+
+    // === ASYNC MODE ===
+    bool stop_pending{false};       // motor stop waiting for the flush task
+    bool transfer_busy{false};      // flush task is writing a frame
+    mutable portMUX_TYPE frame_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    TaskHandle_t flush_task{nullptr};
+    SemaphoreHandle_t idle_sem{nullptr};  // given by the flush task after each frame
+
+    // === DEGRADED MODE ===
+    // After a failed write the outputs keep the last good frame, and (with a
+    // recovery task) no writes are tried until the bus has been recovered.
+    // degraded and resync are guarded by frame_lock.
+    bool degraded{false};
+    bool resync{false};         // sync mode: write every channel on the next flush
+    TaskHandle_t recovery_task{nullptr};
+
+    // Write the channels in mask from a register image, merged into bursts; returns the channels not written
+    uint16_t write_frame(i2c_dev_t* device, uint8_t* regs, uint16_t mask);
+
+    // Write channels [first, first + count) of a register image
+    esp_err_t write_burst(i2c_dev_t* device, uint8_t* regs, uint8_t first, uint8_t count);
+
+    // Motor channels of every chip full off: one ALL_CALL frame when all chips
+    // have the same ones. Returns the channels not written, and their device in failed_device
+    uint16_t write_stop(const i2c_dev_t** failed_device);
+
+    // Chip::motor_mask from the outputs
+    void update_motor_masks();
+
+    static uint8_t* led_regs(uint8_t* regs, uint8_t channel) {
+        return regs + 1 + channel * PCA9685_LED_REG_SIZE;
+    }
+
+    // Enter or leave degraded mode after a frame write; failed_device is for the log
+    void frame_done(uint16_t failed, const i2c_dev_t* failed_device);
+
+    // Reset the bus and bring the chips back if they lost their configuration
+    esp_err_t recover();
+
+    // Hand the changed chips over to the flush task
+    void publish();
+
+    // Count a flush() call, changed - it had something to send
+    void count_flush(bool changed);
+
+    // Pick the fastest bus profile up to I2C_MASTER_FREQ_HZ that reads back correctly
+    void select_bus_speed();
+
+    static void flush_task_function(void* param);
+    static void recovery_task_function(void* param);
     
 public:
+    // pca9685 is the descriptor of the first chip; the others are allocated here
     PCA9685Buffer(i2c_dev_t* pca9685);
     ~PCA9685Buffer() = default;
     
     void set_channel_value(uint8_t channel, uint16_t value);
     uint16_t get_channel_value(uint8_t channel);
+
+    /*
+     * Route logical channel to `channel` (0..15) of the chip at `address`.
+     * Meant for setup, before the channel is driven.
+     * The logical channel that had the default route there moves to the
+     * place `logical` leaves; a place another map_channel() gave out is
+     * refused with ESP_ERR_INVALID_STATE, so no two logical channels share
+     * an output.
+     */
+    esp_err_t map_channel(uint8_t logical, uint8_t address, uint8_t channel);
+
+    // Mark a logical channel as a motor output, turned off by stop_motors(). Setup
+    esp_err_t set_motor_channel(uint8_t logical);
+
+    /*
+     * Write changed channels only, merged into as few bursts as
+     * BURST_OVERHEAD_BYTES makes worthwhile.
+     * In async mode the frame is only handed over to the flush task and
+     * flush() returns without touching the bus.
+     */
     void flush();
+
+    // In async mode this is the same as set_channel_value() + flush()
     void set_channel_immediate(uint8_t channel, uint16_t value);
+
+    /*
+     * Emergency stop: the motor channels (set_motor_channel()) go full off
+     * ahead of any queued frame, with a single ALL_CALL write when every
+     * chip has its motors on the same channels, and the buffer reads 0 on
+     * them. The other outputs (servos) are left as they are.
+     */
+    void stop_motors();
+
+    /*
+     * Start a task that performs the bus writes of flush() (async mode).
+     * If a new frame is flushed while the previous one is still waiting,
+     * the newer one replaces it (counted in Stats::overruns).
+     */
+    esp_err_t start_async(const char* task_name, UBaseType_t priority, BaseType_t core_id = tskNO_AFFINITY);
+    bool is_async() const { return flush_task != nullptr; }
+
+    /*
+     * Start a task that recovers the bus after a failed write.
+     * Until it succeeds flush() leaves the bus alone; afterwards every
+     * channel is written again. Without it, failed channels are retried on
+     * every flush.
+     */
+    esp_err_t start_recovery(const char* task_name, UBaseType_t priority, BaseType_t core_id = tskNO_AFFINITY);
+
+    // Wait until the flush task has written everything flushed so far.
+    // Returns false on timeout and when writes wait for a bus recovery.
+    // Several tasks may wait at once (the tick's owner, the IMU reader).
+    bool wait_idle(TickType_t timeout) const;
+
+    // Writes are failing, outputs hold the last good frame
+    bool is_degraded() const;
     
     /*
      * Чи є незбережені зміни
      */
     bool is_dirty() const;
+
+    // Bitmask of channels of a chip (index in the bank) that differ from the device
+    uint16_t get_dirty_mask(uint8_t chip = 0) const { return chips[chip].dirty_mask; }
+
+    // SCL frequency picked at construction, Hz
+    uint32_t get_bus_speed() const { return bus_speed; }
+
+    // I2C port of the bank, for the bus scheduler (i2c_bus_tick())
+    i2c_port_t get_port() const { return chips[0].device->port; }
+
+    Stats get_stats() const;
+    void reset_stats();
     
     /*
      * Очистити буфер (встановити всі канали в 0)
@@ -40,4 +251,7 @@ public:
     void clear();
 };
 
+static_assert(PCA9685Buffer::DEVICES >= 1 && PCA9685Buffer::DEVICES <= 8,
+              "PCA9685Buffer: 1..8 chips per bank");
+
 #endif
@@ -374,3 +374,13 @@ void StepperMotor::set_servo_angle(float angle)
         xSemaphoreGive(mutex);
     }
 }
+
+float StepperMotor::get_servo_angle() const
+{
+    float angle = 0.0f;
+    if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+        angle = servo_angle;
+        xSemaphoreGive(mutex);
+    }
+    return angle;
+}
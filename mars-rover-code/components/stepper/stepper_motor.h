@@ -131,8 +131,9 @@ public:
     /**
      * @brief Get current servo angle
      * @return Current normalized angle (-1.0 to 1.0)
+     * @note Read under the motor mutex, the servo is moved by the motor task
      */
-    float get_servo_angle() const { return servo_angle; }
+    float get_servo_angle() const;
 
 private:
     // Configuration
@@ -0,0 +1,861 @@
+/*
+ * Host benchmark for DriveSystem::tick()
+ *
+ * Drives a DriveSystem (backed by the recording fake i2c bus) through
+ * scripted set()/set_spin_input() sequences and reports the time spent
+ * per tick together with the PWM frames and bus bytes the tick produced.
+ *
+ * With --trace FILE every tick's decoded PCA9685 outputs are written as CSV,
+ * so two builds can be diffed for behavioural regressions.
+ * --realtime makes every fake bus transfer take its wire time, which shows
+ * whether tick() waits for the bus (synchronous flush) or not (async flush);
+ * combine it with --period US to run the ticks at a fixed rate, as on target.
+ * --max-bus-hz HZ makes the fake bus fail above that clock, to exercise the
+ * bus speed probing of PCA9685Buffer; --faults PERIOD_MS:OUTAGE_MS takes the
+ * bus down periodically, to exercise degraded mode and bus recovery.
+ * --drop N skips every Nth tick; the next one is given the time of both, as on
+ * target when the loop falls behind.
+ * --stats prints DriveSystem's tick phase histograms and the per class bus
+ * scheduler counters (rover_stats on target)
+ * after the first run of every scenario.
+ * --tick-log text|raw turns on the drain of DriveSystem's tick trace ring.
+ * --record FILE drives the rover with a scripted stick session in real time,
+ * through InputSession::record() and the same stick mapping as my_platform,
+ * and saves the session; --replay FILE replays a session (recorded here or
+ * dumped from the rover) and prints the hash of its PWM outputs.
+ * --replay-cut records a session that ends mid-drive, replays it and fails
+ * unless the rover is at rest once the replay runs out or is stopped.
+ * --profile steps the wheel speed S-curve alone to random targets on ticks
+ * up to MAX_TICK_DT_US long and fails unless it reaches every one.
+ * --pose prints the odometry pose and its covariance at the end of every scenario.
+ * --kinematics runs Kinematics::compare() (float vs fixed-point path) instead.
+ *
+ * Built with ROVER_WHEEL_ENCODERS, the fake PCNT counts for a model of the
+ * six wheels, some of them loaded (they turn slower than their PWM asks),
+ * and the trace gets the measured wheel speeds as columns w0..w5.
+ *
+ * Built with ROVER_WHEEL_MCPWM, the wheel motors run on the fake MCPWM and
+ * the trace puts its duties back into the wheels' PCA9685 channel columns,
+ * so the trace diffs against a PCA9685 build.
+ *
+ * Built with ROVER_IMU, a fake MPU6050 on the bus samples the yaw rate of
+ * the rover: the rate its odometry turns at, plus --yaw-drift DEG_S while
+ * it drives that the wheels do not see (a side slope, a dragging wheel), which the
+ * heading hold has to steer out. The trace gets the fused yaw and the
+ * heading hold trim as columns yaw and trim. --heading-hold drives straight
+ * for five fusion time constants against that drift and fails unless the
+ * true heading, which the fused yaw does not show, stays within 2 degrees.
+ *
+ * Scenario lengths are in 100 Hz ticks and scaled to CONFIG_MOTORS_CONTROL_RATE_HZ;
+ * the trace keeps one row per 100 Hz tick, so builds at different control
+ * rates can be diffed too.
+ */
+#include "drive_system.h"
+#include "kinematics.h"
+#include "speed_profile.h"
+#include "fake_i2c_bus.h"
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+#include "fake_pcnt.h"
+#endif
+#if CONFIG_MOTORS_WHEEL_MCPWM
+#include "fake_mcpwm.h"
+#endif
+#if CONFIG_MOTORS_IMU
+#include "fake_mpu6050.h"
+#endif
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Rate of the scenario steps and of the trace rows
+constexpr uint32_t TRACE_RATE_HZ = 100;
+
+struct Step {
+    enum class Kind { SET, SPIN, STOP_SPIN, STOP };
+
+    Kind kind;
+    uint16_t ticks;     // how many 100 Hz ticks to run after applying the command
+    int16_t speed;      // SET: speed, SPIN: throttle
+    float angle;        // SET: angle, SPIN: brake
+};
+
+struct Scenario {
+    const char* name;
+    std::vector<Step> steps;
+};
+
+Step set(uint16_t ticks, int16_t speed, float angle) {
+    return {Step::Kind::SET, ticks, speed, angle};
+}
+
+Step spin(uint16_t ticks, int16_t throttle, int16_t brake) {
+    return {Step::Kind::SPIN, ticks, throttle, static_cast<float>(brake)};
+}
+
+Step stop_spin(uint16_t ticks) {
+    return {Step::Kind::STOP_SPIN, ticks, 0, 0.0f};
+}
+
+Step stop(uint16_t ticks) {
+    return {Step::Kind::STOP, ticks, 0, 0.0f};
+}
+
+const std::vector<Scenario>& scenarios() {
+    static const std::vector<Scenario> all = {
+        {"idle", {
+            set(500, 0, 0.0f),
+        }},
+        {"straight", {
+            set(400, 1500, 0.0f),
+            set(400, 0, 0.0f),
+            set(400, -1200, 0.0f),
+            set(300, 0, 0.0f),
+        }},
+        {"turn", {
+            set(200, 1200, 0.0f),
+            set(300, 1200, 25.0f),
+            set(300, 1200, -25.0f),
+            set(200, 1200, 0.0f),
+            set(300, 0, 0.0f),
+        }},
+        {"spin", {
+            spin(400, 400, 0),
+            spin(200, 0, 300),
+            stop_spin(300),
+        }},
+        {"mixed", {
+            set(150, 800, 5.0f),
+            set(150, 1600, 12.0f),
+            set(100, -400, 0.0f),
+            set(200, 0, -20.0f),
+            spin(250, 500, 0),
+            stop_spin(100),
+            set(200, 2000, 30.0f),
+            set(300, 0, 0.0f),
+        }},
+        {"stop", {
+            set(200, 1500, 10.0f),
+            stop(100),
+        }},
+        // setpoint changes while the S-curve is still ramping: a lower target
+        // mid-acceleration, reversals before the speed settles
+        {"ramp", {
+            set(60, 1800, 0.0f),
+            set(60, 600, 0.0f),
+            set(100, -1500, 0.0f),
+            set(80, 1000, 0.0f),
+            set(300, 0, 0.0f),
+        }},
+    };
+    return all;
+}
+
+struct Result {
+    uint32_t ticks{0};
+    double mean_ns{0};
+    double p99_ns{0};
+    double max_ns{0};
+    uint32_t overruns{0};
+    uint32_t degraded{0};
+    fake_i2c_stats_t bus{};
+};
+
+void trace_header(FILE* trace) {
+    fprintf(trace, "scenario,tick,state");
+    for (int ch = 0; ch < 16; ch++) fprintf(trace, ",ch%d", ch);
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    for (int i = 0; i < 6; i++) fprintf(trace, ",w%d", i);
+#endif
+#if CONFIG_MOTORS_IMU
+    fprintf(trace, ",yaw,trim");
+#endif
+    fputc('\n', trace);
+}
+
+void trace_tick(FILE* trace, const char* scenario, uint32_t tick, const DriveSystem& rover) {
+    RoverStateSnapshot s = rover.get_snapshot();
+    fprintf(trace, "%s,%u,%s", scenario, tick, drive_state_name(s.state));
+    unsigned channels[16];
+    for (uint8_t ch = 0; ch < 16; ch++) channels[ch] = fake_pca9685_channel(PCA9685_ADDR, ch);
+#if CONFIG_MOTORS_WHEEL_MCPWM
+    // into the forward and reverse channel the wheel has on the PCA9685
+    for (int i = 0; i < 6; i++) {
+        int duty = fake_mcpwm_bridge_duty(i);
+        channels[Board::WHEELS[i].pca_fwd] = duty > 0 ? duty : 0;
+        channels[Board::WHEELS[i].pca_rev] = duty < 0 ? -duty : 0;
+    }
+#endif
+    for (uint8_t ch = 0; ch < 16; ch++) fprintf(trace, ",%u", channels[ch]);
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    for (uint8_t i = 0; i < 6; i++) fprintf(trace, ",%d", s.wheel_speed[i]);
+#endif
+#if CONFIG_MOTORS_IMU
+    fprintf(trace, ",%.2f,%.2f", s.imu_yaw_deg, s.heading_trim);
+#endif
+    fputc('\n', trace);
+}
+
+// The wheels behind the fake encoders: each one settles, with a first order
+// lag, at the speed its PWM asks for times its load (terrain, a tired motor)
+class WheelModel {
+public:
+    // Time the rover keeps its last outputs
+    void advance(const DriveSystem& rover, uint32_t dt_us) {
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+        RoverStateSnapshot s = rover.get_snapshot();
+        float dt = dt_us / 1000000.0f;
+        for (uint8_t i = 0; i < 6; i++) {
+            float target = s.wheel_pwm[i] / Cfg::MOTOR_SCALE * LOAD[i];
+            speed[i] += (target - speed[i]) * std::min(1.0f, dt / LAG_S);
+
+            counts[i] += speed[i] * CONFIG_MOTORS_ENCODER_COUNTS_PER_S_FULL / Cfg::MOTOR_INTERNAL_MAX * dt;
+            int32_t whole = static_cast<int32_t>(counts[i]);
+            counts[i] -= whole;
+            fake_pcnt_add(i, whole);
+        }
+#else
+        (void)rover;
+        (void)dt_us;
+#endif
+    }
+
+private:
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    // Board::WHEELS order: right front, middle, back, left front, middle, back
+    static constexpr float LOAD[6] = {1.0f, 0.75f, 0.95f, 0.9f, 1.0f, 0.8f};
+    static constexpr float LAG_S = 0.05f;
+
+    float speed[6]{};
+    float counts[6]{};      // not yet fed to the counter
+#endif
+};
+
+// Yaw rate that the odometry does not see, degrees per second (--yaw-drift)
+float yaw_drift = 0.0f;
+
+// The gyro behind the fake MPU6050: the rover turns as its odometry says plus
+// yaw_drift, and the gyro has a small bias of its own
+class YawModel {
+public:
+    // Time the rover keeps its last outputs
+    void advance(const DriveSystem& rover, uint32_t dt_us) {
+#if CONFIG_MOTORS_IMU
+        RoverStateSnapshot s = rover.get_snapshot();
+        float heading = s.pose.heading_deg;
+        float turned = heading - last_heading;
+        if (turned > 180.0f) turned -= 360.0f;
+        if (turned < -180.0f) turned += 360.0f;
+        last_heading = heading;
+
+        float dt = dt_us / 1000000.0f;
+        float rate = turned / dt + (s.mem_speed ? yaw_drift : 0.0f);
+        true_heading += rate * dt;
+        due += dt * CONFIG_MOTORS_IMU_SAMPLE_RATE_HZ;
+        for (; due >= 1.0f; due -= 1.0f) {
+            fake_mpu6050_push(static_cast<int16_t>(lroundf(rate * LSB_PER_DEG_S + BIAS_LSB)));
+        }
+#else
+        (void)rover;
+        (void)dt_us;
+#endif
+    }
+
+#if CONFIG_MOTORS_IMU
+    // Where the rover really points, degrees counter-clockwise from the start, not wrapped
+    float get_true_heading() const { return true_heading; }
+#endif
+
+private:
+#if CONFIG_MOTORS_IMU
+    static constexpr float LSB_PER_DEG_S = 65.5f;
+    static constexpr float BIAS_LSB = 12.0f;
+
+    float last_heading{0.0f};
+    float due{0.0f};            // samples not yet taken
+    float true_heading{0.0f};
+#endif
+};
+
+void reset_fakes() {
+    fake_i2c_reset();
+#if CONFIG_MOTORS_WHEEL_ENCODERS
+    fake_pcnt_reset();
+#endif
+#if CONFIG_MOTORS_WHEEL_MCPWM
+    fake_mcpwm_reset();
+#endif
+#if CONFIG_MOTORS_IMU
+    fake_mpu6050_attach(CONFIG_MOTORS_IMU_I2C_ADDR);
+#endif
+}
+
+// Bus scheduler counters of the PCA9685 port, since start
+void print_bus_classes(const DriveSystem& rover) {
+    static const char* const names[I2C_DEV_CLASS_MAX] = {"actuator", "control", "background"};
+    for (int c = 0; c < I2C_DEV_CLASS_MAX; c++) {
+        i2c_bus_class_stats_t b;
+        if (i2c_bus_get_stats(rover.get_pca_buffer()->get_port(), static_cast<i2c_dev_class_t>(c), &b) != ESP_OK ||
+            !b.transfers)
+            continue;
+        printf("i2c %-10s %7lu xfers %6lu deferred %4lu timeouts %4lu late  wait max %5lu us  latency max %5lu us\n",
+               names[c], (unsigned long)b.transfers, (unsigned long)b.deferred, (unsigned long)b.timeouts,
+               (unsigned long)b.late, (unsigned long)b.wait_max_us, (unsigned long)b.latency_max_us);
+    }
+}
+
+void print_pose(const char* name, const RoverStateSnapshot& s) {
+    const OdometryPose& p = s.pose;
+    printf("%-10s x %6ld mm  y %6ld mm  heading %7.2f deg  sd x %.1f y %.1f mm heading %.2f deg\n",
+           name, static_cast<long>(p.x_mm), static_cast<long>(p.y_mm), p.heading_deg,
+           sqrtf(p.cov[0]), sqrtf(p.cov[3]), sqrtf(p.cov[5]) * 180.0f / PI);
+#if CONFIG_MOTORS_IMU
+    printf("%-10s imu yaw %7.2f deg  heading hold trim %5.2f deg\n", "", s.imu_yaw_deg, s.heading_trim);
+#endif
+}
+
+Result run(const Scenario& scenario, FILE* trace, uint32_t period_us, uint32_t drop,
+           TraceRing::DrainMode tick_log, bool stats, bool pose) {
+    reset_fakes();
+
+    auto pca9685 = std::make_unique<i2c_dev_t>();
+    auto rover = std::make_unique<DriveSystem>(pca9685.get());
+    rover->get_trace()->set_drain_mode(tick_log);
+
+    // construction traffic (mode setup, prescaler, first clear) is not part of the loop
+    fake_i2c_clear_stats();
+
+    std::vector<double> samples;
+    uint32_t tick = 0;
+    uint32_t dt_us = 0;     // time since the last tick that ran
+    WheelModel wheels;
+    YawModel yaw;
+    auto next_tick = std::chrono::steady_clock::now();
+
+    for (const Step& step : scenario.steps) {
+        // the bench has no radio: the report "arrives" when it is posted
+        int64_t now_us = esp_timer_get_time();
+        InputTiming timing{now_us, now_us, now_us};
+
+        switch (step.kind) {
+            // controller input goes through the command mailbox, as from the Bluetooth thread
+            case Step::Kind::SET:
+                rover->post({step.speed, step.angle, false, 0, 0, timing});
+                break;
+            case Step::Kind::SPIN:
+                rover->post({0, 0.0f, true, step.speed, static_cast<int16_t>(step.angle), timing});
+                break;
+            case Step::Kind::STOP_SPIN:
+                rover->stop_spinning();
+                break;
+            case Step::Kind::STOP:
+                rover->emergency_stop();
+                break;
+        }
+
+        uint32_t step_ticks = static_cast<uint32_t>(step.ticks) * Cfg::CONTROL_RATE_HZ / TRACE_RATE_HZ;
+        for (uint32_t i = 0; i < step_ticks; i++, tick++) {
+            if (period_us) {
+                next_tick += std::chrono::microseconds(period_us);
+                std::this_thread::sleep_until(next_tick);
+                // as the control timer wake-up on target
+                auto late = std::chrono::steady_clock::now() - next_tick;
+                rover->get_tick_stats().wake_us.record(static_cast<uint32_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(late).count()));
+            }
+
+            wheels.advance(*rover, Cfg::TICK_PERIOD_US);
+            yaw.advance(*rover, Cfg::TICK_PERIOD_US);
+            dt_us += Cfg::TICK_PERIOD_US;
+            if (!drop || tick % drop != drop - 1) {
+                auto start = std::chrono::steady_clock::now();
+                rover->tick(dt_us);
+                auto end = std::chrono::steady_clock::now();
+                samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+                dt_us = 0;
+
+                // with async flush the frame may still be on its way; on target
+                // the flush task has the rest of the period to finish it
+                if (!period_us) rover->get_pca_buffer()->wait_idle(portMAX_DELAY);
+            }
+
+            // one row for every 100 Hz tick that ends here
+            uint32_t trace_ticks = (tick + 1) * TRACE_RATE_HZ / Cfg::CONTROL_RATE_HZ;
+            if (trace && trace_ticks > tick * TRACE_RATE_HZ / Cfg::CONTROL_RATE_HZ) {
+                rover->get_pca_buffer()->wait_idle(portMAX_DELAY);
+                trace_tick(trace, scenario.name, trace_ticks - 1, *rover);
+            }
+        }
+    }
+
+    rover->get_pca_buffer()->wait_idle(portMAX_DELAY);
+
+    if (stats) {
+        printf("--- %s\n", scenario.name);
+        rover->get_tick_stats().print(false);
+        print_bus_classes(*rover);
+    }
+    if (pose) print_pose(scenario.name, rover->get_snapshot());
+
+    Result result;
+    result.ticks = tick;
+    result.overruns = rover->get_pca_buffer()->get_stats().overruns;
+    result.degraded = rover->get_pca_buffer()->get_stats().degraded;
+    result.bus = *fake_i2c_stats();
+    if (!samples.empty()) {
+        double sum = 0;
+        for (double s : samples) sum += s;
+        result.mean_ns = sum / samples.size();
+
+        std::sort(samples.begin(), samples.end());
+        result.p99_ns = samples[(samples.size() - 1) * 99 / 100];
+        result.max_ns = samples.back();
+    }
+    return result;
+}
+
+// Controller reports for --record, each held for ticks (100 Hz)
+struct StickStep {
+    uint16_t ticks;
+    int16_t axis_y;         // forward is negative, as on the gamepad
+    int16_t axis_rx;
+    int16_t throttle;
+    int16_t brake;
+    bool disconnect;
+};
+
+const std::vector<StickStep>& stick_script() {
+    static const std::vector<StickStep> all = {
+        {50, 0, 0, 0, 0, false},
+        {30, -200, 0, 0, 0, false},
+        {150, -450, 0, 0, 0, false},
+        {100, -450, 300, 0, 0, false},
+        {100, -300, -400, 0, 0, false},
+        {80, 0, 0, 0, 0, false},
+        {60, 350, 0, 0, 0, false},
+        {120, 0, 0, 0, 0, false},
+        {200, 0, 0, 600, 0, false},
+        {100, 0, 0, 0, 400, false},
+        {80, 0, 0, 0, 0, false},
+        {100, -500, 100, 0, 0, false},
+        {50, 0, 0, 0, 0, true},
+    };
+    return all;
+}
+
+// Drives the rover through steps of the stick script in real time and records them
+void record_steps(DriveSystem& rover, const StickStep* begin, const StickStep* end) {
+    InputSession& session = rover.get_input_session();
+
+    session.start_recording();
+    WheelModel wheels;
+    YawModel yaw;
+    auto next_tick = std::chrono::steady_clock::now();
+    for (const StickStep* step = begin; step != end; step++) {
+        // as my_platform_on_controller_data() and my_platform_on_device_disconnected()
+        GamepadSample sample{};
+        sample.axis_y = step->axis_y;
+        sample.axis_rx = step->axis_rx;
+        sample.throttle = step->throttle;
+        sample.brake = step->brake;
+        if (step->disconnect) sample.flags = GAMEPAD_SAMPLE_DISCONNECT;
+        session.record(sample);
+        if (step->disconnect) {
+            rover.emergency_stop();
+        } else {
+            rover.post(gamepad_drive_command(sample));
+        }
+
+        uint32_t step_ticks = static_cast<uint32_t>(step->ticks) * Cfg::CONTROL_RATE_HZ / TRACE_RATE_HZ;
+        for (uint32_t i = 0; i < step_ticks; i++) {
+            next_tick += std::chrono::microseconds(Cfg::TICK_PERIOD_US);
+            std::this_thread::sleep_until(next_tick);
+            wheels.advance(rover, Cfg::TICK_PERIOD_US);
+            yaw.advance(rover, Cfg::TICK_PERIOD_US);
+            rover.tick();
+        }
+    }
+    session.stop_recording();
+}
+
+int record_session(const char* path) {
+    reset_fakes();
+    auto pca9685 = std::make_unique<i2c_dev_t>();
+    auto rover = std::make_unique<DriveSystem>(pca9685.get());
+    InputSession& session = rover->get_input_session();
+
+    const std::vector<StickStep>& script = stick_script();
+    record_steps(*rover, script.data(), script.data() + script.size());
+
+    std::vector<uint8_t> blob(session.blob_size());
+    session.serialize(blob.data(), blob.size());
+    FILE* out = fopen(path, "wb");
+    if (!out || fwrite(blob.data(), 1, blob.size(), out) != blob.size()) {
+        perror(path);
+        if (out) fclose(out);
+        return 1;
+    }
+    fclose(out);
+    printf("recorded %u samples, %zu bytes to %s\n", session.get_count(), blob.size(), path);
+    return 0;
+}
+
+int replay_session(const char* path, FILE* trace) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+    std::vector<uint8_t> blob;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) blob.insert(blob.end(), chunk, chunk + n);
+    fclose(in);
+
+    reset_fakes();
+    auto pca9685 = std::make_unique<i2c_dev_t>();
+    auto rover = std::make_unique<DriveSystem>(pca9685.get());
+    InputSession& session = rover->get_input_session();
+    if (session.load(blob.data(), blob.size()) != ESP_OK || session.start_replay() != ESP_OK) {
+        fprintf(stderr, "%s: not a replayable session\n", path);
+        return 1;
+    }
+
+    uint32_t tick = 0;
+    WheelModel wheels;
+    YawModel yaw;
+    while (session.get_mode() == InputSession::Mode::REPLAYING) {
+        // the replay runs on nominal tick time, so do the wheels
+        wheels.advance(*rover, Cfg::TICK_PERIOD_US);
+        yaw.advance(*rover, Cfg::TICK_PERIOD_US);
+        rover->tick();
+        rover->get_pca_buffer()->wait_idle(portMAX_DELAY);
+
+        uint32_t trace_ticks = (tick + 1) * TRACE_RATE_HZ / Cfg::CONTROL_RATE_HZ;
+        if (trace && trace_ticks > tick * TRACE_RATE_HZ / Cfg::CONTROL_RATE_HZ) {
+            trace_tick(trace, "replay", trace_ticks - 1, *rover);
+        }
+        tick++;
+    }
+
+    printf("replay: %u samples, %u ticks, outputs %08x\n",
+           session.get_count(), session.get_replayed_ticks(), session.get_output_hash());
+    return 0;
+}
+
+// Replays until the session is over, or until the replay is stopped after stop_after ticks;
+// false unless the rover is at rest, idle and stays so once the replay is over
+bool replay_comes_to_rest(DriveSystem& rover, const char* name, uint32_t stop_after) {
+    InputSession& session = rover.get_input_session();
+    if (session.start_replay() != ESP_OK) {
+        fprintf(stderr, "%s: not a replayable session\n", name);
+        return false;
+    }
+
+    WheelModel wheels;
+    YawModel yaw;
+    uint32_t tick = 0;
+    int16_t last_speed = 0;
+    while (session.get_mode() == InputSession::Mode::REPLAYING) {
+        if (tick++ == stop_after) session.stop_replay();    // as rover_record stop
+        last_speed = rover.get_snapshot().mem_speed;
+        wheels.advance(rover, Cfg::TICK_PERIOD_US);
+        yaw.advance(rover, Cfg::TICK_PERIOD_US);
+        rover.tick();
+    }
+    if (last_speed == 0) {
+        fprintf(stderr, "%s: the rover was not driving when the replay ended\n", name);
+        return false;
+    }
+
+    // no live input follows: whatever the session left in force must not drive on
+    for (uint32_t i = 0; i < Cfg::CONTROL_RATE_HZ; i++) {
+        wheels.advance(rover, Cfg::TICK_PERIOD_US);
+        yaw.advance(rover, Cfg::TICK_PERIOD_US);
+        rover.tick();
+    }
+    rover.get_pca_buffer()->wait_idle(portMAX_DELAY);
+
+    RoverStateSnapshot s = rover.get_snapshot();
+    bool at_rest = s.state == DriveState::IDLE && s.mem_speed == 0 && !s.spinning &&
+        std::all_of(s.wheel_pwm, s.wheel_pwm + 6, [](int16_t pwm) { return pwm == 0; });
+    printf("%s: %u replayed ticks, ends %s, speed %d -> %s\n", name, session.get_replayed_ticks(),
+           drive_state_name(s.state), last_speed, at_rest ? "at rest" : "STILL DRIVING");
+    return at_rest;
+}
+
+// Records the stick script up to the middle of its first drive, as a session
+// cut short by a full buffer, and checks that the rover comes to rest when the
+// replay of it runs out and when the replay is stopped while driving
+int replay_cut_session() {
+    reset_fakes();
+    auto pca9685 = std::make_unique<i2c_dev_t>();
+    auto rover = std::make_unique<DriveSystem>(pca9685.get());
+
+    // idle, slow, then full forward: the recording ends on a stick pushed forward
+    const std::vector<StickStep>& script = stick_script();
+    record_steps(*rover, script.data(), script.data() + 3);
+
+    uint32_t mid_drive = 150 * Cfg::CONTROL_RATE_HZ / TRACE_RATE_HZ;
+    bool ok = replay_comes_to_rest(*rover, "replay-cut", UINT32_MAX);
+    ok = replay_comes_to_rest(*rover, "replay-stop", mid_drive) && ok;
+    return ok ? 0 : 1;
+}
+
+// Drives SpeedProfile::step() alone from random speeds to random targets at tick lengths
+// up to MAX_TICK_DT_US, with the configured limits and the steepest jerk Kconfig allows;
+// false unless every target is reached
+bool profile_reaches_targets() {
+    struct Limits {
+        uint32_t accel;
+        uint32_t jerk;
+    };
+    static const Limits limits[] = {{Cfg::DC_ACCEL, Cfg::DC_JERK}, {300, 65535}, {500, 65535}, {1000, 65535}};
+    static const uint32_t dts_us[] = {Cfg::TICK_PERIOD_US, 20000, 40000, 50000, Cfg::MAX_TICK_DT_US};
+    constexpr int CASES = 20000;
+    constexpr int MAX_STEPS = 5000;
+
+    bool ok = true;
+    printf("%7s %7s %8s %9s %10s %9s\n", "accel", "jerk", "dt us", "stuck", "max short", "max steps");
+    for (const Limits& l : limits) {
+        for (uint32_t dt_us : dts_us) {
+            std::mt19937 rng(1);
+            std::uniform_int_distribution<int> speed(-Cfg::MOTOR_INTERNAL_MAX, Cfg::MOTOR_INTERNAL_MAX);
+            int stuck = 0, max_short = 0, max_steps = 0;
+            for (int c = 0; c < CASES; c++) {
+                SpeedProfile profile;
+                int16_t current = static_cast<int16_t>(speed(rng));
+                profile.reset(current);
+                // start some of them mid-ramp, toward a target that then changes
+                int16_t first = static_cast<int16_t>(speed(rng));
+                for (int i = 0; i < c % 7; i++) current = profile.step(current, first, l.accel, 2 * l.accel, l.jerk, dt_us);
+
+                int16_t target = static_cast<int16_t>(speed(rng));
+                int steps = 0;
+                for (; steps < MAX_STEPS && current != target; steps++) {
+                    current = profile.step(current, target, l.accel, 2 * l.accel, l.jerk, dt_us);
+                }
+                if (current != target) {
+                    stuck++;
+                    max_short = std::max(max_short, std::abs(target - current));
+                }
+                max_steps = std::max(max_steps, steps);
+            }
+            printf("%7u %7u %8u %4d/%-4d %10d %9d\n", l.accel, l.jerk, dt_us, stuck, CASES, max_short, max_steps);
+            ok = ok && stuck == 0;
+        }
+    }
+    return ok;
+}
+
+// Drives straight on for five fusion time constants while the rover yaws by
+// yaw_drift (3 deg/s unless --yaw-drift) that the wheels do not see; false
+// unless the heading hold keeps the true heading, not only the fused yaw
+bool heading_hold_keeps_heading() {
+#if CONFIG_MOTORS_IMU
+    constexpr float MAX_ERROR_DEG = 2.0f;
+    constexpr uint32_t REPORT_S = 5;
+    uint32_t tau_s = std::max<uint32_t>(CONFIG_MOTORS_IMU_FUSION_TAU_MS / 1000, 10);
+    uint32_t seconds = 5 * tau_s;
+    if (yaw_drift == 0.0f) yaw_drift = 3.0f;
+
+    reset_fakes();
+    auto pca9685 = std::make_unique<i2c_dev_t>();
+    auto rover = std::make_unique<DriveSystem>(pca9685.get());
+    WheelModel wheels;
+    YawModel yaw;
+
+    // faster than real time: every tick waits for the IMU task to empty the FIFO, as it
+    // does on target within the tick, so no samples are lost to an overflow
+    auto tick = [&] {
+        wheels.advance(*rover, Cfg::TICK_PERIOD_US);
+        yaw.advance(*rover, Cfg::TICK_PERIOD_US);
+        rover->tick();
+        rover->get_pca_buffer()->wait_idle(portMAX_DELAY);
+        auto give_up = std::chrono::steady_clock::now() + std::chrono::microseconds(Cfg::TICK_PERIOD_US);
+        while (fake_mpu6050_fifo_level() && std::chrono::steady_clock::now() < give_up) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    };
+
+    // the gyro learns its bias standing first (1/BIAS_DIV of the way per tick)
+    for (uint32_t i = 0; i < tau_s * Cfg::CONTROL_RATE_HZ; i++) tick();
+
+    rover->post({1500, 0.0f, false, 0, 0, {}});
+    float worst = 0.0f;
+    printf("%6s %12s %12s %8s\n", "time s", "true deg", "imu yaw deg", "trim");
+    for (uint32_t i = 1; i <= seconds * Cfg::CONTROL_RATE_HZ; i++) {
+        tick();
+
+        // the first second goes to speeding up and turning in
+        if (i > Cfg::CONTROL_RATE_HZ) worst = std::max(worst, std::fabs(yaw.get_true_heading()));
+        if (i % (REPORT_S * Cfg::CONTROL_RATE_HZ) == 0) {
+            RoverStateSnapshot s = rover->get_snapshot();
+            printf("%6u %12.2f %12.2f %8.2f\n", i / Cfg::CONTROL_RATE_HZ, yaw.get_true_heading(),
+                   s.imu_yaw_deg, s.heading_trim);
+        }
+    }
+
+    bool kept = worst <= MAX_ERROR_DEG;
+    printf("heading hold: %.1f deg/s drift over %u s, true heading off by %.2f deg at most -> %s\n",
+           yaw_drift, seconds, worst, kept ? "held" : "LOST");
+    return kept;
+#else
+    printf("heading hold needs an IMU build (ROVER_IMU)\n");
+    return false;
+#endif
+}
+
+void usage(const char* argv0) {
+    printf("Usage: %s [--scenario NAME] [--repeat N] [--trace FILE] [--realtime] [--period US] [--max-bus-hz HZ] [--faults PERIOD_MS:OUTAGE_MS] [--drop N] [--stats] [--tick-log text|raw] [--record FILE] [--replay FILE] [--replay-cut] [--profile] [--heading-hold] [--pose] [--yaw-drift DEG_S] [--verbose] [--kinematics]\n", argv0);
+    printf("Scenarios:");
+    for (const Scenario& s : scenarios()) printf(" %s", s.name);
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* only = nullptr;
+    const char* trace_path = nullptr;
+    int repeat = 5;
+    uint32_t period_us = 0;
+    uint32_t drop = 0;
+    TraceRing::DrainMode tick_log = TraceRing::DrainMode::OFF;
+    bool stats = false;
+    bool pose = false;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    bool replay_cut = false;
+    bool profile = false;
+    bool heading_hold = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--scenario") && i + 1 < argc) {
+            only = argv[++i];
+        } else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (!strcmp(argv[i], "--period") && i + 1 < argc) {
+            period_us = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--max-bus-hz") && i + 1 < argc) {
+            fake_i2c_set_max_speed(static_cast<uint32_t>(atoi(argv[++i])));
+        } else if (!strcmp(argv[i], "--faults") && i + 1 < argc) {
+            unsigned period_ms = 0, outage_ms = 0;
+            if (sscanf(argv[++i], "%u:%u", &period_ms, &outage_ms) != 2 || outage_ms > period_ms) {
+                usage(argv[0]);
+                return 1;
+            }
+            fake_i2c_set_faults(period_ms, outage_ms);
+        } else if (!strcmp(argv[i], "--drop") && i + 1 < argc) {
+            drop = static_cast<uint32_t>(std::max(2, atoi(argv[++i])));
+        } else if (!strcmp(argv[i], "--tick-log") && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (!strcmp(mode, "text")) {
+                // the drain logs at INFO
+                esp_log_level_set("*", ESP_LOG_INFO);
+                tick_log = TraceRing::DrainMode::TEXT;
+            } else if (!strcmp(mode, "raw")) {
+                tick_log = TraceRing::DrainMode::RAW;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (!strcmp(argv[i], "--replay-cut")) {
+            replay_cut = true;
+        } else if (!strcmp(argv[i], "--profile")) {
+            profile = true;
+        } else if (!strcmp(argv[i], "--heading-hold")) {
+            heading_hold = true;
+        } else if (!strcmp(argv[i], "--stats")) {
+            stats = true;
+        } else if (!strcmp(argv[i], "--pose")) {
+            pose = true;
+        } else if (!strcmp(argv[i], "--yaw-drift") && i + 1 < argc) {
+            yaw_drift = static_cast<float>(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--realtime")) {
+            fake_i2c_set_realtime(true);
+        } else if (!strcmp(argv[i], "--verbose")) {
+            esp_log_level_set("*", ESP_LOG_INFO);
+        } else if (!strcmp(argv[i], "--kinematics")) {
+            esp_log_level_set("*", ESP_LOG_INFO);
+            Kinematics::compare();
+            return 0;
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") ? 1 : 0;
+        }
+    }
+
+    FILE* trace = nullptr;
+    if (trace_path) {
+        trace = fopen(trace_path, "w");
+        if (!trace) {
+            perror(trace_path);
+            return 1;
+        }
+        trace_header(trace);
+    }
+
+    if (record_path) return record_session(record_path);
+    if (replay_cut) return replay_cut_session();
+    if (profile) return profile_reaches_targets() ? 0 : 1;
+    if (heading_hold) return heading_hold_keeps_heading() ? 0 : 1;
+    if (replay_path) {
+        int res = replay_session(replay_path, trace);
+        if (trace) fclose(trace);
+        return res;
+    }
+
+    printf("%-10s %7s %10s %10s %10s %8s %10s %10s %12s %9s %9s\n",
+           "scenario", "ticks", "ns/tick", "p99 ns", "max ns",
+           "frames", "bus bytes", "bytes/tick", "bus us/tick", "overruns", "degraded");
+
+    bool matched = false;
+    for (const Scenario& scenario : scenarios()) {
+        if (only && strcmp(only, scenario.name)) continue;
+        matched = true;
+
+        // Keep the fastest run: the others only add scheduler noise
+        Result best;
+        for (int r = 0; r < repeat; r++) {
+            Result result = run(scenario, r == 0 ? trace : nullptr, period_us, drop, tick_log, stats && r == 0,
+                                pose && r == 0);
+            if (r == 0 || result.mean_ns < best.mean_ns) best = result;
+        }
+
+        printf("%-10s %7u %10.0f %10.0f %10.0f %8u %10llu %10.1f %12.1f %9u %9u\n",
+               scenario.name, best.ticks, best.mean_ns, best.p99_ns, best.max_ns,
+               best.bus.led_write_xfers,
+               static_cast<unsigned long long>(best.bus.bus_bytes),
+               static_cast<double>(best.bus.bus_bytes) / best.ticks,
+               static_cast<double>(best.bus.bus_time_ns) / 1000.0 / best.ticks,
+               best.overruns, best.degraded);
+    }
+
+    if (trace) fclose(trace);
+
+    if (!matched) {
+        usage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,370 @@
+#include "fake_i2c_bus.h"
+#include "i2cdev.h"
+#include "i2cdev_sched.h"
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#define REG_MODE1      0x00
+#define REG_MODE2      0x01
+#define REG_ALLCALLADR 0x05
+#define REG_LEDX       0x06
+#define REG_ALL_LED    0xfa
+#define REG_PRE_SCALE  0xfe
+
+#define MODE1_ALLCALL  (1 << 0)
+
+#define LED_FULL_ON_OFF (1 << 4)
+
+#define ADDR_COUNT 128
+
+static uint8_t regs[ADDR_COUNT][256];
+static fake_i2c_device_t devices[ADDR_COUNT];
+static fake_i2c_stats_t stats;
+static bool realtime;
+static uint32_t max_speed;
+static uint32_t fault_period_ms, fault_outage_ms;
+static struct timespec fault_epoch;
+
+// Register files and counters; the bus itself is serialized by the device mutexes
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void load_defaults(uint8_t *file)
+{
+    memset(file, 0, 256);
+    file[REG_MODE1] = 0x11;      // SLEEP | ALLCALL
+    file[REG_MODE2] = 0x04;      // OUTDRV
+    file[REG_ALLCALLADR] = 0xe0; // ALL_CALL at 0x70
+    file[REG_PRE_SCALE] = 0x1e;  // 200 Hz
+}
+
+void fake_i2c_reset(void)
+{
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < ADDR_COUNT; i++)
+        load_defaults(regs[i]);
+    memset(devices, 0, sizeof(devices));
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&lock);
+}
+
+void fake_i2c_attach(uint16_t addr, const fake_i2c_device_t *device)
+{
+    pthread_mutex_lock(&lock);
+    devices[addr & (ADDR_COUNT - 1)] = *device;
+    pthread_mutex_unlock(&lock);
+}
+
+void fake_i2c_clear_stats(void)
+{
+    pthread_mutex_lock(&lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&lock);
+}
+
+void fake_i2c_set_realtime(bool enabled)
+{
+    realtime = enabled;
+}
+
+void fake_i2c_set_max_speed(uint32_t hz)
+{
+    max_speed = hz;
+}
+
+void fake_i2c_set_faults(uint32_t period_ms, uint32_t outage_ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, &fault_epoch);
+    fault_period_ms = period_ms;
+    fault_outage_ms = outage_ms;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Transfers clocked faster than the bus can take, or during an outage, fail like a NACKed address
+static bool bus_fails(const i2c_dev_t *dev)
+{
+    if (max_speed && dev->cfg.master.clk_speed > max_speed)
+        return true;
+    if (!fault_period_ms)
+        return false;
+    uint64_t since = now_ns() - ((uint64_t)fault_epoch.tv_sec * 1000000000ULL + fault_epoch.tv_nsec);
+    return since / 1000000ULL % fault_period_ms >= fault_period_ms - fault_outage_ms;
+}
+
+const fake_i2c_stats_t *fake_i2c_stats(void)
+{
+    return &stats;
+}
+
+uint8_t fake_i2c_reg(uint16_t addr, uint8_t reg)
+{
+    pthread_mutex_lock(&lock);
+    uint8_t value = regs[addr & (ADDR_COUNT - 1)][reg];
+    pthread_mutex_unlock(&lock);
+    return value;
+}
+
+uint16_t fake_pca9685_channel(uint16_t addr, uint8_t channel)
+{
+    uint8_t led[4];
+    pthread_mutex_lock(&lock);
+    memcpy(led, &regs[addr & (ADDR_COUNT - 1)][REG_LEDX + channel * 4], sizeof(led));
+    pthread_mutex_unlock(&lock);
+
+    if (led[3] & LED_FULL_ON_OFF)
+        return 0;
+    if (led[1] & LED_FULL_ON_OFF)
+        return 4095;
+    return (uint16_t)(((led[3] & 0x0f) << 8) | led[2]);
+}
+
+// Called with lock held; returns the wire time of the transfer
+static uint64_t account(const i2c_dev_t *dev, size_t bytes)
+{
+    uint32_t hz = dev->cfg.master.clk_speed ? dev->cfg.master.clk_speed : 100000;
+    uint64_t ns = (uint64_t)bytes * 9 * 1000000000ULL / hz;
+    stats.bus_bytes += bytes;
+    stats.bus_time_ns += ns;
+    return ns;
+}
+
+static void wire_delay(uint64_t ns)
+{
+    if (!realtime)
+        return;
+    struct timespec ts = { .tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL };
+    while (nanosleep(&ts, &ts) && errno == EINTR) {}
+}
+
+static void store_file(uint8_t *file, const uint8_t *data, size_t size)
+{
+    uint8_t reg = data[0];
+
+    if (reg == REG_ALL_LED && size > 1)
+    {
+        // ALL_LED_ON/OFF fan out to every LEDn register
+        for (int ch = 0; ch < 16; ch++)
+            for (size_t i = 1; i < size && i <= 4; i++)
+                file[REG_LEDX + ch * 4 + i - 1] = data[i];
+    }
+    for (size_t i = 1; i < size; i++)
+        file[(uint8_t)(reg + i - 1)] = data[i];
+}
+
+static void store(const i2c_dev_t *dev, const uint8_t *data, size_t size)
+{
+    pthread_mutex_lock(&lock);
+    uint16_t addr = dev->addr & (ADDR_COUNT - 1);
+    uint8_t reg = data[0];
+
+    // The addressed device plus every device listening on it as its ALL_CALL address
+    bool targets[ADDR_COUNT];
+    for (int a = 0; a < ADDR_COUNT; a++)
+        targets[a] = a == addr || (!devices[a].read && (regs[a][REG_MODE1] & MODE1_ALLCALL) && (regs[a][REG_ALLCALLADR] >> 1) == addr);
+    for (int a = 0; a < ADDR_COUNT; a++)
+        if (targets[a])
+            store_file(regs[a], data, size);
+    if (devices[addr].write)
+        devices[addr].write(devices[addr].arg, reg, data + 1, size - 1);
+
+    stats.write_xfers++;
+    if (size > 1 && ((reg >= REG_LEDX && reg < REG_LEDX + 64) || reg == REG_ALL_LED))
+        stats.led_write_xfers++;
+    uint64_t ns = account(dev, size + 1);
+    pthread_mutex_unlock(&lock);
+
+    wire_delay(ns);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// i2cdev.h API
+
+esp_err_t i2cdev_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2cdev_done(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev)
+{
+    if (!dev)
+        return ESP_ERR_INVALID_ARG;
+    i2c_sched_route(dev);
+    dev->mutex = xSemaphoreCreateMutex();
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_delete_mutex(i2c_dev_t *dev)
+{
+    if (!dev)
+        return ESP_ERR_INVALID_ARG;
+    vSemaphoreDelete(dev->mutex);
+    dev->mutex = NULL;
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_take_mutex(i2c_dev_t *dev)
+{
+    if (!dev || !dev->mutex)
+        return ESP_ERR_INVALID_STATE;
+    return xSemaphoreTake(dev->mutex, portMAX_DELAY) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t i2c_dev_give_mutex(i2c_dev_t *dev)
+{
+    if (!dev || !dev->mutex)
+        return ESP_ERR_INVALID_STATE;
+    return xSemaphoreGive(dev->mutex) == pdTRUE ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2c_dev_check_present(const i2c_dev_t *dev)
+{
+    if (!dev)
+        return ESP_ERR_INVALID_ARG;
+    if (bus_fails(dev))
+        return ESP_FAIL;
+    pthread_mutex_lock(&lock);
+    uint64_t ns = account(dev, 1);
+    pthread_mutex_unlock(&lock);
+
+    wire_delay(ns);
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_probe(const i2c_dev_t *dev, i2c_dev_type_t operation_type)
+{
+    (void)operation_type;
+    return i2c_dev_check_present(dev);
+}
+
+esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
+    if (!dev || !in_data || !in_size)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sched_slot_t slot;
+    esp_err_t res = i2c_sched_begin(dev, out_size + in_size, &slot);
+    if (res != ESP_OK)
+        return res;
+    if (bus_fails(dev))
+    {
+        i2c_sched_end(dev, &slot);
+        return ESP_FAIL;
+    }
+
+    pthread_mutex_lock(&lock);
+    uint16_t addr = dev->addr & (ADDR_COUNT - 1);
+    uint8_t *file = regs[addr];
+    uint8_t reg = (out_data && out_size) ? ((const uint8_t *)out_data)[0] : 0;
+    if (devices[addr].read)
+        devices[addr].read(devices[addr].arg, reg, in_data, in_size);
+    else
+        for (size_t i = 0; i < in_size; i++)
+            ((uint8_t *)in_data)[i] = file[(uint8_t)(reg + i)];
+
+    stats.read_xfers++;
+    uint64_t ns = account(dev, (out_data && out_size ? out_size + 1 : 0) + in_size + 1);
+    pthread_mutex_unlock(&lock);
+
+    wire_delay(ns);
+    i2c_sched_end(dev, &slot);
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+{
+    if (!dev)
+        return ESP_ERR_INVALID_ARG;
+    if ((!out_reg || !out_reg_size) && (!out_data || !out_size))
+        return ESP_ERR_INVALID_ARG;
+
+    uint8_t frame[1 + 256];
+    size_t size = 0;
+    if (out_reg && out_reg_size)
+    {
+        memcpy(frame, out_reg, out_reg_size);
+        size = out_reg_size;
+    }
+    if (out_data && out_size)
+    {
+        if (size + out_size > sizeof(frame))
+            return ESP_ERR_INVALID_SIZE;
+        memcpy(frame + size, out_data, out_size);
+        size += out_size;
+    }
+
+    i2c_sched_slot_t slot;
+    esp_err_t res = i2c_sched_begin(dev, size, &slot);
+    if (res != ESP_OK)
+        return res;
+    if (bus_fails(dev))
+        res = ESP_FAIL;
+    else
+        store(dev, frame, size);
+    i2c_sched_end(dev, &slot);
+    return res;
+}
+
+esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg, void *data, size_t size)
+{
+    return i2c_dev_read(dev, &reg, 1, data, size);
+}
+
+esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg, const void *data, size_t size)
+{
+    return i2c_dev_write(dev, &reg, 1, data, size);
+}
+
+esp_err_t i2c_dev_set_speed(i2c_dev_t *dev, uint32_t clk_speed)
+{
+    if (!dev || !clk_speed)
+        return ESP_ERR_INVALID_ARG;
+    dev->cfg.master.clk_speed = clk_speed;
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_attach(i2c_dev_t *dev)
+{
+    return dev ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2c_dev_write_framed(const i2c_dev_t *dev, const void *frame, size_t size)
+{
+    return i2c_dev_write(dev, NULL, 0, frame, size);
+}
+
+esp_err_t i2c_dev_write_framed_timeout(const i2c_dev_t *dev, const void *frame, size_t size, uint32_t timeout_us)
+{
+    // as i2cdev: at most 3 attempts, 100 us and 200 us apart, within the deadline
+    uint64_t deadline = now_ns() + (uint64_t)timeout_us * 1000;
+    uint64_t pause_ns = 100000;
+    esp_err_t res;
+    for (int attempt = 1;; attempt++)
+    {
+        res = i2c_dev_write(dev, NULL, 0, frame, size);
+        if (res == ESP_OK || res == ESP_ERR_INVALID_ARG || attempt >= 3 || now_ns() + pause_ns >= deadline)
+            break;
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = (long)pause_ns };
+        while (nanosleep(&ts, &ts) && errno == EINTR) {}
+        pause_ns *= 2;
+    }
+    return res;
+}
+
+esp_err_t i2c_dev_recover(i2c_dev_t *dev)
+{
+    if (!dev)
+        return ESP_ERR_INVALID_ARG;
+    return bus_fails(dev) ? ESP_FAIL : ESP_OK;
+}
@@ -0,0 +1,80 @@
+#ifndef FAKE_I2C_BUS_H
+#define FAKE_I2C_BUS_H
+
+/*
+ * Recording fake of the i2cdev bus for host builds.
+ *
+ * fake_i2c_bus.c implements the i2cdev.h API without any hardware:
+ * every write lands in a 256-byte register file per 7-bit address
+ * (with auto-increment, like PCA9685 with MODE1.AI set) and is counted.
+ * The register file lets a host program decode exactly what the chip
+ * would output, independent of how the driver chose to frame the writes.
+ *
+ * The bus is thread-safe, and with fake_i2c_set_realtime() each transfer
+ * also takes as long as it would on the wire, so blocking and asynchronous
+ * flushes can be compared. fake_i2c_set_max_speed() emulates a bus that
+ * only works up to a given SCL frequency, fake_i2c_set_faults() one that
+ * drops out periodically. fake_i2c_attach() puts a model of another
+ * kind of device (an IMU) at an address.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "pca9685.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t write_xfers;       // Write transactions (one START..STOP each)
+    uint32_t read_xfers;        // Read transactions (write-then-read counts once)
+    uint32_t led_write_xfers;   // Writes whose first register is a LEDn/ALL_LED register (PWM frames)
+    uint64_t bus_bytes;         // Bytes clocked on the bus, address bytes included
+    uint64_t bus_time_ns;       // Same, converted with the device clock (9 bits per byte)
+} fake_i2c_stats_t;
+
+/*
+ * A device other than a PCA9685. Its reads are served by read() instead of
+ * the register file; write(), if set, sees every write (which still lands
+ * in the register file). Both are called with the bus lock held and must
+ * not call back into the fake. The device does not answer ALL_CALL.
+ */
+typedef struct {
+    void (*read)(void *arg, uint8_t reg, uint8_t *data, size_t size);
+    void (*write)(void *arg, uint8_t reg, const uint8_t *data, size_t size);
+    void *arg;
+} fake_i2c_device_t;
+
+// Reset all register files to PCA9685 power-on defaults, detach all devices and zero the counters
+void fake_i2c_reset(void);
+
+// Put device at `addr` (after fake_i2c_reset())
+void fake_i2c_attach(uint16_t addr, const fake_i2c_device_t *device);
+
+// Zero the counters but keep register contents
+void fake_i2c_clear_stats(void);
+
+const fake_i2c_stats_t *fake_i2c_stats(void);
+
+// Make every transfer sleep for its wire time (off by default)
+void fake_i2c_set_realtime(bool enabled);
+
+// Fail every transfer clocked above `hz` (0, the default, accepts any speed)
+void fake_i2c_set_max_speed(uint32_t hz);
+
+// Fail every transfer during the last `outage_ms` of each `period_ms`, counted from now (0 disables)
+void fake_i2c_set_faults(uint32_t period_ms, uint32_t outage_ms);
+
+// Raw register access for the device at `addr`
+uint8_t fake_i2c_reg(uint16_t addr, uint8_t reg);
+
+// Decoded PCA9685 output of `channel` (0..4095, full-on reads as 4095)
+uint16_t fake_pca9685_channel(uint16_t addr, uint8_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
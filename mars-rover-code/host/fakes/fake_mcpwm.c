@@ -0,0 +1,234 @@
+/*
+ * MCPWM driver fake: see fake_mcpwm.h. Checks the ESP32 limits per group
+ * (3 timers, 3 operators, 2 comparators and 2 generators per operator)
+ * and the driver's deletion rules (timer disabled, operator emptied first).
+ */
+#include "driver/mcpwm_prelude.h"
+#include "fake_mcpwm.h"
+
+#include <stddef.h>
+
+#define FAKE_MCPWM_GROUPS 2
+#define FAKE_MCPWM_PER_GROUP 3
+#define FAKE_MCPWM_PER_OPER 2
+
+#define FAKE_MCPWM_TIMERS (FAKE_MCPWM_GROUPS * FAKE_MCPWM_PER_GROUP)
+#define FAKE_MCPWM_OPERS (FAKE_MCPWM_GROUPS * FAKE_MCPWM_PER_GROUP)
+#define FAKE_MCPWM_OUTPUTS (FAKE_MCPWM_OPERS * FAKE_MCPWM_PER_OPER)
+
+struct mcpwm_timer_t {
+    int used;
+    int group;
+    uint32_t period;
+    int enabled;
+    int running;
+};
+
+struct mcpwm_oper_t {
+    int used;
+    int group;
+    struct mcpwm_timer_t *timer;
+    int cmprs;
+    int gens;
+};
+
+struct mcpwm_cmpr_t {
+    struct mcpwm_oper_t *oper;
+    uint32_t value;
+};
+
+struct mcpwm_gen_t {
+    struct mcpwm_oper_t *oper;
+    int force;                      // -1 none, else the forced level
+    int high_on_empty;
+    struct mcpwm_cmpr_t *low_on;
+};
+
+static struct mcpwm_timer_t timers[FAKE_MCPWM_TIMERS];
+static struct mcpwm_oper_t opers[FAKE_MCPWM_OPERS];
+static struct mcpwm_cmpr_t cmprs[FAKE_MCPWM_OUTPUTS];
+static struct mcpwm_gen_t gens[FAKE_MCPWM_OUTPUTS];
+static int group_timers[FAKE_MCPWM_GROUPS];
+static int group_opers[FAKE_MCPWM_GROUPS];
+static int gen_count;   // generators up to the last one in use
+
+esp_err_t mcpwm_new_timer(const mcpwm_timer_config_t *config, mcpwm_timer_handle_t *ret_timer) {
+    if (!config || !ret_timer || config->group_id < 0 || config->group_id >= FAKE_MCPWM_GROUPS) return ESP_ERR_INVALID_ARG;
+    // 16 bit period, prescaler from the 160 MHz group clock
+    if (!config->period_ticks || config->period_ticks > 65535 ||
+        !config->resolution_hz || 160000000 % config->resolution_hz) return ESP_ERR_INVALID_ARG;
+    if (group_timers[config->group_id] >= FAKE_MCPWM_PER_GROUP) return ESP_ERR_NOT_FOUND;
+
+    // first free slot: handles created after a release keep the creation order
+    struct mcpwm_timer_t *t = NULL;
+    for (int i = 0; i < FAKE_MCPWM_TIMERS && !t; i++)
+        if (!timers[i].used) t = &timers[i];
+    if (!t) return ESP_ERR_NO_MEM;
+    group_timers[config->group_id]++;
+    t->used = 1;
+    t->group = config->group_id;
+    t->period = config->period_ticks;
+    *ret_timer = t;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_enable(mcpwm_timer_handle_t timer) {
+    if (!timer || timer->enabled) return ESP_ERR_INVALID_STATE;
+    timer->enabled = 1;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_disable(mcpwm_timer_handle_t timer) {
+    if (!timer || !timer->enabled) return ESP_ERR_INVALID_STATE;
+    timer->enabled = 0;
+    timer->running = 0;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_timer(mcpwm_timer_handle_t timer) {
+    if (!timer || !timer->used) return ESP_ERR_INVALID_ARG;
+    if (timer->enabled) return ESP_ERR_INVALID_STATE;
+    group_timers[timer->group]--;
+    *timer = (struct mcpwm_timer_t){0};
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_start_stop(mcpwm_timer_handle_t timer, mcpwm_timer_start_stop_cmd_t command) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    if (!timer->enabled) return ESP_ERR_INVALID_STATE;
+    timer->running = command == MCPWM_TIMER_START_NO_STOP;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_operator(const mcpwm_operator_config_t *config, mcpwm_oper_handle_t *ret_oper) {
+    if (!config || !ret_oper || config->group_id < 0 || config->group_id >= FAKE_MCPWM_GROUPS) return ESP_ERR_INVALID_ARG;
+    if (group_opers[config->group_id] >= FAKE_MCPWM_PER_GROUP) return ESP_ERR_NOT_FOUND;
+
+    struct mcpwm_oper_t *o = NULL;
+    for (int i = 0; i < FAKE_MCPWM_OPERS && !o; i++)
+        if (!opers[i].used) o = &opers[i];
+    if (!o) return ESP_ERR_NO_MEM;
+    group_opers[config->group_id]++;
+    o->used = 1;
+    o->group = config->group_id;
+    *ret_oper = o;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_operator(mcpwm_oper_handle_t oper) {
+    if (!oper || !oper->used) return ESP_ERR_INVALID_ARG;
+    if (oper->cmprs || oper->gens) return ESP_ERR_INVALID_STATE;
+    group_opers[oper->group]--;
+    *oper = (struct mcpwm_oper_t){0};
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_operator_connect_timer(mcpwm_oper_handle_t oper, mcpwm_timer_handle_t timer) {
+    if (!oper || !timer || oper->group != timer->group) return ESP_ERR_INVALID_ARG;
+    oper->timer = timer;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_comparator(mcpwm_oper_handle_t oper, const mcpwm_comparator_config_t *config,
+                               mcpwm_cmpr_handle_t *ret_cmpr) {
+    if (!oper || !config || !ret_cmpr) return ESP_ERR_INVALID_ARG;
+    if (oper->cmprs >= FAKE_MCPWM_PER_OPER) return ESP_ERR_NOT_FOUND;
+    struct mcpwm_cmpr_t *c = NULL;
+    for (int i = 0; i < FAKE_MCPWM_OUTPUTS && !c; i++)
+        if (!cmprs[i].oper) c = &cmprs[i];
+    if (!c) return ESP_ERR_NOT_FOUND;
+
+    oper->cmprs++;
+    c->oper = oper;
+    *ret_cmpr = c;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_comparator(mcpwm_cmpr_handle_t cmpr) {
+    if (!cmpr || !cmpr->oper) return ESP_ERR_INVALID_ARG;
+    cmpr->oper->cmprs--;
+    *cmpr = (struct mcpwm_cmpr_t){0};
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_comparator_set_compare_value(mcpwm_cmpr_handle_t cmpr, uint32_t cmp_ticks) {
+    if (!cmpr) return ESP_ERR_INVALID_ARG;
+    if (cmpr->oper->timer && cmp_ticks > cmpr->oper->timer->period) return ESP_ERR_INVALID_ARG;
+    cmpr->value = cmp_ticks;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_generator(mcpwm_oper_handle_t oper, const mcpwm_generator_config_t *config,
+                              mcpwm_gen_handle_t *ret_gen) {
+    if (!oper || !config || !ret_gen || config->gen_gpio_num < 0) return ESP_ERR_INVALID_ARG;
+    if (oper->gens >= FAKE_MCPWM_PER_OPER) return ESP_ERR_NOT_FOUND;
+    struct mcpwm_gen_t *g = NULL;
+    for (int i = 0; i < FAKE_MCPWM_OUTPUTS && !g; i++)
+        if (!gens[i].oper) g = &gens[i];
+    if (!g) return ESP_ERR_NOT_FOUND;
+
+    oper->gens++;
+    g->oper = oper;
+    if (g - gens >= gen_count) gen_count = (int)(g - gens) + 1;
+    g->force = -1;
+    *ret_gen = g;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_generator(mcpwm_gen_handle_t gen) {
+    if (!gen || !gen->oper) return ESP_ERR_INVALID_ARG;
+    gen->oper->gens--;
+    *gen = (struct mcpwm_gen_t){0};
+    while (gen_count && !gens[gen_count - 1].oper) gen_count--;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_generator_set_force_level(mcpwm_gen_handle_t gen, int level, bool hold_on) {
+    if (!gen || level < -1 || level > 1) return ESP_ERR_INVALID_ARG;
+    (void)hold_on;
+    gen->force = level;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_generator_set_action_on_timer_event(mcpwm_gen_handle_t gen, mcpwm_gen_timer_event_action_t ev_act) {
+    if (!gen) return ESP_ERR_INVALID_ARG;
+    if (ev_act.direction == MCPWM_TIMER_DIRECTION_UP && ev_act.event == MCPWM_TIMER_EVENT_EMPTY)
+        gen->high_on_empty = ev_act.action == MCPWM_GEN_ACTION_HIGH;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_generator_set_action_on_compare_event(mcpwm_gen_handle_t gen, mcpwm_gen_compare_event_action_t ev_act) {
+    if (!gen || !ev_act.comparator || ev_act.comparator->oper != gen->oper) return ESP_ERR_INVALID_ARG;
+    if (ev_act.direction == MCPWM_TIMER_DIRECTION_UP)
+        gen->low_on = ev_act.action == MCPWM_GEN_ACTION_LOW ? ev_act.comparator : NULL;
+    return ESP_OK;
+}
+
+// High time of gen on the PCA9685 scale
+static int gen_duty(const struct mcpwm_gen_t *gen) {
+    if (!gen->oper) return 0;
+    const struct mcpwm_timer_t *t = gen->oper->timer;
+    if (gen->force >= 0) return gen->force ? 4096 : 0;
+    if (!t || !t->running || !gen->high_on_empty) return 0;
+    if (!gen->low_on || gen->low_on->value >= t->period) return 4096;
+    return (int)(((uint64_t)gen->low_on->value * 4096 + t->period / 2) / t->period);
+}
+
+void fake_mcpwm_reset(void) {
+    for (int i = 0; i < FAKE_MCPWM_TIMERS; i++) timers[i] = (struct mcpwm_timer_t){0};
+    for (int i = 0; i < FAKE_MCPWM_OPERS; i++) opers[i] = (struct mcpwm_oper_t){0};
+    for (int i = 0; i < FAKE_MCPWM_OUTPUTS; i++) {
+        cmprs[i] = (struct mcpwm_cmpr_t){0};
+        gens[i] = (struct mcpwm_gen_t){0};
+    }
+    for (int i = 0; i < FAKE_MCPWM_GROUPS; i++) {
+        group_timers[i] = 0;
+        group_opers[i] = 0;
+    }
+    gen_count = 0;
+}
+
+int fake_mcpwm_bridge_duty(int bridge) {
+    if (bridge < 0 || 2 * bridge + 1 >= gen_count) return 0;
+    return gen_duty(&gens[2 * bridge]) - gen_duty(&gens[2 * bridge + 1]);
+}
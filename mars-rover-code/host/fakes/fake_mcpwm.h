@@ -0,0 +1,31 @@
+#ifndef FAKE_MCPWM_H
+#define FAKE_MCPWM_H
+
+/*
+ * Fake of the MCPWM driver for host builds.
+ *
+ * Timers, operators, comparators and generators are numbered in the order
+ * they are created, and only remember their settings; a deleted one frees
+ * its number for the next one created. The host program
+ * reads an H-bridge back as the duty its two generators put out.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forget everything created so far (before the next DriveSystem is built)
+void fake_mcpwm_reset(void);
+
+// Output of the generator pair 2 * bridge, 2 * bridge + 1 (creation order)
+// on the PCA9685 scale: A high for 4096 / 4096 of a period is 4096, B is
+// negative; 0 while the timer is stopped or the bridge does not exist
+int fake_mcpwm_bridge_duty(int bridge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * MPU6050 FIFO model: see fake_mpu6050.h. The bus calls in with its lock
+ * held, the host program from its own thread: the state has its own lock.
+ */
+#include "fake_mpu6050.h"
+#include "fake_i2c_bus.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#define REG_FIFO_EN      0x23
+#define REG_INT_STATUS   0x3a
+#define REG_USER_CTRL    0x6a
+#define REG_FIFO_COUNTH  0x72
+#define REG_FIFO_COUNTL  0x73
+#define REG_FIFO_R_W     0x74
+#define REG_WHO_AM_I     0x75
+
+#define FIFO_EN_ZG           (1 << 4)
+#define INT_FIFO_OFLOW       (1 << 4)
+#define USER_CTRL_FIFO_EN    (1 << 6)
+#define USER_CTRL_FIFO_RESET (1 << 2)
+
+#define WHO_AM_I 0x68
+#define FIFO_BYTES 1024
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t fifo[FIFO_BYTES];
+static uint32_t head;       // oldest byte
+static uint32_t level;      // bytes
+static uint8_t fifo_en, user_ctrl, int_status;
+
+static uint8_t pop(void)
+{
+    if (!level)
+        return 0;
+    uint8_t value = fifo[head];
+    head = (head + 1) % FIFO_BYTES;
+    level--;
+    return value;
+}
+
+static void push_byte(uint8_t value)
+{
+    if (level == FIFO_BYTES)
+    {
+        head = (head + 1) % FIFO_BYTES;
+        level--;
+        int_status |= INT_FIFO_OFLOW;
+    }
+    fifo[(head + level) % FIFO_BYTES] = value;
+    level++;
+}
+
+static uint8_t read_byte(uint8_t reg)
+{
+    switch (reg)
+    {
+        case REG_FIFO_COUNTH:
+            return (uint8_t)(level >> 8);
+        case REG_FIFO_COUNTL:
+            return (uint8_t)level;
+        case REG_FIFO_R_W:
+            return pop();
+        case REG_WHO_AM_I:
+            return WHO_AM_I;
+        case REG_INT_STATUS:
+        {
+            // cleared by the read
+            uint8_t value = int_status;
+            int_status = 0;
+            return value;
+        }
+        case REG_FIFO_EN:
+            return fifo_en;
+        case REG_USER_CTRL:
+            return user_ctrl;
+        default:
+            return 0;
+    }
+}
+
+static void bus_read(void *arg, uint8_t reg, uint8_t *data, size_t size)
+{
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < size; i++)
+        // FIFO_R_W does not auto-increment
+        data[i] = read_byte(reg == REG_FIFO_R_W ? reg : (uint8_t)(reg + i));
+    pthread_mutex_unlock(&lock);
+}
+
+static void bus_write(void *arg, uint8_t reg, const uint8_t *data, size_t size)
+{
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < size; i++)
+    {
+        uint8_t r = (uint8_t)(reg + i);
+        if (r == REG_FIFO_EN)
+            fifo_en = data[i];
+        else if (r == REG_USER_CTRL)
+        {
+            user_ctrl = data[i] & ~USER_CTRL_FIFO_RESET;
+            if (data[i] & USER_CTRL_FIFO_RESET)
+                head = level = 0;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void fake_mpu6050_attach(uint16_t addr)
+{
+    pthread_mutex_lock(&lock);
+    head = level = 0;
+    fifo_en = user_ctrl = int_status = 0;
+    pthread_mutex_unlock(&lock);
+
+    fake_i2c_device_t device = { bus_read, bus_write, NULL };
+    fake_i2c_attach(addr, &device);
+}
+
+void fake_mpu6050_push(int16_t gyro_z)
+{
+    pthread_mutex_lock(&lock);
+    if ((user_ctrl & USER_CTRL_FIFO_EN) && (fifo_en & FIFO_EN_ZG))
+    {
+        push_byte((uint8_t)((uint16_t)gyro_z >> 8));
+        push_byte((uint8_t)gyro_z);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+uint32_t fake_mpu6050_fifo_level(void)
+{
+    pthread_mutex_lock(&lock);
+    uint32_t samples = level / 2;
+    pthread_mutex_unlock(&lock);
+    return samples;
+}
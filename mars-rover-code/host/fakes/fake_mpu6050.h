@@ -0,0 +1,33 @@
+#ifndef FAKE_MPU6050_H
+#define FAKE_MPU6050_H
+
+/*
+ * Model of an MPU6050 gyro FIFO on the fake i2c bus, for host builds.
+ *
+ * Nothing samples by itself: the host program turns its model of the
+ * rover's yaw rate into gyro Z samples with fake_mpu6050_push(), which
+ * land in the FIFO while the device has it enabled for gyro Z. The FIFO
+ * holds 1024 bytes; a push into a full FIFO drops the oldest sample and
+ * raises the overflow flag in INT_STATUS, as the device does.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Power-on device at `addr`, empty FIFO (after fake_i2c_reset())
+void fake_mpu6050_attach(uint16_t addr);
+
+// One gyro Z sample, LSB
+void fake_mpu6050_push(int16_t gyro_z);
+
+// Samples waiting in the FIFO
+uint32_t fake_mpu6050_fifo_level(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * PCNT driver fake: see fake_pcnt.h. The counts are atomics so the host
+ * program may feed them from another thread than the tick. Checks the
+ * driver's deletion rules (unit disabled, its channels deleted first).
+ */
+#include "driver/pulse_cnt.h"
+#include "fake_pcnt.h"
+
+#include <stdatomic.h>
+
+#define FAKE_PCNT_UNITS 8
+
+struct pcnt_unit_t {
+    int used;
+    atomic_int count;
+    int enabled;
+    int started;
+    int channels;
+};
+
+struct pcnt_chan_t {
+    struct pcnt_unit_t *unit;
+};
+
+static struct pcnt_unit_t units[FAKE_PCNT_UNITS];
+static struct pcnt_chan_t channels[FAKE_PCNT_UNITS * 2];
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *config, pcnt_unit_handle_t *ret_unit) {
+    if (!config || !ret_unit || config->low_limit >= 0 || config->high_limit <= 0) return ESP_ERR_INVALID_ARG;
+
+    // first free slot: units created after a release keep the creation order
+    struct pcnt_unit_t *u = NULL;
+    for (int i = 0; i < FAKE_PCNT_UNITS && !u; i++)
+        if (!units[i].used) u = &units[i];
+    if (!u) return ESP_ERR_NOT_FOUND;
+    u->used = 1;
+    *ret_unit = u;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_del_unit(pcnt_unit_handle_t unit) {
+    if (!unit || !unit->used) return ESP_ERR_INVALID_ARG;
+    // the driver wants the unit disabled and its channels gone
+    if (unit->enabled || unit->channels) return ESP_ERR_INVALID_STATE;
+    unit->used = 0;
+    atomic_store(&unit->count, 0);
+    unit->started = 0;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit, const pcnt_glitch_filter_config_t *config) {
+    // ESP32: at most 1023 APB (80 MHz) cycles
+    return unit && config && config->max_glitch_ns <= 12787 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t *config, pcnt_channel_handle_t *ret_chan) {
+    if (!unit || !config || !ret_chan) return ESP_ERR_INVALID_ARG;
+    // ESP32 GPIOs end at 39
+    if (config->edge_gpio_num > 39 || config->level_gpio_num > 39) return ESP_ERR_INVALID_ARG;
+    if (unit->channels >= 2) return ESP_ERR_NOT_FOUND;
+
+    struct pcnt_chan_t *c = NULL;
+    for (int i = 0; i < FAKE_PCNT_UNITS * 2 && !c; i++)
+        if (!channels[i].unit) c = &channels[i];
+    if (!c) return ESP_ERR_NOT_FOUND;
+    c->unit = unit;
+    unit->channels++;
+    *ret_chan = c;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_del_channel(pcnt_channel_handle_t chan) {
+    if (!chan || !chan->unit) return ESP_ERR_INVALID_ARG;
+    chan->unit->channels--;
+    chan->unit = NULL;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan,
+                                       pcnt_channel_edge_action_t pos_act, pcnt_channel_edge_action_t neg_act) {
+    (void)pos_act;
+    (void)neg_act;
+    return chan ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t chan,
+                                        pcnt_channel_level_action_t high_act, pcnt_channel_level_action_t low_act) {
+    (void)high_act;
+    (void)low_act;
+    return chan ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int watch_point) {
+    (void)watch_point;
+    return unit ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit) {
+    if (!unit) return ESP_ERR_INVALID_ARG;
+    if (unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->enabled = 1;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unit) {
+    if (!unit) return ESP_ERR_INVALID_ARG;
+    if (!unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->enabled = 0;
+    unit->started = 0;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit) {
+    if (!unit) return ESP_ERR_INVALID_ARG;
+    atomic_store(&unit->count, 0);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit) {
+    if (!unit) return ESP_ERR_INVALID_ARG;
+    if (!unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->started = 1;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unit) {
+    if (!unit) return ESP_ERR_INVALID_ARG;
+    if (!unit->enabled) return ESP_ERR_INVALID_STATE;
+    unit->started = 0;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value) {
+    if (!unit || !value) return ESP_ERR_INVALID_ARG;
+    *value = atomic_load(&unit->count);
+    return ESP_OK;
+}
+
+void fake_pcnt_reset(void) {
+    for (int i = 0; i < FAKE_PCNT_UNITS; i++) {
+        atomic_store(&units[i].count, 0);
+        units[i].used = 0;
+        units[i].enabled = 0;
+        units[i].started = 0;
+        units[i].channels = 0;
+    }
+    for (int i = 0; i < FAKE_PCNT_UNITS * 2; i++) channels[i].unit = NULL;
+}
+
+void fake_pcnt_add(int unit, int32_t counts) {
+    if (unit < 0 || unit >= FAKE_PCNT_UNITS || !units[unit].started) return;
+    atomic_fetch_add(&units[unit].count, counts);
+}
+
+int fake_pcnt_units(void) {
+    int n = 0;
+    for (int i = 0; i < FAKE_PCNT_UNITS; i++) n += units[i].used;
+    return n;
+}
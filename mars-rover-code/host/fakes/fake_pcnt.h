@@ -0,0 +1,33 @@
+#ifndef FAKE_PCNT_H
+#define FAKE_PCNT_H
+
+/*
+ * Fake of the PCNT driver for host builds.
+ *
+ * Units are numbered in the order pcnt_new_unit() creates them, a deleted
+ * unit's number goes to the next one created. Nothing
+ * counts by itself: the host program turns its model of the wheels into
+ * counts with fake_pcnt_add(), and pcnt_unit_get_count() returns the sum,
+ * as the driver does with accum_count.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forget all units and channels (before the next DriveSystem is built)
+void fake_pcnt_reset(void);
+
+// Add counts to unit (creation order); ignored for units that are not counting
+void fake_pcnt_add(int unit, int32_t counts);
+
+// Units that exist (created and not deleted)
+int fake_pcnt_units(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
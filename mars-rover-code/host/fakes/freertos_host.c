@@ -0,0 +1,241 @@
+/*
+ * Minimal FreeRTOS task/semaphore/notification API on top of pthreads,
+ * enough to run the rover's worker tasks on the host. Priorities and core
+ * affinity are not modelled; critical sections share one recursive mutex.
+ */
+#define _GNU_SOURCE
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+    uint32_t max;
+} host_sem_t;
+
+typedef struct {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *param;
+    host_sem_t notify;
+} host_task_t;
+
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread host_task_t *current_task;
+
+void host_enter_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_lock(&critical);
+}
+
+void host_exit_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&critical);
+}
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void sleep_ms(uint64_t ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) && errno == EINTR) {}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Semaphores (counting, with a ceiling)
+
+static void sem_init(host_sem_t *sem, uint32_t initial, uint32_t max)
+{
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sem->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    sem->count = initial;
+    sem->max = max;
+}
+
+// Wait for a non-zero count; returns the count before taking (0 on timeout)
+static uint32_t sem_wait(host_sem_t *sem, TickType_t ticks, bool take_all)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0 && ticks) {
+        if (ticks == portMAX_DELAY)
+            pthread_cond_wait(&sem->cond, &sem->lock);
+        else if (pthread_cond_timedwait(&sem->cond, &sem->lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    uint32_t count = sem->count;
+    if (count)
+        sem->count = take_all ? 0 : count - 1;
+    pthread_mutex_unlock(&sem->lock);
+    return count;
+}
+
+static bool sem_post(host_sem_t *sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool given = sem->count < sem->max;
+    if (given)
+        sem->count++;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+    return given;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    host_sem_t *sem = malloc(sizeof(host_sem_t));
+    if (sem)
+        sem_init(sem, 1, 1);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    host_sem_t *sem = malloc(sizeof(host_sem_t));
+    if (sem)
+        sem_init(sem, 0, 1);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    host_sem_t *sem = malloc(sizeof(host_sem_t));
+    if (sem)
+        sem_init(sem, initial_count, max_count);
+    return sem;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    free(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    return sem_wait((host_sem_t *)sem, ticks_to_wait, false) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return sem_post((host_sem_t *)sem) ? pdTRUE : pdFALSE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Tasks
+
+static host_task_t *self(void)
+{
+    if (!current_task) {
+        // threads not created through xTaskCreate (e.g. main) get a handle on first use
+        current_task = calloc(1, sizeof(host_task_t));
+        current_task->thread = pthread_self();
+        sem_init(&current_task->notify, 0, UINT32_MAX);
+    }
+    return current_task;
+}
+
+static void *task_entry(void *arg)
+{
+    current_task = arg;
+    current_task->fn(current_task->param);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+        void *param, UBaseType_t priority, TaskHandle_t *created, BaseType_t core_id)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    (void)core_id;
+
+    host_task_t *task = calloc(1, sizeof(host_task_t));
+    if (!task)
+        return pdFAIL;
+    task->fn = fn;
+    task->param = param;
+    sem_init(&task->notify, 0, UINT32_MAX);
+
+    if (pthread_create(&task->thread, NULL, task_entry, task)) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (created)
+        *created = task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == current_task)
+        pthread_exit(NULL);
+    pthread_cancel(((host_task_t *)task)->thread);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return self();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(now_ms() / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    sleep_ms((uint64_t)ticks * portTICK_PERIOD_MS);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+{
+    *previous_wake += increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*previous_wake - now) > 0)
+        vTaskDelay(*previous_wake - now);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    sem_post(&((host_task_t *)task)->notify);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    return sem_wait(&self()->notify, ticks_to_wait, clear_on_exit);
+}
+
+void taskYIELD(void)
+{
+    sched_yield();
+}
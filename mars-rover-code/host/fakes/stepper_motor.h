@@ -0,0 +1,61 @@
+#ifndef STEPPER_MOTOR_H
+#define STEPPER_MOTOR_H
+
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+/*
+ * Host fake of components/stepper/stepper_motor.h
+ *
+ * Keeps the same public API (and Config layout, since DriveSystem builds it
+ * with designated initializers) but only records the last commanded values.
+ */
+class StepperMotor {
+public:
+    struct Config {
+        gpio_num_t gpio_en;
+        gpio_num_t gpio_dir;
+        gpio_num_t gpio_step;
+        gpio_num_t servo_pin;
+        uint8_t enable_level;
+        uint32_t resolution_hz;
+        uint32_t min_speed_hz;
+        uint32_t max_speed_hz;
+        uint32_t accel_sample_points;
+    };
+
+    enum class Direction {
+        CLOCKWISE = 0,
+        COUNTER_CLOCKWISE = 1
+    };
+
+    StepperMotor(const Config& config) : config(config) {}
+
+    esp_err_t init() { return ESP_OK; }
+
+    void set_speed(float speed) { current_speed = speed; }
+    void set_direction(Direction dir) { current_direction = dir; }
+    float get_speed() const { return current_speed; }
+    Direction get_direction() const { return current_direction; }
+
+    void stop() { current_speed = 0.0f; }
+    void set_enabled(bool enable) { enabled = enable; }
+    bool is_enabled() const { return enabled; }
+
+    void update() {}
+    esp_err_t start_task(const char*, UBaseType_t = 5, BaseType_t = tskNO_AFFINITY) { return ESP_OK; }
+    void stop_task() {}
+
+    void set_servo_angle(float angle) { servo_angle = angle; }
+    float get_servo_angle() const { return servo_angle; }
+
+private:
+    Config config;
+    float current_speed{0.0f};
+    Direction current_direction{Direction::CLOCKWISE};
+    bool enabled{false};
+    float servo_angle{0.0f};
+};
+
+#endif // STEPPER_MOTOR_H
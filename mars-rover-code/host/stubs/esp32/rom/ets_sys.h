@@ -0,0 +1,9 @@
+// Host stand-in for the ESP32 ROM ets_sys.h
+#ifndef HOST_ETS_SYS_H
+#define HOST_ETS_SYS_H
+
+#include <stdint.h>
+
+static inline void ets_delay_us(uint32_t us) { (void)us; }
+
+#endif
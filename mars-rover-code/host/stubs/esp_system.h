@@ -0,0 +1,7 @@
+// Host stand-in for ESP-IDF esp_system.h
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include "esp_err.h"
+
+#endif
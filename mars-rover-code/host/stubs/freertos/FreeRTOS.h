@@ -0,0 +1,52 @@
+// Host stand-in for FreeRTOS.h (types, tick macros and critical sections)
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#ifndef CONFIG_FREERTOS_HZ
+#define CONFIG_FREERTOS_HZ 100
+#endif
+
+#define portMAX_DELAY    ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS (1000 / CONFIG_FREERTOS_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * CONFIG_FREERTOS_HZ) / 1000))
+#define tskNO_AFFINITY   0x7fffffff
+
+#define configASSERT(x)  do { if (!(x)) abort(); } while (0)
+
+// Critical sections map onto one process-wide recursive mutex (fakes/freertos_host.c)
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void host_enter_critical(portMUX_TYPE *mux);
+void host_exit_critical(portMUX_TYPE *mux);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define taskENTER_CRITICAL(mux) host_enter_critical(mux)
+#define taskEXIT_CRITICAL(mux)  host_exit_critical(mux)
+#define portENTER_CRITICAL(mux) host_enter_critical(mux)
+#define portEXIT_CRITICAL(mux)  host_exit_critical(mux)
+
+#endif
@@ -0,0 +1,37 @@
+// Host stand-in for FreeRTOS task.h, backed by pthreads (fakes/freertos_host.c)
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+// Priority and core are ignored: every task is a plain thread
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+        void *param, UBaseType_t priority, TaskHandle_t *created, BaseType_t core_id);
+
+void vTaskDelete(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+
+void taskYIELD(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xTaskCreate(fn, name, stack, param, prio, created) \
+    xTaskCreatePinnedToCore(fn, name, stack, param, prio, created, tskNO_AFFINITY)
+
+#endif
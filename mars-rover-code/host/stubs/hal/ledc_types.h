@@ -0,0 +1,4 @@
+// Host stand-in for ESP-IDF hal/ledc_types.h
+#ifndef HOST_HAL_LEDC_TYPES_H
+#define HOST_HAL_LEDC_TYPES_H
+#endif
@@ -0,0 +1,5 @@
+// Host stand-in for the generated sdkconfig.h
+// CONFIG_* options are passed as compile definitions from host/CMakeLists.txt.
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+#endif
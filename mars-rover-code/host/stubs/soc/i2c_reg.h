@@ -0,0 +1,4 @@
+// Host stand-in for ESP-IDF soc/i2c_reg.h (i2cdev.h falls back to its default stretch time)
+#ifndef HOST_SOC_I2C_REG_H
+#define HOST_SOC_I2C_REG_H
+#endif
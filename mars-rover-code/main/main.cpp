@@ -1,6 +1,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "driver/gptimer.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 // includes for bluepad32
 #include <btstack_port_esp32.h>
@@ -11,26 +14,78 @@
 
 // Rover C++ headers
 #include "drive_system.h"
+#include "kinematics.h"
 
 static i2c_dev_t* g_pca9685_dev = nullptr;
 static DriveSystem* g_rover = nullptr;
 
-static SemaphoreHandle_t rover_mutex = nullptr;
+static TaskHandle_t rover_tick_handle = nullptr;
+static gptimer_handle_t control_timer = nullptr;
+
+// Control executive: the hardware timer wakes the tick task every Cfg::TICK_PERIOD_US
+static bool IRAM_ATTR control_timer_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(static_cast<TaskHandle_t>(user_ctx), &woken);
+    return woken == pdTRUE;
+}
+
+static void start_control_timer(TaskHandle_t task)
+{
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = 1000000, // 1 us
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &control_timer));
+
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = control_timer_alarm,
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(control_timer, &callbacks, task));
+
+    gptimer_alarm_config_t alarm_config = {
+        .alarm_count = Cfg::TICK_PERIOD_US,
+        .reload_count = 0,
+        .flags = { .auto_reload_on_alarm = true },
+    };
+    ESP_ERROR_CHECK(gptimer_set_alarm_action(control_timer, &alarm_config));
+    ESP_ERROR_CHECK(gptimer_enable(control_timer));
+    ESP_ERROR_CHECK(gptimer_start(control_timer));
+}
 
 static void rover_tick_task(void *param)
 {
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(10); // 10ms
-    
+    int64_t last_tick_us = esp_timer_get_time() - Cfg::TICK_PERIOD_US;
+
     while (1) {
-        if (xSemaphoreTake(rover_mutex, portMAX_DELAY)) {
-            if (g_rover) {
-                g_rover->tick();
+        // more than one pending notification: the previous tick overran its period
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // the timer reloads to 0 at the alarm, so its count is the wake-up latency in us
+        uint64_t since_alarm_us = 0;
+        gptimer_get_raw_count(control_timer, &since_alarm_us);
+
+#if CONFIG_MOTORS_TICK_STATS
+        if (g_rover) {
+            TickStats& stats = g_rover->get_tick_stats();
+            stats.wake_us.record(static_cast<uint32_t>(since_alarm_us));
+            if (pending > 1) {
+                stats.missed_periods.store(stats.missed_periods.load(std::memory_order_relaxed) + pending - 1,
+                                           std::memory_order_relaxed);
             }
-            xSemaphoreGive(rover_mutex);
         }
-        
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+#endif
+
+        // the drive model follows the measured time, late or missed ticks included
+        int64_t now_us = esp_timer_get_time();
+        uint32_t dt_us = static_cast<uint32_t>(now_us - last_tick_us);
+        last_tick_us = now_us;
+
+        // controller input reaches the rover through its command mailbox, no lock needed
+        if (g_rover) {
+            g_rover->tick(dt_us);
+        }
     }
 }
 
@@ -39,7 +94,9 @@ extern "C" {
 
     void app_main()
     {
-        rover_mutex = xSemaphoreCreateMutex();
+#if CONFIG_MOTORS_KINEMATICS_COMPARE_AT_BOOT
+        Kinematics::compare();
+#endif
 
         g_pca9685_dev = new i2c_dev_t{};
 
@@ -51,12 +108,14 @@ extern "C" {
             4096,
             NULL,
             10,
-            NULL,
+            &rover_tick_handle,
             1 
         );
 
+        start_control_timer(rover_tick_handle);
+
         ESP_LOGI("ROVER_MAIN",
-            "Initialization complete. Rover tick task is running.");
+            "Initialization complete. Rover tick task is running at %u Hz.", Cfg::CONTROL_RATE_HZ);
 
         btstack_init();
 